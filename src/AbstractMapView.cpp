@@ -67,8 +67,7 @@ void AbstractMapView::contextMenuEvent(QContextMenuEvent* event) {
 }
 
 bool AbstractMapView::isReady() {
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    return rasterModel() && rasterModel()->isUsable();
+    return MainWindow::instance()->rasterModelSnapshot()->usable;
 }
 
 void AbstractMapView::copyCoordsToClipboard() {
@@ -0,0 +1,173 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheImporter.h"
+
+#include <QtCore/QMetaType>
+#include <QtCore/QtConcurrentRun>
+
+#include "AbstractCache.h"
+#include "CacheIndex.h"
+#include "CacheStatistics.h"
+#include "MainWindow.h"
+#include "PluginManager.h"
+#include "PluginManagerStore.h"
+
+using namespace std;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    /* Count of tiles written at once */
+    const size_t batchSize = 64;
+}
+
+CacheImporter::CacheImporter(const string& sourcePlugin, const string& _targetPlugin, const QStringList& _packages, QObject* parent): QThread(parent), targetPlugin(_targetPlugin), packages(_packages), _abort(false), imported(0) {
+    qRegisterMetaType<quint64>("quint64");
+
+    /* Instances can be created only in main thread. Package sources are
+       opened later in the import thread. */
+    PluginManager<AbstractRasterModel>* manager = MainWindow::instance()->pluginManagerStore()->rasterModels()->manager();
+    target = manager->instance(targetPlugin);
+    if(target) target->setOnline(false);
+    for(int i = 0; i != packages.size(); ++i) {
+        AbstractRasterModel* source = target ? manager->instance(sourcePlugin) : 0;
+        if(source) source->setOnline(false);
+        sources.push_back(source);
+    }
+}
+
+CacheImporter::~CacheImporter() {
+    abort();
+    wait();
+
+    for(vector<AbstractRasterModel*>::const_iterator it = sources.begin(); it != sources.end(); ++it)
+        delete *it;
+    delete target;
+}
+
+quint64 CacheImporter::importedCount() {
+    QMutexLocker locker(&mutex);
+    return imported;
+}
+
+double CacheImporter::tilesPerSecond() {
+    QMutexLocker locker(&mutex);
+    return timer.isValid() && timer.elapsed() != 0 ? imported*1000.0/timer.elapsed() : 0.0;
+}
+
+void CacheImporter::abort() {
+    QMutexLocker locker(&mutex);
+    _abort = true;
+}
+
+TileArea CacheImporter::scanArea(const AbstractRasterModel* source, Zoom zoom) {
+    return source->area()*pow2(zoom-*source->zoomLevels().begin());
+}
+
+void CacheImporter::run() {
+    mutex.lock();
+    _abort = false;
+    imported = 0;
+    timer.start();
+    mutex.unlock();
+
+    if(!target) return;
+
+    vector<Tile> batch;
+    for(int i = 0; i != packages.size(); ++i) {
+        /* Open the package in its own offline instance */
+        AbstractRasterModel* source = sources[i];
+        if(!source || source->addPackage(packages[i].toStdString()) == -1 || source->zoomLevels().empty())
+            continue;
+
+        set<Zoom> zoomLevels = source->zoomLevels();
+        vector<string> layers = source->layers();
+        vector<string> overlays = source->overlays();
+        layers.insert(layers.end(), overlays.begin(), overlays.end());
+
+        int zoomNumber = 0;
+        for(set<Zoom>::const_iterator z = zoomLevels.begin(); z != zoomLevels.end(); ++z, ++zoomNumber) {
+            TileArea a = scanArea(source, *z);
+
+            for(unsigned int y = a.y; y != a.y+a.h; ++y) for(unsigned int x = a.x; x != a.x+a.w; ++x) {
+                mutex.lock();
+                bool aborted = _abort;
+                mutex.unlock();
+                if(aborted) {
+                    writer.waitForFinished();
+                    return;
+                }
+
+                TileCoords c(x, y);
+                for(vector<string>::const_iterator layer = layers.begin(); layer != layers.end(); ++layer) {
+                    Tile tile;
+                    tile.data = source->tileFromPackage(*layer, *z, c);
+                    if(tile.data.empty()) continue;
+
+                    tile.layer = *layer;
+                    tile.zoom = *z;
+                    tile.coords = c;
+                    batch.push_back(tile);
+
+                    if(batch.size() >= batchSize) submit(batch);
+                }
+            }
+
+            emit progress((i*zoomLevels.size()+zoomNumber+1)*100/(packages.size()*zoomLevels.size()), importedCount(), tilesPerSecond());
+        }
+    }
+
+    submit(batch);
+    writer.waitForFinished();
+
+    emit progress(100, importedCount(), tilesPerSecond());
+}
+
+void CacheImporter::submit(vector<Tile>& batch) {
+    /* Wait for previous batch, write this one while reading next */
+    writer.waitForFinished();
+    if(!batch.empty()) writer = QtConcurrent::run(this, &CacheImporter::write, batch);
+    batch.clear();
+}
+
+void CacheImporter::write(const vector<Tile>& batch) {
+    /* Tiles are keyed by our own instance, current raster model doesn't
+       need to be locked */
+    Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+    if(!cache()) return;
+
+    CacheStatistics* statistics = MainWindow::instance()->cacheStatistics();
+    statistics->recordUsedSize(cache()->usedSize());
+    CacheIndex* index = MainWindow::instance()->cacheIndex();
+
+    QElapsedTimer t;
+    for(vector<Tile>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+        t.start();
+        if(!target->tileToCache(cache(), it->layer, it->zoom, it->coords, it->data)) continue;
+        TileKey key(QString::fromStdString(it->layer), it->zoom, it->coords);
+        statistics->recordWrite(key, it->data.size(), cache()->blockSize(), t.nsecsElapsed()/1000);
+        index->insert(targetPlugin, key);
+
+        mutex.lock();
+        ++imported;
+        mutex.unlock();
+    }
+
+    statistics->recordUsedSize(cache()->usedSize());
+}
+
+}}
@@ -0,0 +1,142 @@
+#ifndef Kompas_QtGui_CacheImporter_h
+#define Kompas_QtGui_CacheImporter_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CacheImporter
+ */
+
+#include <string>
+#include <vector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFuture>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+
+#include "TileKey.h"
+
+namespace Kompas {
+
+namespace Core {
+    class AbstractRasterModel;
+}
+
+namespace QtGui {
+
+/**
+@brief Bulk import of package contents into cache
+
+Reads all tiles from given packages and writes them into current cache, keyed
+by given target raster model plugin, so tiles from a package can be used with
+online map of that raster model without browsing it. The packages are read
+with source plugin, which can differ from the target one, e.g. when the
+package was saved in an offline format from an online map with the same tile
+scheme. Neither of them needs to be the current raster model. Each package is
+opened through its own offline instance of the source plugin and tiles are
+keyed through an instance of the target plugin, all of them are created in the
+constructor, as plugin manager can be used only from the main thread. Whole
+package area is scanned in each zoom level (see scanArea()), as tiles can be
+present under tiles missing in lower zoom levels, e.g. in packages with only
+cached tiles or with custom area.
+
+Reading and writing is a two-stage pipeline, not a parallel writer, as the
+cache allows only one writer at a time: while one batch of tiles is written to
+the cache in the global thread pool, next batch is read from the package. Only
+the cache is locked and only for writing one batch, current raster model is
+not locked at all. Tiles are written directly, not through CacheWriteQueue, so
+they are not subject to cache quotas.
+*/
+class CacheImporter: public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param sourcePlugin  Raster model plugin the packages belong to
+         * @param targetPlugin  Raster model plugin for which the tiles are
+         *      cached
+         * @param packages      Package filenames
+         * @param parent        Parent object
+         *
+         * Must be called from main thread.
+         */
+        CacheImporter(const std::string& sourcePlugin, const std::string& targetPlugin, const QStringList& packages, QObject* parent = 0);
+
+        /**
+         * @brief Destructor
+         *
+         * Stops the import. Must be called from main thread.
+         */
+        virtual ~CacheImporter();
+
+        /** @brief Count of imported tiles */
+        quint64 importedCount();
+
+        /** @brief Average throughput in tiles per second */
+        double tilesPerSecond();
+
+        /**
+         * @brief Area scanned for tiles
+         * @param source    Raster model with the package opened
+         * @param zoom      Zoom level
+         *
+         * Returns whole package area in given zoom level.
+         */
+        static Core::TileArea scanArea(const Core::AbstractRasterModel* source, Core::Zoom zoom);
+
+        /** @brief Run the thread */
+        void run();
+
+    public slots:
+        /** @brief Stop the import */
+        void abort();
+
+    signals:
+        /**
+         * @brief Import progress
+         * @param percent           Percent completed (estimated from package
+         *      and zoom level count)
+         * @param imported          Count of imported tiles
+         * @param tilesPerSecond    Average throughput
+         */
+        void progress(int percent, quint64 imported, double tilesPerSecond);
+
+    private:
+        struct Tile {
+            std::string layer;
+            Core::Zoom zoom;
+            Core::TileCoords coords;
+            std::string data;
+        };
+
+        std::string targetPlugin;
+        QStringList packages;
+        std::vector<Core::AbstractRasterModel*> sources;
+        Core::AbstractRasterModel* target;
+        QMutex mutex;
+        bool _abort;
+        quint64 imported;
+        QElapsedTimer timer;
+        QFuture<void> writer;
+
+        void submit(std::vector<Tile>& batch);
+        void write(const std::vector<Tile>& batch);
+};
+
+}}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheIndex.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+
+#include "Utility/Directory.h"
+
+using namespace std;
+using namespace Corrade::Utility;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    /* Index file format version */
+    const quint32 version = 1;
+}
+
+CacheIndex::CacheIndex(): changed(false) {}
+
+void CacheIndex::load(const string& _cachePath) {
+    save();
+
+    QMutexLocker locker(&mutex);
+    index.clear();
+    cachePath = _cachePath;
+    changed = false;
+    if(cachePath.empty()) return;
+
+    QFile file(QString::fromStdString(filename()));
+    if(!file.open(QFile::ReadOnly)) return;
+    QDataStream in(&file);
+
+    /* Index of another cache or in unknown format */
+    quint32 fileVersion;
+    QString path;
+    in >> fileVersion;
+    if(fileVersion != version) return;
+    in >> path;
+    if(path.toStdString() != cachePath) return;
+
+    qint32 modelCount;
+    in >> modelCount;
+    for(qint32 i = 0; i != modelCount && in.status() == QDataStream::Ok; ++i) {
+        QString model;
+        qint32 tileCount;
+        in >> model >> tileCount;
+
+        QSet<TileKey>& tiles = index[model];
+        for(qint32 j = 0; j != tileCount && in.status() == QDataStream::Ok; ++j) {
+            TileKey key;
+            quint32 zoom, x, y;
+            in >> key.layer >> zoom >> x >> y;
+            key.zoom = zoom;
+            key.coords = TileCoords(x, y);
+            tiles.insert(key);
+        }
+    }
+
+    /* Corrupted file, don't use anything from it */
+    if(in.status() != QDataStream::Ok) index.clear();
+}
+
+void CacheIndex::save() {
+    QMutexLocker locker(&mutex);
+    if(!changed || cachePath.empty()) return;
+
+    QFile file(QString::fromStdString(filename()));
+    if(!file.open(QFile::WriteOnly|QFile::Truncate)) return;
+    QDataStream out(&file);
+
+    out << version << QString::fromStdString(cachePath) << static_cast<qint32>(index.size());
+    for(QHash<QString, QSet<TileKey> >::const_iterator it = index.constBegin(); it != index.constEnd(); ++it) {
+        out << it.key() << static_cast<qint32>(it->size());
+        foreach(const TileKey& key, *it)
+            out << key.layer << static_cast<quint32>(key.zoom) << static_cast<quint32>(key.coords.x) << static_cast<quint32>(key.coords.y);
+    }
+
+    changed = false;
+}
+
+void CacheIndex::clear() {
+    QMutexLocker locker(&mutex);
+    index.clear();
+    changed = true;
+}
+
+void CacheIndex::insert(const string& model, const TileKey& key) {
+    QMutexLocker locker(&mutex);
+    if(cachePath.empty()) return;
+
+    QSet<TileKey>& tiles = index[QString::fromStdString(model)];
+    if(tiles.contains(key)) return;
+    tiles.insert(key);
+    changed = true;
+}
+
+void CacheIndex::remove(const string& model, const TileKey& key) {
+    QMutexLocker locker(&mutex);
+
+    QHash<QString, QSet<TileKey> >::iterator found = index.find(QString::fromStdString(model));
+    if(found != index.end() && found->remove(key)) changed = true;
+}
+
+void CacheIndex::update(const string& model, const TileKey& key, bool found) {
+    if(found) insert(model, key);
+    else remove(model, key);
+}
+
+bool CacheIndex::contains(const string& model, const TileKey& key) {
+    QMutexLocker locker(&mutex);
+    return index.value(QString::fromStdString(model)).contains(key);
+}
+
+vector<TileCoords> CacheIndex::tiles(const string& model, const QString& layer, Zoom zoom) {
+    QMutexLocker locker(&mutex);
+
+    vector<TileCoords> coords;
+    QHash<QString, QSet<TileKey> >::const_iterator found = index.constFind(QString::fromStdString(model));
+    if(found == index.constEnd()) return coords;
+
+    foreach(const TileKey& key, *found)
+        if(key.zoom == zoom && key.layer == layer) coords.push_back(key.coords);
+
+    return coords;
+}
+
+QList<TileKey> CacheIndex::tiles(const string& model) {
+    QMutexLocker locker(&mutex);
+    return index.value(QString::fromStdString(model)).toList();
+}
+
+int CacheIndex::count(const string& model) {
+    QMutexLocker locker(&mutex);
+    return index.value(QString::fromStdString(model)).size();
+}
+
+QHash<QString, int> CacheIndex::layerCounts() {
+    QMutexLocker locker(&mutex);
+
+    QHash<QString, int> counts;
+    for(QHash<QString, QSet<TileKey> >::const_iterator it = index.constBegin(); it != index.constEnd(); ++it)
+        foreach(const TileKey& key, *it) ++counts[key.layer];
+
+    return counts;
+}
+
+string CacheIndex::filename() {
+    return Directory::join(Directory::configurationDir("Kompas"), "cacheindex");
+}
+
+}}
@@ -0,0 +1,131 @@
+#ifndef Kompas_QtGui_CacheIndex_h
+#define Kompas_QtGui_CacheIndex_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CacheIndex
+ */
+
+#include <string>
+#include <vector>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Index of tiles in persistent cache
+
+Cache plugins store tiles under opaque keys generated by raster model and
+can't list their contents, so this index remembers which tiles of which
+raster model were written to the cache or found there. It allows enumerating
+cached tiles (e.g. for saving them into a package) without probing tiles
+which are not there.
+
+Cache plugins evict tiles on their own, so the index can contain tiles which
+are not in the cache anymore. They are removed from the index when a lookup
+of them fails. The index is saved into a file in configuration directory
+together with path of the cache it belongs to and loaded when the same cache
+is set again. All functions are thread-safe.
+@see MainWindow::cacheIndex()
+*/
+class CacheIndex {
+    public:
+        /** @brief Constructor */
+        CacheIndex();
+
+        /**
+         * @brief Load index for given cache
+         * @param cachePath     Cache path, empty if no cache is used
+         *
+         * Saves index of previous cache. If saved index doesn't belong to
+         * given cache, the index is empty.
+         */
+        void load(const std::string& cachePath);
+
+        /** @brief Save the index */
+        void save();
+
+        /** @brief Remove all tiles */
+        void clear();
+
+        /**
+         * @brief Add tile
+         * @param model     Raster model plugin
+         * @param key       Tile
+         */
+        void insert(const std::string& model, const TileKey& key);
+
+        /**
+         * @brief Remove tile
+         * @param model     Raster model plugin
+         * @param key       Tile
+         */
+        void remove(const std::string& model, const TileKey& key);
+
+        /**
+         * @brief Record result of cache lookup
+         * @param model     Raster model plugin
+         * @param key       Tile
+         * @param found     Whether the tile was found in the cache
+         *
+         * Adds found tile or removes tile which was evicted meanwhile.
+         */
+        void update(const std::string& model, const TileKey& key, bool found);
+
+        /**
+         * @brief Whether given tile is in the index
+         * @param model     Raster model plugin
+         * @param key       Tile
+         */
+        bool contains(const std::string& model, const TileKey& key);
+
+        /**
+         * @brief Cached tiles
+         * @param model     Raster model plugin
+         * @param layer     Layer or overlay
+         * @param zoom      Zoom level
+         */
+        std::vector<Core::TileCoords> tiles(const std::string& model, const QString& layer, Core::Zoom zoom);
+
+        /**
+         * @brief All cached tiles of given raster model
+         * @param model     Raster model plugin
+         */
+        QList<TileKey> tiles(const std::string& model);
+
+        /** @brief Count of tiles of given raster model */
+        int count(const std::string& model);
+
+        /** @brief Count of tiles in each layer, summed for all raster models */
+        QHash<QString, int> layerCounts();
+
+    private:
+        QMutex mutex;
+        std::string cachePath;
+        bool changed;
+        QHash<QString, QSet<TileKey> > index;
+
+        static std::string filename();
+};
+
+}}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CachePolicy.h"
+
+#include "MainWindow.h"
+
+using namespace std;
+using namespace Corrade::Utility;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    /* Count of frequency additions after which all frequencies are halved */
+    const int frequencyWindow = 16384;
+}
+
+CachePolicy::CachePolicy(): cacheSize(0), rejected(0), frequencyAdditions(0) {
+    ConfigurationGroup* group = MainWindow::instance()->configuration()->group("cache");
+
+    defaultRule.quota = qBound(0, group->value<int>("quota"), 100);
+    defaultRule.policy = policyFromString(group->value<string>("policy"));
+    defaultRule.lowZoom = 10;
+    group->value<Core::Zoom>("lowZoom", &defaultRule.lowZoom);
+
+    /* Layer settings override only the keys which are present */
+    vector<ConfigurationGroup*> layers = group->groups("layer");
+    for(vector<ConfigurationGroup*>::const_iterator it = layers.begin(); it != layers.end(); ++it) {
+        Rule r = defaultRule;
+        r.layer = QString::fromStdString((*it)->value<string>("name"));
+        if(r.layer.isEmpty()) continue;
+
+        r.model = (*it)->value<string>("model");
+        if((*it)->value<int>("quota", &r.quota))
+            r.quota = qBound(0, r.quota, 100);
+        string policy;
+        if((*it)->value<string>("policy", &policy))
+            r.policy = policyFromString(policy);
+        (*it)->value<Core::Zoom>("lowZoom", &r.lowZoom);
+        rules.push_back(r);
+    }
+}
+
+void CachePolicy::setRasterModel(const string& plugin) {
+    QMutexLocker locker(&mutex);
+    model = plugin;
+}
+
+void CachePolicy::setCache(size_t cacheSize, size_t usedSize, const QHash<QString, int>& tileCounts) {
+    QMutexLocker locker(&mutex);
+    this->cacheSize = cacheSize;
+
+    /* Tiles of all layers are assumed to be of similar size */
+    _usage.clear();
+    qint64 total = 0;
+    for(QHash<QString, int>::const_iterator it = tileCounts.constBegin(); it != tileCounts.constEnd(); ++it)
+        total += *it;
+    if(total == 0) return;
+    for(QHash<QString, int>::const_iterator it = tileCounts.constBegin(); it != tileCounts.constEnd(); ++it)
+        _usage.insert(it.key(), static_cast<double>(usedSize)*(*it)/total);
+}
+
+void CachePolicy::setCacheSize(size_t size) {
+    QMutexLocker locker(&mutex);
+    cacheSize = size;
+}
+
+bool CachePolicy::requested(const TileKey& key) {
+    QMutexLocker locker(&mutex);
+
+    /* Requests are counted only for layers which need them */
+    if(rule(key.layer).policy != Lfu) return false;
+
+    quint8& f = frequency[key];
+    if(f != 255) ++f;
+    bool admitted = f >= 2 && deferred.remove(key);
+
+    /* Halve all frequencies after some time, so old popularity fades out */
+    if(++frequencyAdditions >= frequencyWindow) {
+        frequencyAdditions = 0;
+        for(QHash<TileKey, quint8>::iterator it = frequency.begin(); it != frequency.end(); ) {
+            if((*it >>= 1) == 0) {
+                deferred.remove(it.key());
+                it = frequency.erase(it);
+            } else ++it;
+        }
+    }
+
+    return admitted;
+}
+
+bool CachePolicy::admit(const TileKey& key, size_t size) {
+    QMutexLocker locker(&mutex);
+
+    const Rule& r = rule(key.layer);
+
+    /* Tile wasn't requested often enough, remember it so it can be written
+       on next request without downloading it again */
+    if(r.policy == Lfu && frequency.value(key) < 2) {
+        if(frequency.contains(key)) deferred.insert(key);
+        ++rejected;
+        return false;
+    }
+
+    /* Quota exceeded, low zoom levels are exempt with zoom policy */
+    bool exempt = r.policy == ZoomWeighted && key.zoom <= r.lowZoom;
+    double quota = static_cast<double>(cacheSize)*r.quota/100;
+    if(r.quota != 0 && cacheSize != 0 && !exempt && _usage.value(key.layer)+size > quota) {
+        /* The cache evicts unused tiles of the layer meanwhile, decay the
+           usage so the layer isn't locked out for good */
+        _usage[key.layer] *= 1.0-qMin(1.0, size/quota);
+
+        ++rejected;
+        return false;
+    }
+
+    return true;
+}
+
+void CachePolicy::written(const TileKey& key, size_t size) {
+    QMutexLocker locker(&mutex);
+
+    /* Decay all usages, as the written tile replaces part of cache contents */
+    if(cacheSize != 0) {
+        double decay = 1.0-qMin(1.0, static_cast<double>(size)/cacheSize);
+        for(QHash<QString, double>::iterator it = _usage.begin(); it != _usage.end(); ++it)
+            *it *= decay;
+    }
+
+    _usage[key.layer] += size;
+}
+
+size_t CachePolicy::usage(const QString& layer) {
+    QMutexLocker locker(&mutex);
+    return _usage.value(layer);
+}
+
+quint64 CachePolicy::rejectedCount() {
+    QMutexLocker locker(&mutex);
+    return rejected;
+}
+
+CachePolicy::Policy CachePolicy::policyFromString(const string& policy) {
+    if(policy == "lfu") return Lfu;
+    if(policy == "zoom") return ZoomWeighted;
+    return Lru;
+}
+
+const CachePolicy::Rule& CachePolicy::rule(const QString& layer) const {
+    /* Model-specific rule has precedence */
+    const Rule* found = &defaultRule;
+    for(vector<Rule>::const_iterator it = rules.begin(); it != rules.end(); ++it) {
+        if(it->layer != layer) continue;
+        if(it->model == model) return *it;
+        if(it->model.empty()) found = &*it;
+    }
+
+    return *found;
+}
+
+}}
@@ -0,0 +1,207 @@
+#ifndef Kompas_QtGui_CachePolicy_h
+#define Kompas_QtGui_CachePolicy_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CachePolicy
+ */
+
+#include <vector>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Per-layer cache quotas and policies
+
+Decides which tiles are written to persistent cache, so one layer cannot take
+the whole cache for itself. Every tile queued in CacheWriteQueue is checked
+with admit() and accounted with written() after it is actually written. Cache
+plugins do the eviction themselves and don't allow removing particular tiles,
+so quotas and policies are enforced on admission:
+
+<ul>
+<li>Each layer has a quota as percentage of cache size. Size of tiles from the
+layer currently in the cache is estimated at startup from cache used size and
+count of tiles of each layer in CacheIndex, then from sizes of written tiles,
+older writes are decayed as the cache contents are replaced. Tiles which would
+exceed the quota are not written. Each refused tile decays the usage of its
+layer too, as the cache plugin meanwhile evicts tiles no longer used, so a
+layer over its quota is written again at reduced rate instead of being locked
+out until other layers write enough.</li>
+<li>With @c lru policy all tiles (within quota) are written and the cache
+plugin evicts least recently used ones.</li>
+<li>With @c lfu policy only tiles which were requested (see requested()) at
+least twice are written, so tiles used only once don't evict frequently used
+ones. If a refused tile is requested again while still in memory, it is
+written from there without downloading it again. Request counts are
+periodically halved.</li>
+<li>With @c zoom policy tiles with zoom level up to @c lowZoom are always
+written regardless of quota, so when the quota is exceeded, only tiles in
+higher zoom levels are refused and low zoom levels stay in the cache
+longer.</li>
+</ul>
+Layer settings can be restricted to particular raster model. Layers without
+their own settings use default quota, policy and low zoom levels, settings
+missing in layer group are taken from the defaults too. All functions are
+thread-safe.
+@see MainWindow::cachePolicy()
+
+@configuration
+
+<p>Configuration is stored in <tt>cache</tt> group, see MainWindow class
+documentation.</p>
+<pre>
+[cache]
+
+# Default quota for each layer in percent of cache size, 0 means unlimited
+quota=0
+
+# Default policy, one of lru, lfu, zoom
+policy=lru
+
+# Default max zoom level which is always written with zoom policy
+lowZoom=10
+
+# Settings for particular layer, can be repeated, missing keys are taken from
+# the defaults above
+[cache/layer]
+
+# Layer or overlay name
+name=
+
+# Raster model plugin, empty for all models
+model=
+
+# Quota in percent of cache size, policy, max zoom level which is always
+# written with zoom policy
+quota=
+policy=
+lowZoom=
+</pre>
+*/
+class CachePolicy {
+    public:
+        /** @brief Policy */
+        enum Policy {
+            Lru,            /**< @brief Write all tiles */
+            Lfu,            /**< @brief Write only repeatedly requested tiles */
+            ZoomWeighted    /**< @brief Always write tiles in low zoom levels */
+        };
+
+        /** @brief Settings for one layer */
+        struct Rule {
+            /** @brief Constructor */
+            inline Rule(): quota(0), policy(Lru), lowZoom(0) {}
+
+            QString layer;          /**< @brief Layer name, empty for default rule */
+            std::string model;      /**< @brief Raster model plugin, empty for all models */
+            int quota;              /**< @brief Quota in percent, 0 means unlimited */
+            Policy policy;          /**< @brief Policy */
+            Core::Zoom lowZoom;     /**< @brief Max zoom always written with ZoomWeighted policy */
+        };
+
+        /**
+         * @brief Constructor
+         *
+         * Rules are taken from configuration.
+         */
+        CachePolicy();
+
+        /**
+         * @brief Set raster model
+         * @param plugin    Raster model plugin name
+         *
+         * Used for matching model-specific rules.
+         */
+        void setRasterModel(const std::string& plugin);
+
+        /**
+         * @brief Set cache
+         * @param cacheSize     Cache size in bytes, 0 disables quotas
+         * @param usedSize      Used cache size in bytes
+         * @param tileCounts    Count of tiles of each layer in the cache
+         *
+         * Discards previous usage estimates and splits used size among the
+         * layers by count of their tiles (see CacheIndex::layerCounts()).
+         */
+        void setCache(std::size_t cacheSize, std::size_t usedSize, const QHash<QString, int>& tileCounts);
+
+        /**
+         * @brief Set cache size
+         * @param size      Cache size in bytes, 0 disables quotas
+         */
+        void setCacheSize(std::size_t size);
+
+        /**
+         * @brief Record request for a tile
+         * @return Whether the tile was refused by @c lfu policy before and
+         *      is requested often enough now
+         *
+         * Called for each lookup of the tile, regardless of where its data
+         * are found. If this returns true and the data are at hand, they
+         * should be queued for writing, as the tile won't be downloaded again.
+         */
+        bool requested(const TileKey& key);
+
+        /**
+         * @brief Whether to write given tile to cache
+         * @param key       Tile
+         * @param size      Tile data size
+         *
+         * Doesn't account anything to the layer, call written() after the
+         * tile is actually written.
+         */
+        bool admit(const TileKey& key, std::size_t size);
+
+        /**
+         * @brief Account written tile
+         * @param key       Tile
+         * @param size      Tile data size
+         */
+        void written(const TileKey& key, std::size_t size);
+
+        /** @brief Estimated size of tiles from given layer in the cache */
+        std::size_t usage(const QString& layer);
+
+        /** @brief Count of tiles refused because of quotas or policy */
+        quint64 rejectedCount();
+
+    private:
+        QMutex mutex;
+        Rule defaultRule;
+        std::vector<Rule> rules;
+        std::string model;
+        std::size_t cacheSize;
+        quint64 rejected;
+
+        QHash<QString, double> _usage;
+        QHash<TileKey, quint8> frequency;
+        QSet<TileKey> deferred;
+        int frequencyAdditions;
+
+        static Policy policyFromString(const std::string& policy);
+
+        const Rule& rule(const QString& layer) const;
+};
+
+}}
+
+#endif
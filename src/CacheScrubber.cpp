@@ -0,0 +1,196 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheScrubber.h"
+
+#include <QtGui/QImage>
+
+#include "AbstractCache.h"
+#include "CacheIndex.h"
+#include "CacheWriteQueue.h"
+#include "MainWindow.h"
+
+using namespace std;
+using namespace Corrade::Utility;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    /* Tile check result */
+    enum Result { Missing, Valid, Corrupted };
+}
+
+bool CacheScrubber::isValid(const QByteArray& data) {
+    /* PNG: signature, IEND chunk with its CRC at the end */
+    if(data.startsWith("\x89PNG\r\n\x1a\n"))
+        return data.endsWith(QByteArray("IEND\xae\x42\x60\x82", 8));
+
+    /* JPEG: SOI marker, EOI marker at the end (some encoders pad the file
+       with zeros after it) */
+    if(data.startsWith("\xff\xd8\xff")) {
+        int end = data.size();
+        while(end > 2 && data[end-1] == '\0') --end;
+        return end >= 4 && data[end-2] == '\xff' && data[end-1] == '\xd9';
+    }
+
+    /* GIF: signature, trailer */
+    if(data.startsWith("GIF87a") || data.startsWith("GIF89a"))
+        return data.endsWith(';');
+
+    /* Other formats, decode the image */
+    return !QImage::fromData(data).isNull();
+}
+
+CacheScrubber::CacheScrubber(QObject* parent): QThread(parent), _abort(false), running(false), total(0), checked(0), corrupted(0) {
+    rate = qMax(1, MainWindow::instance()->configuration()->group("cache")->value<int>("scrubRate"));
+}
+
+CacheScrubber::~CacheScrubber() {
+    abort();
+    wait();
+}
+
+int CacheScrubber::checkedCount() {
+    QMutexLocker locker(&mutex);
+    return checked;
+}
+
+int CacheScrubber::corruptedCount() {
+    QMutexLocker locker(&mutex);
+    return corrupted;
+}
+
+void CacheScrubber::scrub() {
+    string currentModel = MainWindow::instance()->rasterModelSnapshot()->plugin;
+    if(currentModel.empty()) return;
+
+    mutex.lock();
+    if(running) {
+        mutex.unlock();
+        return;
+    }
+
+    model = currentModel;
+    jobs = MainWindow::instance()->cacheIndex()->tiles(model);
+    total = jobs.size();
+    checked = 0;
+    corrupted = 0;
+    _abort = false;
+    running = true;
+    mutex.unlock();
+
+    /* Wait for previous run to finish completely before starting again */
+    wait();
+    start(LowestPriority);
+}
+
+void CacheScrubber::abort() {
+    QMutexLocker locker(&mutex);
+    _abort = true;
+    jobs.clear();
+}
+
+void CacheScrubber::run() {
+    forever {
+        mutex.lock();
+
+        /* Everything done */
+        if(_abort || jobs.isEmpty()) {
+            jobs.clear();
+            running = false;
+            mutex.unlock();
+            return;
+        }
+
+        TileKey key = jobs.takeFirst();
+        mutex.unlock();
+
+        /* Tiles waiting for write will be overwritten anyway */
+        if(!MainWindow::instance()->cacheWriteQueue()->pending(key).isEmpty())
+            continue;
+
+        int result = checkTile(key);
+
+        mutex.lock();
+        if(result != Missing) ++checked;
+        if(result == Corrupted) ++corrupted;
+        int currentChecked = checked, currentCorrupted = corrupted;
+        mutex.unlock();
+
+        if(result != Missing) emit progress(currentChecked, total, currentCorrupted);
+
+        /* Limit the rate, also for missing tiles, as their lookup locked the
+           model and cache too */
+        msleep(1000/rate);
+    }
+}
+
+int CacheScrubber::checkTile(const TileKey& key) {
+    Locker<AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForWrite();
+
+    /* Raster model changed meanwhile */
+    if(!rasterModel() || rasterModel()->plugin() != model) {
+        abort();
+        return Missing;
+    }
+
+    Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+    if(!cache()) {
+        abort();
+        return Missing;
+    }
+
+    string data = rasterModel()->tileFromCache(cache(), key.layer.toStdString(), key.zoom, key.coords);
+
+    /* Evicted by the cache meanwhile */
+    if(data.empty()) {
+        cache.unlock();
+        rasterModel.unlock();
+        MainWindow::instance()->cacheIndex()->remove(model, key);
+        return Missing;
+    }
+
+    /* Check the data without holding the locks */
+    cache.unlock();
+    rasterModel.unlock();
+    if(isValid(QByteArray::fromRawData(data.data(), data.size()))) return Valid;
+
+    /* Drop the tile. Valid tile could be written meanwhile, so read and check
+       it again with the locks held. */
+    Locker<AbstractRasterModel> dropModel = MainWindow::instance()->rasterModelForWrite();
+    if(!dropModel() || dropModel()->plugin() != model) return Missing;
+    Locker<AbstractCache> dropCache = MainWindow::instance()->cacheForWrite();
+    if(!dropCache()) return Missing;
+
+    string current = dropModel()->tileFromCache(dropCache(), key.layer.toStdString(), key.zoom, key.coords);
+    if(current.empty()) {
+        dropCache.unlock();
+        dropModel.unlock();
+        MainWindow::instance()->cacheIndex()->remove(model, key);
+        return Missing;
+    }
+    if(current != data && isValid(QByteArray::fromRawData(current.data(), current.size())))
+        return Valid;
+
+    dropModel()->tileToCache(dropCache(), key.layer.toStdString(), key.zoom, key.coords, string());
+    dropCache.unlock();
+    dropModel.unlock();
+    MainWindow::instance()->cacheIndex()->remove(model, key);
+
+    return Corrupted;
+}
+
+}}
@@ -0,0 +1,143 @@
+#ifndef Kompas_QtGui_CacheScrubber_h
+#define Kompas_QtGui_CacheScrubber_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CacheScrubber
+ */
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Cache integrity scrubber
+
+Walks through all tiles of current raster model recorded in CacheIndex and
+checks that they are complete images. PNG, JPEG and GIF tiles are checked for
+valid header and trailer (so truncated tiles are detected without decoding
+them), tiles in other formats are decoded. Corrupted tiles are dropped from
+the cache and the index, so they are downloaded again next time they are
+needed.
+
+Cache plugins can't remove particular tiles, so a corrupted tile is dropped by
+overwriting it with empty data, which is the same as if the tile was not in
+the cache. Tiles waiting in CacheWriteQueue are skipped, as they will be
+overwritten anyway.
+
+The scrubbing is done in lowest priority thread, raster model and cache are
+locked only for reading or dropping one tile and count of checked tiles per
+second is limited, so interactive tile reads are not affected. Scrubbing
+stops when raster model changes.
+@see MainWindow::cacheScrubber()
+
+@configuration
+
+<p>Configuration is stored in <tt>cache</tt> group, see MainWindow class
+documentation.</p>
+<pre>
+[cache]
+
+# Whether to scrub the cache after loading a session
+scrubOnLoad=true
+
+# Delay after loading a session before scrubbing starts, in seconds
+scrubDelay=60
+
+# Max count of checked tiles per second
+scrubRate=20
+</pre>
+*/
+class CacheScrubber: public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Whether tile data are complete image
+         * @param data      Tile data
+         */
+        static bool isValid(const QByteArray& data);
+
+        /**
+         * @brief Constructor
+         * @param parent        Parent object
+         *
+         * Scrubbing rate is taken from configuration.
+         */
+        CacheScrubber(QObject* parent = 0);
+
+        /**
+         * @brief Destructor
+         *
+         * Stops the scrubbing.
+         */
+        virtual ~CacheScrubber();
+
+        /**
+         * @brief Count of tiles checked in last run
+         *
+         * Safe to call while scrubbing.
+         */
+        int checkedCount();
+
+        /**
+         * @brief Count of corrupted tiles dropped in last run
+         *
+         * Safe to call while scrubbing.
+         */
+        int corruptedCount();
+
+        /** @brief Main thread loop */
+        void run();
+
+    public slots:
+        /**
+         * @brief Scrub the cache
+         *
+         * Checks all cached tiles of current raster model. Does nothing if
+         * scrubbing is already in progress.
+         */
+        void scrub();
+
+        /** @brief Stop scrubbing */
+        void abort();
+
+    signals:
+        /**
+         * @brief Scrubbing progress
+         * @param checked       Count of checked tiles
+         * @param total         Count of all tiles to check
+         * @param corrupted     Count of corrupted tiles dropped
+         */
+        void progress(int checked, int total, int corrupted);
+
+    private:
+        QMutex mutex;
+        bool _abort, running;
+        std::string model;
+        QList<TileKey> jobs;
+        int rate, total, checked, corrupted;
+
+        int checkTile(const TileKey& key);
+};
+
+}}
+
+#endif
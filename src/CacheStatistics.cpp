@@ -0,0 +1,300 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheStatistics.h"
+
+#include <QtCore/QTextStream>
+
+#include "AbstractCache.h"
+
+using namespace std;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    QString jsonString(const QString& string) {
+        QString escaped = string;
+        escaped.replace('\\', "\\\\").replace('"', "\\\"");
+        return '"' + escaped + '"';
+    }
+
+    void writeCounters(QTextStream& out, const CacheStatistics::Counters& counters) {
+        out << "\"hits\": " << counters.hits
+            << ", \"misses\": " << counters.misses
+            << ", \"hitRatio\": " << counters.hitRatio()
+            << ", \"readSize\": " << counters.readSize
+            << ", \"writes\": " << counters.writes
+            << ", \"writtenSize\": " << counters.writtenSize
+            << ", \"wastedSize\": " << counters.wastedSize;
+    }
+
+    void writeHistogram(QTextStream& out, const CacheStatistics::Histogram& histogram) {
+        out << "{ \"count\": " << histogram.count()
+            << ", \"average\": " << histogram.average()
+            << ", \"p50\": " << histogram.percentile(0.5)
+            << ", \"p90\": " << histogram.percentile(0.9)
+            << ", \"p99\": " << histogram.percentile(0.99)
+            << ", \"buckets\": [";
+
+        /* Leave out empty buckets at the end */
+        int last = CacheStatistics::Histogram::BucketCount-1;
+        while(last >= 0 && histogram.bucket(last) == 0) --last;
+        for(int i = 0; i <= last; ++i) {
+            if(i != 0) out << ", ";
+            out << "{ \"upperBound\": " << CacheStatistics::Histogram::bucketUpperBound(i) << ", \"count\": " << histogram.bucket(i) << " }";
+        }
+
+        out << "] }";
+    }
+}
+
+CacheStatistics::Histogram::Histogram(): _count(0), sum(0) {
+    for(int i = 0; i != BucketCount; ++i) buckets[i] = 0;
+}
+
+void CacheStatistics::Histogram::add(quint64 value) {
+    int i = 0;
+    while(value >> i && i != BucketCount-1) ++i;
+
+    ++buckets[i];
+    ++_count;
+    sum += value;
+}
+
+quint64 CacheStatistics::Histogram::bucketUpperBound(int i) {
+    return static_cast<quint64>(1) << i;
+}
+
+quint64 CacheStatistics::Histogram::percentile(double fraction) const {
+    if(_count == 0) return 0;
+
+    quint64 position = static_cast<quint64>(fraction*_count);
+    quint64 counted = 0;
+    for(int i = 0; i != BucketCount; ++i) {
+        counted += buckets[i];
+        if(counted > position) return bucketUpperBound(i);
+    }
+
+    return bucketUpperBound(BucketCount-1);
+}
+
+CacheStatistics::Histogram& CacheStatistics::Histogram::operator+=(const Histogram& other) {
+    for(int i = 0; i != BucketCount; ++i) buckets[i] += other.buckets[i];
+    _count += other._count;
+    sum += other.sum;
+    return *this;
+}
+
+CacheStatistics::Counters& CacheStatistics::Counters::operator+=(const Counters& other) {
+    hits += other.hits;
+    misses += other.misses;
+    readSize += other.readSize;
+    writes += other.writes;
+    writtenSize += other.writtenSize;
+    wastedSize += other.wastedSize;
+    return *this;
+}
+
+CacheStatistics::CacheStatistics(): usedSizeBaseline(-1), usedSize(-1), sizeSampleSeen(0) {
+    timer.start();
+}
+
+void CacheStatistics::recordRead(const TileKey& key, size_t size, quint64 time) {
+    QMutexLocker locker(&mutex);
+
+    Counters& c = _counters[LayerZoom(key.layer, key.zoom)];
+    if(size) {
+        ++c.hits;
+        c.readSize += size;
+        addSizeSample(size);
+    } else ++c.misses;
+
+    _readLatency.add(time);
+}
+
+void CacheStatistics::recordWrite(const TileKey& key, size_t size, size_t blockSize, quint64 time) {
+    QMutexLocker locker(&mutex);
+
+    Counters& c = _counters[LayerZoom(key.layer, key.zoom)];
+    ++c.writes;
+    c.writtenSize += size;
+    if(blockSize && size%blockSize)
+        c.wastedSize += blockSize - size%blockSize;
+
+    _writeLatency.add(time);
+    _entrySize.add(size);
+    addSizeSample(size);
+}
+
+void CacheStatistics::recordUsedSize(size_t size) {
+    QMutexLocker locker(&mutex);
+
+    if(usedSizeBaseline == -1) usedSizeBaseline = size;
+    usedSize = size;
+}
+
+void CacheStatistics::reset() {
+    QMutexLocker locker(&mutex);
+
+    _counters.clear();
+    _readLatency = Histogram();
+    _writeLatency = Histogram();
+    _entrySize = Histogram();
+    usedSizeBaseline = -1;
+    usedSize = -1;
+    timer.restart();
+}
+
+QMap<CacheStatistics::LayerZoom, CacheStatistics::Counters> CacheStatistics::counters() {
+    QMutexLocker locker(&mutex);
+    return _counters;
+}
+
+CacheStatistics::Counters CacheStatistics::total() {
+    QMutexLocker locker(&mutex);
+
+    Counters total;
+    foreach(const Counters& c, _counters) total += c;
+    return total;
+}
+
+CacheStatistics::Histogram CacheStatistics::readLatency() {
+    QMutexLocker locker(&mutex);
+    return _readLatency;
+}
+
+CacheStatistics::Histogram CacheStatistics::writeLatency() {
+    QMutexLocker locker(&mutex);
+    return _writeLatency;
+}
+
+CacheStatistics::Histogram CacheStatistics::entrySize() {
+    QMutexLocker locker(&mutex);
+    return _entrySize;
+}
+
+quint64 CacheStatistics::evictedSize() {
+    Counters t = total();
+
+    QMutexLocker locker(&mutex);
+    if(usedSizeBaseline == -1) return 0;
+
+    qint64 evicted = static_cast<qint64>(t.writtenSize+t.wastedSize) - (usedSize-usedSizeBaseline);
+    return evicted > 0 ? evicted : 0;
+}
+
+size_t CacheStatistics::recommendedBlockSize() {
+    QMutexLocker locker(&mutex);
+    if(sizeSample.size() < MinSizeSampleCount) return 0;
+
+    size_t recommended = 0;
+    double minRatio = 0;
+    for(size_t blockSize = 256; blockSize <= 65536; blockSize *= 2) {
+        double ratio = storageRatioInternal(blockSize);
+        if(recommended == 0 || ratio < minRatio) {
+            recommended = blockSize;
+            minRatio = ratio;
+        }
+    }
+
+    return recommended;
+}
+
+double CacheStatistics::storageRatio(size_t blockSize) {
+    QMutexLocker locker(&mutex);
+    if(sizeSample.size() < MinSizeSampleCount || blockSize == 0) return 0;
+    return storageRatioInternal(blockSize);
+}
+
+void CacheStatistics::addSizeSample(size_t size) {
+    ++sizeSampleSeen;
+
+    /* Reservoir sampling, every tile has the same probability to be in the
+       sample */
+    if(sizeSample.size() < SizeSampleCount)
+        sizeSample.push_back(size);
+    else {
+        quint64 i = ((static_cast<quint64>(qrand()) << 31)|qrand()) % sizeSampleSeen;
+        if(i < SizeSampleCount) sizeSample[i] = size;
+    }
+}
+
+double CacheStatistics::storageRatioInternal(size_t blockSize) const {
+    quint64 size = 0, allocated = 0;
+    for(vector<quint32>::const_iterator it = sizeSample.begin(); it != sizeSample.end(); ++it) {
+        quint64 blocks = (*it+blockSize-1)/blockSize;
+        size += *it;
+        allocated += blocks*(blockSize+BlockOverhead);
+    }
+
+    return size == 0 ? 0 : static_cast<double>(allocated)/size;
+}
+
+qint64 CacheStatistics::elapsed() {
+    QMutexLocker locker(&mutex);
+    return timer.elapsed();
+}
+
+QByteArray CacheStatistics::toJson(const AbstractCache* cache) {
+    QMap<LayerZoom, Counters> c = counters();
+    Counters t = total();
+    quint64 evicted = evictedSize();
+    qint64 time = elapsed();
+    size_t recommended = recommendedBlockSize();
+
+    QByteArray json;
+    QTextStream out(&json);
+
+    out << "{\n  \"elapsed\": " << time << ",\n";
+
+    /* Figures provided by the plugin */
+    out << "  \"cache\": ";
+    if(cache) out << "{ \"cacheSize\": " << quint64(cache->cacheSize())
+                  << ", \"usedSize\": " << quint64(cache->usedSize())
+                  << ", \"blockSize\": " << quint64(cache->blockSize()) << " },\n";
+    else out << "null,\n";
+
+    out << "  \"total\": { ";
+    writeCounters(out, t);
+    out << " },\n";
+
+    out << "  \"evictedSize\": " << evicted << ",\n"
+        << "  \"evictionRate\": " << (time == 0 ? 0.0 : evicted*60000.0/time) << ",\n"
+        << "  \"recommendedBlockSize\": " << quint64(recommended) << ",\n"
+        << "  \"fragmentation\": " << (t.writtenSize+t.wastedSize == 0 ? 0.0 : static_cast<double>(t.wastedSize)/(t.writtenSize+t.wastedSize)) << ",\n";
+
+    out << "  \"layers\": [";
+    for(QMap<LayerZoom, Counters>::const_iterator it = c.constBegin(); it != c.constEnd(); ++it) {
+        if(it != c.constBegin()) out << ",";
+        out << "\n    { \"layer\": " << jsonString(it.key().first) << ", \"zoom\": " << it.key().second << ", ";
+        writeCounters(out, *it);
+        out << " }";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"readLatency\": ";
+    writeHistogram(out, readLatency());
+    out << ",\n  \"writeLatency\": ";
+    writeHistogram(out, writeLatency());
+    out << ",\n  \"entrySize\": ";
+    writeHistogram(out, entrySize());
+    out << "\n}\n";
+
+    out.flush();
+    return json;
+}
+
+}}
@@ -0,0 +1,251 @@
+#ifndef Kompas_QtGui_CacheStatistics_h
+#define Kompas_QtGui_CacheStatistics_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CacheStatistics
+ */
+
+#include <vector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+
+#include "TileKey.h"
+
+namespace Kompas {
+
+namespace Core {
+    class AbstractCache;
+}
+
+namespace QtGui {
+
+/**
+@brief Persistent cache usage statistics
+
+Collects counters from tile fetching pipeline (see TileDataThread and
+CacheWriteQueue), as cache plugins don't provide anything beyond used size,
+cache size and block size. Counters are kept separately for each layer and
+zoom level pair. Latencies and entry sizes are collected into histograms with
+power-of-two bucket boundaries.
+
+Evicted size is estimated from written size and growth of cache used size,
+internal fragmentation from sizes of written entries and cache block size.
+Statistics are reset every time the cache is replaced, all functions are
+thread-safe.
+
+Besides that, random sample of sizes of tiles read from and written to the
+cache is kept for recommending cache block size, see recommendedBlockSize().
+The sample depends only on the tiles, not on the cache, so it is not cleared
+on reset.
+@see MainWindow::cacheStatistics()
+*/
+class CacheStatistics {
+    public:
+        /**
+         * @brief Histogram with power-of-two buckets
+         *
+         * Bucket @c i contains values in range @f$ [ 2^{i-1}, 2^i ) @f$,
+         * the first bucket contains zero, the last one all values larger than
+         * @f$ 2^{BucketCount-2} @f$.
+         */
+        class Histogram {
+            public:
+                /** @brief Bucket count */
+                static const int BucketCount = 32;
+
+                /** @brief Constructor */
+                Histogram();
+
+                /** @brief Add value */
+                void add(quint64 value);
+
+                /** @brief Count of values in given bucket */
+                inline quint64 bucket(int i) const { return buckets[i]; }
+
+                /** @brief Upper bound (exclusive) of given bucket */
+                static quint64 bucketUpperBound(int i);
+
+                /** @brief Count of all values */
+                inline quint64 count() const { return _count; }
+
+                /** @brief Average value */
+                inline double average() const {
+                    return _count == 0 ? 0.0 : static_cast<double>(sum)/_count;
+                }
+
+                /**
+                 * @brief Percentile
+                 * @param fraction  Fraction in range @f$ [0, 1] @f$
+                 * @return Upper bound of bucket in which given percentile
+                 *      lies.
+                 */
+                quint64 percentile(double fraction) const;
+
+                /** @brief Add values from another histogram */
+                Histogram& operator+=(const Histogram& other);
+
+            private:
+                quint64 buckets[BucketCount];
+                quint64 _count, sum;
+        };
+
+        /** @brief Counters for one layer and zoom level pair */
+        struct Counters {
+            /** @brief Constructor */
+            inline Counters(): hits(0), misses(0), readSize(0), writes(0), writtenSize(0), wastedSize(0) {}
+
+            quint64 hits,               /**< @brief Lookups found in cache */
+                misses;                 /**< @brief Lookups not found in cache */
+            quint64 readSize;           /**< @brief Size of data read from cache */
+            quint64 writes,             /**< @brief Count of written entries */
+                writtenSize;            /**< @brief Size of written entries */
+
+            /**
+             * @brief Wasted size
+             *
+             * Difference between written size and size of blocks allocated
+             * for the entries.
+             */
+            quint64 wastedSize;
+
+            /** @brief Hit ratio */
+            inline double hitRatio() const {
+                return hits+misses == 0 ? 0.0 : static_cast<double>(hits)/(hits+misses);
+            }
+
+            /** @brief Add counters from another layer and zoom */
+            Counters& operator+=(const Counters& other);
+        };
+
+        /** @brief Max count of tile sizes kept for block size recommendation */
+        static const std::size_t SizeSampleCount = 4096;
+
+        /**
+         * @brief Min count of tile sizes needed for block size recommendation
+         */
+        static const std::size_t MinSizeSampleCount = 128;
+
+        /**
+         * @brief Storage overhead per block
+         *
+         * Estimated size of block index entry and per-block I/O cost in
+         * bytes, used for block size recommendation.
+         */
+        static const std::size_t BlockOverhead = 64;
+
+        /** @brief Layer and zoom level pair */
+        typedef QPair<QString, Core::Zoom> LayerZoom;
+
+        /** @brief Constructor */
+        CacheStatistics();
+
+        /**
+         * @brief Record cache lookup
+         * @param key       Tile
+         * @param size      Size of found data, 0 if not found
+         * @param time      Lookup time in microseconds
+         */
+        void recordRead(const TileKey& key, std::size_t size, quint64 time);
+
+        /**
+         * @brief Record cache write
+         * @param key       Tile
+         * @param size      Data size
+         * @param blockSize Cache block size
+         * @param time      Write time in microseconds
+         */
+        void recordWrite(const TileKey& key, std::size_t size, std::size_t blockSize, quint64 time);
+
+        /**
+         * @brief Record cache used size
+         *
+         * Should be called before and after writing to cache, the first call
+         * after reset is used as baseline for evicted size estimation.
+         */
+        void recordUsedSize(std::size_t size);
+
+        /** @brief Reset all counters except tile size sample */
+        void reset();
+
+        /** @brief Counters for all layer and zoom level pairs */
+        QMap<LayerZoom, Counters> counters();
+
+        /** @brief Counters summed for all layers and zoom levels */
+        Counters total();
+
+        /** @brief Lookup latency histogram, in microseconds */
+        Histogram readLatency();
+
+        /** @brief Write latency histogram, in microseconds */
+        Histogram writeLatency();
+
+        /** @brief Histogram of written entry sizes, in bytes */
+        Histogram entrySize();
+
+        /**
+         * @brief Estimated evicted size
+         *
+         * Written size minus growth of used size since reset.
+         */
+        quint64 evictedSize();
+
+        /**
+         * @brief Recommended block size
+         * @return Block size (power of two between 256 B and 64 kB), which
+         *      results in the smallest storage size for sampled tile sizes,
+         *      including BlockOverhead for each block, or 0 if there is not
+         *      enough samples.
+         */
+        std::size_t recommendedBlockSize();
+
+        /**
+         * @brief Estimated storage size ratio
+         * @param blockSize     Block size
+         * @return Ratio of allocated size (including BlockOverhead) to size
+         *      of sampled tiles for given block size, or 0 if there is not
+         *      enough samples.
+         */
+        double storageRatio(std::size_t blockSize);
+
+        /** @brief Time since reset, in milliseconds */
+        qint64 elapsed();
+
+        /**
+         * @brief Export statistics as JSON
+         * @param cache     Cache for plugin-provided figures (cache size,
+         *      used size and block size), can be null.
+         */
+        QByteArray toJson(const Core::AbstractCache* cache);
+
+    private:
+        QMutex mutex;
+        QElapsedTimer timer;
+        QMap<LayerZoom, Counters> _counters;
+        Histogram _readLatency, _writeLatency, _entrySize;
+        qint64 usedSizeBaseline, usedSize;
+        std::vector<quint32> sizeSample;
+        quint64 sizeSampleSeen;
+
+        void addSizeSample(std::size_t size);
+        double storageRatioInternal(std::size_t blockSize) const;
+};
+
+}}
+
+#endif
@@ -0,0 +1,168 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheWarmer.h"
+
+#include <cmath>
+
+#include "AbstractCache.h"
+#include "AbstractMapView.h"
+#include "CacheIndex.h"
+#include "CacheWriteQueue.h"
+#include "MainWindow.h"
+#include "MemoryCache.h"
+
+using namespace std;
+using namespace Corrade::Utility;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+CacheWarmer::CacheWarmer(QObject* parent): QThread(parent), _abort(false), running(false), loadedSize(0) {
+    ConfigurationGroup* group = MainWindow::instance()->configuration()->group("cache");
+    margin = qMax(0, group->value<int>("warmMargin"));
+    zoomLevels = qMax(0, group->value<int>("warmZoomLevels"));
+}
+
+CacheWarmer::~CacheWarmer() {
+    abort();
+    wait();
+}
+
+void CacheWarmer::warm() {
+    AbstractMapView* mapView = MainWindow::instance()->mapView();
+    if(!mapView) return;
+
+    /* Layer first, then overlays */
+    QStringList layers = mapView->overlays();
+    if(!mapView->layer().isEmpty()) layers.prepend(mapView->layer());
+    Zoom zoom = mapView->zoom();
+    AbsoluteArea<double> viewed = mapView->viewedArea();
+
+    QSharedPointer<const RasterModelSnapshot> rasterModel = MainWindow::instance()->rasterModelSnapshot();
+    if(rasterModel->zoomLevels.empty()) return;
+    const set<Zoom>& available = rasterModel->zoomLevels;
+    TileArea modelArea = rasterModel->area;
+
+    /* Current zoom first, then nearest zoom levels, lower first */
+    vector<Zoom> zooms;
+    for(int distance = 0; distance <= zoomLevels; ++distance) {
+        if(available.find(zoom-distance) != available.end())
+            zooms.push_back(zoom-distance);
+        if(distance != 0 && available.find(zoom+distance) != available.end())
+            zooms.push_back(zoom+distance);
+    }
+
+    QList<TileKey> list;
+    for(vector<Zoom>::const_iterator z = zooms.begin(); z != zooms.end(); ++z) {
+        TileArea area = modelArea*pow2(*z-*available.begin());
+
+        /* Visible tiles */
+        qint64 x1 = qMax<qint64>(area.x, floor(area.x+viewed.x1*area.w));
+        qint64 y1 = qMax<qint64>(area.y, floor(area.y+viewed.y1*area.h));
+        qint64 x2 = qMin<qint64>(area.x+area.w, ceil(area.x+viewed.x2*area.w));
+        qint64 y2 = qMin<qint64>(area.y+area.h, ceil(area.y+viewed.y2*area.h));
+        for(qint64 y = y1; y < y2; ++y) for(qint64 x = x1; x < x2; ++x)
+            foreach(const QString& layer, layers)
+                list.append(TileKey(layer, *z, TileCoords(x, y)));
+
+        /* Tiles in the margin */
+        qint64 marginX1 = qMax<qint64>(area.x, x1-margin);
+        qint64 marginY1 = qMax<qint64>(area.y, y1-margin);
+        qint64 marginX2 = qMin<qint64>(area.x+area.w, x2+margin);
+        qint64 marginY2 = qMin<qint64>(area.y+area.h, y2+margin);
+        for(qint64 y = marginY1; y < marginY2; ++y) for(qint64 x = marginX1; x < marginX2; ++x) {
+            if(x >= x1 && x < x2 && y >= y1 && y < y2) continue;
+
+            foreach(const QString& layer, layers)
+                list.append(TileKey(layer, *z, TileCoords(x, y)));
+        }
+    }
+
+    mutex.lock();
+    jobs = list;
+    _abort = false;
+    loadedSize = 0;
+    bool startThread = !running;
+    running = true;
+    mutex.unlock();
+
+    /* Wait for previous run to finish completely before starting again */
+    if(startThread) {
+        wait();
+        start(LowestPriority);
+    }
+}
+
+void CacheWarmer::abort() {
+    QMutexLocker locker(&mutex);
+    _abort = true;
+    jobs.clear();
+}
+
+void CacheWarmer::run() {
+    MemoryCache* memoryCache = MainWindow::instance()->memoryCache();
+
+    forever {
+        mutex.lock();
+
+        /* Everything done or memory cache is full */
+        if(_abort || jobs.isEmpty() || loadedSize >= memoryCache->maxSize()) {
+            jobs.clear();
+            running = false;
+            mutex.unlock();
+            return;
+        }
+
+        TileKey key = jobs.takeFirst();
+        mutex.unlock();
+
+        if(memoryCache->contains(key)) continue;
+
+        int generation;
+        QByteArray data = tileData(key, generation);
+        if(data.isEmpty()) continue;
+
+        /* Refused, if the raster model was replaced meanwhile */
+        memoryCache->set(key, data, generation, MemoryCache::Prefetch);
+
+        mutex.lock();
+        loadedSize += data.size();
+        mutex.unlock();
+    }
+}
+
+QByteArray CacheWarmer::tileData(const TileKey& key, int& generation) {
+    Locker<AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForWrite();
+    if(!rasterModel()) return QByteArray();
+    generation = MainWindow::instance()->rasterModelGeneration();
+
+    /* Package, tiles waiting for write, cache */
+    string data = rasterModel()->tileFromPackage(key.layer.toStdString(), key.zoom, key.coords);
+    if(data.empty()) {
+        QByteArray pending = MainWindow::instance()->cacheWriteQueue()->pending(key);
+        if(!pending.isEmpty()) return pending;
+
+        Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+        if(cache()) {
+            data = rasterModel()->tileFromCache(cache(), key.layer.toStdString(), key.zoom, key.coords);
+            MainWindow::instance()->cacheIndex()->update(rasterModel()->plugin(), key, !data.empty());
+        }
+    }
+
+    return QByteArray(data.data(), data.size());
+}
+
+}}
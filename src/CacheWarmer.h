@@ -0,0 +1,107 @@
+#ifndef Kompas_QtGui_CacheWarmer_h
+#define Kompas_QtGui_CacheWarmer_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CacheWarmer
+ */
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Cache warmer
+
+Loads tiles around current map view from packages and persistent cache into
+MemoryCache in advance, so the map is displayed complete right after session
+is loaded. Tiles in visible area at current zoom are loaded first, then tiles
+in given margin around it and then tiles in neighbouring zoom levels, nearest
+zoom levels first. Tiles which are not available locally are not downloaded.
+
+The tiles are loaded in low priority thread, raster model and cache are locked
+only for loading one tile, so map display is not blocked. Prefetched tiles
+are added to memory cache with MemoryCache::Prefetch admission, so they never
+evict tiles which are actually used. Warming stops when the size of loaded
+tiles reaches memory cache size or when raster model changes.
+@see MainWindow::cacheWarmer()
+
+@configuration
+
+<p>Configuration is stored in <tt>cache</tt> group, see MainWindow class
+documentation.</p>
+<pre>
+[cache]
+
+# Whether to warm the cache after loading a session
+warmOnLoad=true
+
+# Margin around visible area, in tiles
+warmMargin=1
+
+# Count of neighbouring zoom levels (in each direction) to warm
+warmZoomLevels=1
+</pre>
+*/
+class CacheWarmer: public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param parent        Parent object
+         *
+         * Margin and zoom level count are taken from configuration.
+         */
+        CacheWarmer(QObject* parent = 0);
+
+        /**
+         * @brief Destructor
+         *
+         * Stops the warming.
+         */
+        virtual ~CacheWarmer();
+
+        /** @brief Main thread loop */
+        void run();
+
+    public slots:
+        /**
+         * @brief Warm the cache for current map view
+         *
+         * Replaces previously scheduled tiles, if there are any.
+         */
+        void warm();
+
+        /** @brief Stop warming */
+        void abort();
+
+    private:
+        QMutex mutex;
+        bool _abort, running;
+        QList<TileKey> jobs;
+        int margin, zoomLevels, loadedSize;
+
+        QByteArray tileData(const TileKey& key, int& generation);
+};
+
+}}
+
+#endif
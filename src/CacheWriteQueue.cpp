@@ -0,0 +1,183 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheWriteQueue.h"
+
+#include <climits>
+
+#include "AbstractCache.h"
+#include "CacheIndex.h"
+#include "CachePolicy.h"
+#include "CacheStatistics.h"
+#include "MainWindow.h"
+
+using namespace std;
+using namespace Corrade::Utility;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+CacheWriteQueue::CacheWriteQueue(QObject* parent): QThread(parent), _abort(false), size(0), dropped(0) {
+    ConfigurationGroup* group = MainWindow::instance()->configuration()->group("cache");
+    batchSize = qMax(1, group->value<int>("writeBatchSize"));
+    delay = qMax(0, group->value<int>("writeDelay"));
+    maxSize = qMax(0, group->value<int>("writeQueueSize"))*1024;
+}
+
+CacheWriteQueue::~CacheWriteQueue() {
+    mutex.lock();
+    _abort = true;
+    condition.wakeOne();
+    mutex.unlock();
+
+    wait();
+
+    flush();
+}
+
+bool CacheWriteQueue::enqueue(const TileKey& key, const QByteArray& data, int generation) {
+    /* Fetched with previous raster model */
+    if(generation != MainWindow::instance()->rasterModelGeneration())
+        return false;
+
+    /* Quota exceeded or refused by policy */
+    if(!MainWindow::instance()->cachePolicy()->admit(key, data.size()))
+        return false;
+
+    QMutexLocker locker(&mutex);
+
+    /* Merge with previous data for the same tile */
+    QHash<TileKey, Entry>::iterator found = entries.find(key);
+    int previousSize = found == entries.end() ? 0 : found->data.size();
+
+    /* Queue is full, drop the tile */
+    if(size-previousSize+data.size() > maxSize) {
+        ++dropped;
+        return false;
+    }
+
+    if(entries.isEmpty()) oldest.start();
+    entries.insert(key, Entry(data, generation));
+    size += data.size()-previousSize;
+
+    /* If the thread is not running, start it, otherwise wake it up to start
+       waiting for the delay or if the batch is full */
+    if(!isRunning()) start(LowPriority);
+    else if(entries.size() == 1 || entries.size() >= batchSize) condition.wakeOne();
+
+    return true;
+}
+
+QByteArray CacheWriteQueue::pending(const TileKey& key) {
+    int generation = MainWindow::instance()->rasterModelGeneration();
+
+    QMutexLocker locker(&mutex);
+
+    QHash<TileKey, Entry>::const_iterator found = entries.constFind(key);
+    if(found != entries.constEnd() && found->generation == generation) return found->data;
+
+    found = writing.constFind(key);
+    if(found != writing.constEnd() && found->generation == generation) return found->data;
+
+    return QByteArray();
+}
+
+void CacheWriteQueue::flush() {
+    write();
+}
+
+void CacheWriteQueue::clear() {
+    QMutexLocker locker(&mutex);
+    entries.clear();
+    size = 0;
+}
+
+quint64 CacheWriteQueue::droppedCount() {
+    QMutexLocker locker(&mutex);
+    return dropped;
+}
+
+void CacheWriteQueue::run() {
+    forever {
+        mutex.lock();
+
+        /* Wait until the batch is full or the oldest tile waits long enough */
+        if(!_abort && entries.size() < batchSize && (entries.isEmpty() || oldest.elapsed() < delay))
+            condition.wait(&mutex, entries.isEmpty() ? ULONG_MAX : qMax<qint64>(0, delay-oldest.elapsed()));
+
+        if(_abort) {
+            mutex.unlock();
+            return;
+        }
+
+        bool due = entries.size() >= batchSize || (!entries.isEmpty() && oldest.elapsed() >= delay);
+        mutex.unlock();
+
+        if(due) write();
+    }
+}
+
+void CacheWriteQueue::write() {
+    /* Only one write at a time, so flush() waits for running batch */
+    QMutexLocker writeLocker(&writeMutex);
+
+    mutex.lock();
+    writing = entries;
+    entries.clear();
+    size = 0;
+    QHash<TileKey, Entry> batch = writing;
+    mutex.unlock();
+
+    /* Write in batches, release the locks in between */
+    QHash<TileKey, Entry>::const_iterator it = batch.constBegin();
+    while(it != batch.constEnd()) {
+        Locker<AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForWrite();
+        if(!rasterModel()) break;
+        Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+        if(!cache()) break;
+
+        CacheStatistics* statistics = MainWindow::instance()->cacheStatistics();
+        statistics->recordUsedSize(cache()->usedSize());
+        CachePolicy* policy = MainWindow::instance()->cachePolicy();
+        policy->setCacheSize(cache()->cacheSize());
+
+        CacheIndex* index = MainWindow::instance()->cacheIndex();
+        string model = rasterModel()->plugin();
+
+        /* Model is locked, so the generation can't change during the batch */
+        int generation = MainWindow::instance()->rasterModelGeneration();
+
+        QElapsedTimer timer;
+        for(int i = 0; i != batchSize && it != batch.constEnd(); ++i, ++it) {
+            /* Tile of previous raster model, its key would be wrong */
+            if(it->generation != generation) continue;
+
+            timer.start();
+            if(!rasterModel()->tileToCache(cache(), it.key().layer.toStdString(), it.key().zoom, it.key().coords, string(it->data.constData(), it->data.size())))
+                continue;
+            statistics->recordWrite(it.key(), it->data.size(), cache()->blockSize(), timer.nsecsElapsed()/1000);
+            policy->written(it.key(), it->data.size());
+            index->insert(model, it.key());
+        }
+
+        statistics->recordUsedSize(cache()->usedSize());
+    }
+
+    mutex.lock();
+    writing.clear();
+    mutex.unlock();
+}
+
+}}
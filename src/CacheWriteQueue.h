@@ -0,0 +1,154 @@
+#ifndef Kompas_QtGui_CacheWriteQueue_h
+#define Kompas_QtGui_CacheWriteQueue_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::CacheWriteQueue
+ */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Write-behind queue for cache
+
+Downloaded tiles are not written to cache immediately, but put into this
+queue, so the thread which fetches tiles doesn't wait for disk writes. Pending
+tiles are merged (later data for the same tile replace earlier) and written in
+batches from separate thread, when batch size or delay threshold is reached.
+The writes are done with current raster model and cache locked for writing,
+locks are released after each batch, so other threads can read tiles in
+between.
+
+Adding tiles never blocks, if the queue is full, the tile is dropped and not
+cached at all. Tiles which are waiting for write can be retrieved with
+pending(), so they are not downloaded again in the meantime.
+
+Because cache keys are generated by raster model, the queue must be flushed
+before raster model or cache is changed, which is done in
+MainWindow::setRasterModel() and MainWindow::setCache(). Tiles can still be
+added after the flush by threads which fetched them with previous raster
+model, so each tile is tagged with raster model generation it was fetched
+with (see MainWindow::rasterModelGeneration()) and tiles of previous
+generations are neither written nor returned from pending().
+@see MainWindow::cacheWriteQueue()
+
+@configuration
+
+<p>Configuration is stored in <tt>cache</tt> group, see MainWindow class
+documentation.</p>
+<pre>
+[cache]
+
+# Count of tiles written to cache at once
+writeBatchSize=32
+
+# Max time in milliseconds for which the tiles wait before written to cache
+writeDelay=2000
+
+# Max size of tiles waiting for write, in kilobytes. If exceeded, newly added
+# tiles are not cached.
+writeQueueSize=8192
+</pre>
+*/
+class CacheWriteQueue: public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param parent        Parent object
+         *
+         * Thresholds are taken from configuration.
+         */
+        CacheWriteQueue(QObject* parent = 0);
+
+        /**
+         * @brief Destructor
+         *
+         * Stops the thread and writes all pending tiles.
+         */
+        virtual ~CacheWriteQueue();
+
+        /**
+         * @brief Add tile to the queue
+         * @param key           Tile
+         * @param data          Tile data
+         * @param generation    Raster model generation with which the tile
+         *      was fetched
+         * @return False if the tile is from previous raster model, was
+         *      refused by CachePolicy or the queue is full and the tile was
+         *      dropped
+         *
+         * If the tile is already in the queue, its data are replaced. Never
+         * waits for running writes.
+         */
+        bool enqueue(const TileKey& key, const QByteArray& data, int generation);
+
+        /**
+         * @brief Data of tile waiting for write
+         * @return Tile data or empty array, if the tile is not in the queue
+         */
+        QByteArray pending(const TileKey& key);
+
+        /**
+         * @brief Write all pending tiles
+         *
+         * Blocks until everything is written.
+         */
+        void flush();
+
+        /** @brief Discard all pending tiles */
+        void clear();
+
+        /** @brief Count of tiles dropped because the queue was full */
+        quint64 droppedCount();
+
+        /** @brief Main thread loop */
+        void run();
+
+    private:
+        struct Entry {
+            inline Entry(const QByteArray& _data = QByteArray(), int _generation = 0): data(_data), generation(_generation) {}
+
+            QByteArray data;
+            int generation;
+        };
+
+        QMutex mutex, writeMutex;
+        QWaitCondition condition;
+        bool _abort;
+
+        int batchSize, delay, maxSize;
+
+        QHash<TileKey, Entry> entries, writing;
+        int size;
+        quint64 dropped;
+        QElapsedTimer oldest;
+
+        void write();
+};
+
+}}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "LockProfiler.h"
+
+#include <algorithm>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTextStream>
+
+using namespace std;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    bool longerWait(const QPair<QString, LockProfiler::Site>& a, const QPair<QString, LockProfiler::Site>& b) {
+        return a.second.waitTime > b.second.waitTime;
+    }
+
+    /* Nanoseconds to milliseconds */
+    inline double ms(quint64 time) { return time/1000000.0; }
+}
+
+LockProfiler::Site& LockProfiler::Site::operator+=(const Site& other) {
+    reads += other.reads;
+    writes += other.writes;
+    waitTime += other.waitTime;
+    maxWaitTime = qMax(maxWaitTime, other.maxWaitTime);
+    holdTime += other.holdTime;
+    maxHoldTime = qMax(maxHoldTime, other.maxHoldTime);
+    return *this;
+}
+
+LockProfiler* LockProfiler::instance() {
+    static LockProfiler profiler;
+    return &profiler;
+}
+
+void LockProfiler::setName(const QReadWriteLock* lock, const QString& name) {
+    QMutexLocker locker(&mutex);
+    data[lock].name = name;
+}
+
+void LockProfiler::record(const QReadWriteLock* lock, const char* file, int line, bool write, qint64 waitTime, qint64 holdTime) {
+    QMutexLocker locker(&mutex);
+
+    Lock& l = data[lock];
+    if(l.name.isEmpty()) l.name = QString("0x%0").arg(reinterpret_cast<quintptr>(lock), 0, 16);
+
+    Site& site = l.sites[SiteKey(file, line)];
+    if(write) ++site.writes;
+    else ++site.reads;
+    site.waitTime += waitTime;
+    site.maxWaitTime = qMax<quint64>(site.maxWaitTime, waitTime);
+    site.holdTime += holdTime;
+    site.maxHoldTime = qMax<quint64>(site.maxHoldTime, holdTime);
+}
+
+QStringList LockProfiler::locks() {
+    QMutexLocker locker(&mutex);
+
+    QStringList names;
+    foreach(const Lock& lock, data) names.append(lock.name);
+    return names;
+}
+
+LockProfiler::Site LockProfiler::total(const QString& lock) {
+    QMutexLocker locker(&mutex);
+
+    Site total;
+    const Lock* l = find(lock);
+    if(l) foreach(const Site& site, l->sites) total += site;
+    return total;
+}
+
+QList<QPair<QString, LockProfiler::Site> > LockProfiler::sites(const QString& lock, int count) {
+    QMutexLocker locker(&mutex);
+
+    QList<QPair<QString, Site> > sites;
+    const Lock* l = find(lock);
+    if(!l) return sites;
+
+    for(QHash<SiteKey, Site>::const_iterator it = l->sites.constBegin(); it != l->sites.constEnd(); ++it) {
+        QString name = it.key().first ?
+            QString("%0:%1").arg(QFileInfo(QString::fromUtf8(it.key().first)).fileName()).arg(it.key().second) :
+            QString("?");
+        sites.append(qMakePair(name, it.value()));
+    }
+
+    stable_sort(sites.begin(), sites.end(), longerWait);
+    if(count != 0 && sites.size() > count) sites.erase(sites.begin()+count, sites.end());
+    return sites;
+}
+
+QString LockProfiler::report(int count) {
+    QString out;
+    QTextStream s(&out);
+
+    foreach(const QString& lock, locks()) {
+        Site t = total(lock);
+        s << lock << ": " << t.reads << " reads, " << t.writes << " writes, wait "
+          << ms(t.waitTime) << " ms (max " << ms(t.maxWaitTime) << " ms), hold "
+          << ms(t.holdTime) << " ms (max " << ms(t.maxHoldTime) << " ms)\n";
+
+        QList<QPair<QString, Site> > list = sites(lock, count);
+        for(int i = 0; i != list.size(); ++i) {
+            const Site& site = list[i].second;
+            s << "    " << list[i].first << ": " << site.reads << " reads, "
+              << site.writes << " writes, wait " << ms(site.waitTime)
+              << " ms (max " << ms(site.maxWaitTime) << " ms), hold "
+              << ms(site.holdTime) << " ms (max " << ms(site.maxHoldTime) << " ms)\n";
+        }
+    }
+
+    s.flush();
+    return out;
+}
+
+bool LockProfiler::save(const QString& filename, int count) {
+    QFile file(filename);
+    if(!file.open(QFile::WriteOnly|QFile::Truncate|QFile::Text)) return false;
+
+    file.write(report(count).toUtf8());
+    return true;
+}
+
+void LockProfiler::reset() {
+    QMutexLocker locker(&mutex);
+    for(QHash<const QReadWriteLock*, Lock>::iterator it = data.begin(); it != data.end(); ++it)
+        it->sites.clear();
+}
+
+const LockProfiler::Lock* LockProfiler::find(const QString& name) const {
+    for(QHash<const QReadWriteLock*, Lock>::const_iterator it = data.constBegin(); it != data.constEnd(); ++it)
+        if(it->name == name) return &it.value();
+    return 0;
+}
+
+}}
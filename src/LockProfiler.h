@@ -0,0 +1,139 @@
+#ifndef Kompas_QtGui_LockProfiler_h
+#define Kompas_QtGui_LockProfiler_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::LockProfiler
+ */
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+class QReadWriteLock;
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Lock profiler
+
+Collects wait and hold times of locks accessed through Locker, split by
+call site of the function which created the locker (e.g.
+MainWindow::rasterModelForWrite()). Available only if %Kompas is built with
+<tt>LOCK_PROFILING</tt> CMake option, which defines
+<tt>KOMPAS_LOCK_PROFILING</tt> preprocessor macro. Call sites are recorded
+using <tt>__builtin_FILE()</tt> and <tt>__builtin_LINE()</tt>, so the
+instrumented build needs GCC 4.8 or Clang.
+
+The statistics can be viewed in LockProfilerDialog (accessible from Tools
+menu) and saved to a text file. If <tt>KOMPAS_LOCK_PROFILE</tt> environment
+variable is set, the statistics are saved into file with that name on
+application exit. All functions are thread-safe.
+*/
+class LockProfiler {
+    public:
+        /** @brief Statistics of one call site */
+        struct Site {
+            /** @brief Constructor */
+            inline Site(): reads(0), writes(0), waitTime(0), maxWaitTime(0), holdTime(0), maxHoldTime(0) {}
+
+            quint64 reads,              /**< @brief Count of read locks */
+                writes;                 /**< @brief Count of write locks */
+            quint64 waitTime,           /**< @brief Total time waited for the lock, in nanoseconds */
+                maxWaitTime;            /**< @brief Longest wait for the lock, in nanoseconds */
+            quint64 holdTime,           /**< @brief Total time the lock was held, in nanoseconds */
+                maxHoldTime;            /**< @brief Longest hold of the lock, in nanoseconds */
+
+            /** @brief Add statistics of another site */
+            Site& operator+=(const Site& other);
+        };
+
+        /** @brief Global instance */
+        static LockProfiler* instance();
+
+        /**
+         * @brief Set lock name
+         *
+         * Locks without name are reported by address.
+         */
+        void setName(const QReadWriteLock* lock, const QString& name);
+
+        /**
+         * @brief Record lock usage
+         * @param lock      Lock
+         * @param file      File of the call site or 0 if unknown
+         * @param line      Line of the call site
+         * @param write     Whether the lock was locked for writing
+         * @param waitTime  Time waited for the lock, in nanoseconds
+         * @param holdTime  Time the lock was held, in nanoseconds
+         *
+         * Called from Locker::unlock().
+         */
+        void record(const QReadWriteLock* lock, const char* file, int line, bool write, qint64 waitTime, qint64 holdTime);
+
+        /** @brief Names of all recorded locks */
+        QStringList locks();
+
+        /** @brief Statistics of all call sites of given lock */
+        Site total(const QString& lock);
+
+        /**
+         * @brief Top call sites of given lock
+         * @param lock      Lock name
+         * @param count     Max count of returned sites, 0 for all
+         *
+         * Call sites formatted as <tt>file:line</tt>, sorted by total wait
+         * time, longest first.
+         */
+        QList<QPair<QString, Site> > sites(const QString& lock, int count = 0);
+
+        /**
+         * @brief Text report
+         * @param count     Max count of call sites for each lock, 0 for all
+         */
+        QString report(int count = 10);
+
+        /**
+         * @brief Save text report into file
+         * @param filename  File name
+         * @param count     Max count of call sites for each lock, 0 for all
+         * @return Whether the file was successfully written
+         */
+        bool save(const QString& filename, int count = 0);
+
+        /** @brief Reset all statistics */
+        void reset();
+
+    private:
+        typedef QPair<const char*, int> SiteKey;
+
+        struct Lock {
+            QString name;
+            QHash<SiteKey, Site> sites;
+        };
+
+        QMutex mutex;
+        QHash<const QReadWriteLock*, Lock> data;
+
+        const Lock* find(const QString& name) const;
+};
+
+}}
+
+#endif
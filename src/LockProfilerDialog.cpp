@@ -0,0 +1,112 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "LockProfilerDialog.h"
+
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QFileDialog>
+#include <QtGui/QHeaderView>
+#include <QtGui/QPushButton>
+#include <QtGui/QTreeWidget>
+#include <QtGui/QVBoxLayout>
+
+#include "LockProfiler.h"
+#include "MessageBox.h"
+
+#ifdef _WIN32
+#undef MessageBox /* I fucking hate windows.h defines! */
+#endif
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    /* Top call sites displayed for each lock */
+    const int siteCount = 20;
+
+    void setColumns(QTreeWidgetItem* item, const LockProfiler::Site& site) {
+        item->setText(1, QString::number(site.reads));
+        item->setText(2, QString::number(site.writes));
+        item->setText(3, QString::number(site.waitTime/1000000.0, 'f', 2));
+        item->setText(4, QString::number(site.maxWaitTime/1000000.0, 'f', 2));
+        item->setText(5, QString::number(site.holdTime/1000000.0, 'f', 2));
+        item->setText(6, QString::number(site.maxHoldTime/1000000.0, 'f', 2));
+        for(int i = 1; i != 7; ++i)
+            item->setTextAlignment(i, Qt::AlignRight);
+    }
+}
+
+LockProfilerDialog::LockProfilerDialog(QWidget* parent, Qt::WindowFlags f): QDialog(parent, f) {
+    locks = new QTreeWidget;
+    locks->setHeaderLabels(QStringList() << tr("Lock / call site") << tr("Reads") << tr("Writes") << tr("Wait (ms)") << tr("Max wait (ms)") << tr("Hold (ms)") << tr("Max hold (ms)"));
+    locks->header()->setResizeMode(QHeaderView::ResizeToContents);
+
+    QPushButton* refreshButton = new QPushButton(tr("Refresh"));
+    QPushButton* resetButton = new QPushButton(tr("Reset"));
+    QPushButton* saveButton = new QPushButton(tr("Save..."));
+    connect(refreshButton, SIGNAL(clicked(bool)), SLOT(refresh()));
+    connect(resetButton, SIGNAL(clicked(bool)), SLOT(reset()));
+    connect(saveButton, SIGNAL(clicked(bool)), SLOT(save()));
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    buttons->addButton(refreshButton, QDialogButtonBox::ActionRole);
+    buttons->addButton(resetButton, QDialogButtonBox::ResetRole);
+    buttons->addButton(saveButton, QDialogButtonBox::ActionRole);
+    connect(buttons, SIGNAL(rejected()), SLOT(reject()));
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addWidget(locks);
+    layout->addWidget(buttons);
+    setLayout(layout);
+
+    setWindowTitle(tr("Lock profiler"));
+    resize(720, 400);
+
+    refresh();
+}
+
+void LockProfilerDialog::refresh() {
+    locks->clear();
+
+    LockProfiler* profiler = LockProfiler::instance();
+    foreach(const QString& lock, profiler->locks()) {
+        QTreeWidgetItem* lockItem = new QTreeWidgetItem(locks);
+        lockItem->setText(0, lock);
+        setColumns(lockItem, profiler->total(lock));
+
+        QList<QPair<QString, LockProfiler::Site> > sites = profiler->sites(lock, siteCount);
+        for(int i = 0; i != sites.size(); ++i) {
+            QTreeWidgetItem* siteItem = new QTreeWidgetItem(lockItem);
+            siteItem->setText(0, sites[i].first);
+            setColumns(siteItem, sites[i].second);
+        }
+
+        lockItem->setExpanded(true);
+    }
+}
+
+void LockProfilerDialog::reset() {
+    LockProfiler::instance()->reset();
+    refresh();
+}
+
+void LockProfilerDialog::save() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save lock statistics"), QString(), tr("Text files (*.txt)"));
+    if(filename.isEmpty()) return;
+
+    if(!LockProfiler::instance()->save(filename))
+        MessageBox::warning(this, tr("Cannot save statistics"), tr("Cannot write to file <strong>%0</strong>.").arg(filename));
+}
+
+}}
@@ -0,0 +1,59 @@
+#ifndef Kompas_QtGui_LockProfilerDialog_h
+#define Kompas_QtGui_LockProfilerDialog_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::LockProfilerDialog
+ */
+
+#include <QtGui/QDialog>
+
+class QTreeWidget;
+
+namespace Kompas { namespace QtGui {
+
+/**
+ * @brief Lock profiler dialog
+ *
+ * Displays statistics collected by LockProfiler for each lock and its top
+ * call sites. Available only in builds with lock profiling enabled.
+ */
+class LockProfilerDialog: public QDialog {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param parent        Parent widget
+         * @param f             Window flags
+         */
+        LockProfilerDialog(QWidget* parent = 0, Qt::WindowFlags f = 0);
+
+    public slots:
+        /** @brief Refresh displayed statistics */
+        void refresh();
+
+    private slots:
+        void reset();
+        void save();
+
+    private:
+        QTreeWidget* locks;
+};
+
+}}
+
+#endif
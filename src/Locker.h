@@ -21,6 +21,19 @@
 
 #include <QtCore/QReadWriteLock>
 
+#ifdef KOMPAS_LOCK_PROFILING
+#include <QtCore/QElapsedTimer>
+#include "LockProfiler.h"
+
+/* Parameters for functions creating lockers, so the call site of the function
+   is recorded in LockProfiler */
+#define KOMPAS_LOCKER_CALL_SITE const char* _file = __builtin_FILE(), int _line = __builtin_LINE()
+#define KOMPAS_LOCKER_PASS_CALL_SITE , _file, _line
+#else
+#define KOMPAS_LOCKER_CALL_SITE
+#define KOMPAS_LOCKER_PASS_CALL_SITE
+#endif
+
 namespace Kompas { namespace QtGui {
 
 /**
@@ -58,6 +71,19 @@ Locker<const MyData> data = lockForRead();
 data()->doSomething();
 data()->doSomethingAnother();
 @endcode
+
+@section Locker-profiling Profiling
+If built with <tt>LOCK_PROFILING</tt> CMake option, each locker measures how
+long it waited for the lock and how long the lock was held and reports it to
+LockProfiler on unlock. Functions creating the lockers can pass their call
+site to the locker using @c KOMPAS_LOCKER_CALL_SITE and
+@c KOMPAS_LOCKER_PASS_CALL_SITE macros, which expand to nothing in normal
+build:
+@code
+Locker<MyData> lockForWrite(KOMPAS_LOCKER_CALL_SITE) {
+    return Locker<MyData>(myData, readWriteLock KOMPAS_LOCKER_PASS_CALL_SITE);
+}
+@endcode
 */
 template<class T> class Locker {
     public:
@@ -73,7 +99,11 @@ template<class T> class Locker {
          * @param data          Pointer to data
          * @param lock          Pointer to read-write lock instance
          */
+        #ifndef KOMPAS_LOCK_PROFILING
         inline Locker(T* data, QReadWriteLock* lock): _state(Fresh), _data(data), _lock(lock) {}
+        #else
+        inline Locker(T* data, QReadWriteLock* lock, const char* file = 0, int line = 0): _state(Fresh), _data(data), _lock(lock), _file(file), _line(line), _waitTime(0) {}
+        #endif
 
         /**
          * @brief Copy constructor
@@ -83,7 +113,11 @@ template<class T> class Locker {
          * @attention Avoid using original and copied locker simultaenously.
          *      When copying the locker, always destroy the original instance.
          */
-        inline Locker(const Locker<T>& other): _state(other.state() == Fresh ? Fresh : Unlocked), _data(other._data), _lock(other._lock) {}
+        inline Locker(const Locker<T>& other): _state(other.state() == Fresh ? Fresh : Unlocked), _data(other._data), _lock(other._lock)
+            #ifdef KOMPAS_LOCK_PROFILING
+            , _file(other._file), _line(other._line), _waitTime(0)
+            #endif
+            {}
 
         /**
          * @brief Destructor
@@ -108,6 +142,11 @@ template<class T> class Locker {
             _state = other.state() == Fresh ? Fresh : Unlocked;
             _data = other._data;
             _lock = other._lock;
+            #ifdef KOMPAS_LOCK_PROFILING
+            _file = other._file;
+            _line = other._line;
+            #endif
+            return *this;
         }
 
         /**
@@ -119,8 +158,16 @@ template<class T> class Locker {
         T* operator()() {
             /* If lock is in fresh state, lock it */
             if(_state == Fresh) {
+                #ifdef KOMPAS_LOCK_PROFILING
+                QElapsedTimer timer;
+                timer.start();
+                #endif
                 _lock->lockForWrite();
                 _state = Locked;
+                #ifdef KOMPAS_LOCK_PROFILING
+                _waitTime = timer.nsecsElapsed();
+                _held.start();
+                #endif
             }
 
             return _state == Locked ? _data : 0;
@@ -134,13 +181,25 @@ template<class T> class Locker {
         inline void unlock() {
             if(_state != Locked) return;
             _state = Unlocked;
+            #ifndef KOMPAS_LOCK_PROFILING
             _lock->unlock();
+            #else
+            qint64 holdTime = _held.nsecsElapsed();
+            _lock->unlock();
+            LockProfiler::instance()->record(_lock, _file, _line, true, _waitTime, holdTime);
+            #endif
         }
 
     private:
         State _state;
         T* _data;
         QReadWriteLock* _lock;
+        #ifdef KOMPAS_LOCK_PROFILING
+        const char* _file;
+        int _line;
+        qint64 _waitTime;
+        QElapsedTimer _held;
+        #endif
 };
 
 #ifndef DOXYGEN_GENERATING_OUTPUT
@@ -152,9 +211,17 @@ template<class T> class Locker<const T> {
             Unlocked
         };
 
+        #ifndef KOMPAS_LOCK_PROFILING
         inline Locker(const T* data, QReadWriteLock* lock): _state(Fresh), _data(data), _lock(lock) {}
+        #else
+        inline Locker(const T* data, QReadWriteLock* lock, const char* file = 0, int line = 0): _state(Fresh), _data(data), _lock(lock), _file(file), _line(line), _waitTime(0) {}
+        #endif
 
-        inline Locker(const Locker<const T>& other): _state(other.state() == Fresh ? Fresh : Unlocked), _data(other._data), _lock(other._lock) {}
+        inline Locker(const Locker<const T>& other): _state(other.state() == Fresh ? Fresh : Unlocked), _data(other._data), _lock(other._lock)
+            #ifdef KOMPAS_LOCK_PROFILING
+            , _file(other._file), _line(other._line), _waitTime(0)
+            #endif
+            {}
 
         inline ~Locker() { unlock(); }
 
@@ -165,13 +232,26 @@ template<class T> class Locker<const T> {
             _state = other.state() == Fresh ? Fresh : Unlocked;
             _data = other._data;
             _lock = other._lock;
+            #ifdef KOMPAS_LOCK_PROFILING
+            _file = other._file;
+            _line = other._line;
+            #endif
+            return *this;
         }
 
         const T* operator()() {
             /* If lock is in fresh state, lock it */
             if(_state == Fresh) {
+                #ifdef KOMPAS_LOCK_PROFILING
+                QElapsedTimer timer;
+                timer.start();
+                #endif
                 _lock->lockForRead();
                 _state = Locked;
+                #ifdef KOMPAS_LOCK_PROFILING
+                _waitTime = timer.nsecsElapsed();
+                _held.start();
+                #endif
             }
 
             return _state == Locked ? _data : 0;
@@ -180,13 +260,25 @@ template<class T> class Locker<const T> {
         inline void unlock() {
             if(_state != Locked) return;
             _state = Unlocked;
+            #ifndef KOMPAS_LOCK_PROFILING
+            _lock->unlock();
+            #else
+            qint64 holdTime = _held.nsecsElapsed();
             _lock->unlock();
+            LockProfiler::instance()->record(_lock, _file, _line, false, _waitTime, holdTime);
+            #endif
         }
 
     private:
         State _state;
         const T* _data;
         QReadWriteLock* _lock;
+        #ifdef KOMPAS_LOCK_PROFILING
+        const char* _file;
+        int _line;
+        qint64 _waitTime;
+        QElapsedTimer _held;
+        #endif
 };
 #endif
 
@@ -16,21 +16,37 @@
 #include "MainWindow.h"
 
 #include <QtCore/QtConcurrentRun>
-#ifdef _WIN32
+#include <QtCore/QDebug>
+#include <QtCore/QTimer>
+#include <QtGui/QAction>
 #include <QtGui/QApplication>
-#endif
+#include <QtGui/QFileDialog>
 #include <QtGui/QMenuBar>
 #include <QtGui/QStatusBar>
 #include <QtGui/QDockWidget>
 
 #include "Utility/Directory.h"
 #include "MainWindowConfigure.h"
+#include "CacheIndex.h"
+#include "CachePolicy.h"
+#include "CacheStatistics.h"
+#include "CacheScrubber.h"
+#include "CacheWarmer.h"
+#include "CacheWriteQueue.h"
+#include "MemoryCache.h"
 #include "TileDataThread.h"
 #include "RasterPackageModel.h"
 #include "RasterLayerModel.h"
 #include "RasterOverlayModel.h"
 #include "RasterZoomModel.h"
 #include "PluginManagerStore.h"
+#include "TileTracer.h"
+#include "MessageBox.h"
+
+#ifdef KOMPAS_LOCK_PROFILING
+#include "LockProfiler.h"
+#include "LockProfilerDialog.h"
+#endif
 
 using namespace std;
 using namespace Corrade::Utility;
@@ -40,8 +56,9 @@ namespace Kompas { namespace QtGui {
 
 MainWindow* MainWindow::_instance;
 
-MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags): QMainWindow(parent, flags), _configuration(Directory::join(Directory::configurationDir("Kompas"), "kompas.conf")), _mapView(0), _cache(0), _rasterModel(0) {
+MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags): QMainWindow(parent, flags), _configuration(Directory::join(Directory::configurationDir("Kompas"), "kompas.conf")), _mapView(0), _cache(0), _cacheIndex(0), _cachePolicy(0), _cacheStatistics(0), _cacheWriteQueue(0), _memoryCache(0), _cacheWarmer(0), _cacheScrubber(0), _rasterModel(0), logStartupTimings(false), startupPhaseEnd(0) {
     _instance = this;
+    startupTimer.start();
 
     /* Window icon */
     QIcon icon;
@@ -55,10 +72,13 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags): QMainWindow(pare
 
     /* Load default configuration */
     loadDefaultConfiguration();
+    logStartupTimings = _configuration.group("startup")->value<bool>("logTimings");
+    startupPhase("configuration");
 
     _sessionManager = new SessionManager(_configuration.group("sessions"));
 
     _pluginManagerStore = new PluginManagerStore(_configuration.group("plugins"), this);
+    startupPhase("plugin loading");
 
     _rasterPackageModel = new RasterPackageModel(this);
     _rasterLayerModel = new RasterLayerModel(this);
@@ -67,29 +87,110 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags): QMainWindow(pare
 
     TileDataThread::setMaxSimultaenousDownloads(_configuration.group("map")->value<int>("maxSimultaenousDownloads"));
 
+    _rasterModelSnapshot = QSharedPointer<const RasterModelSnapshot>(new RasterModelSnapshot);
+
+    #ifdef KOMPAS_LOCK_PROFILING
+    LockProfiler::instance()->setName(&rasterModelLock, tr("Raster model"));
+    LockProfiler::instance()->setName(&cacheLock, tr("Cache"));
+    #endif
+
+    _cacheIndex = new CacheIndex;
+    _cachePolicy = new CachePolicy;
+    _cacheStatistics = new CacheStatistics;
+    _cacheWriteQueue = new CacheWriteQueue(this);
+    _memoryCache = new MemoryCache(this);
+    connect(this, SIGNAL(rasterModelChanged(const Core::AbstractRasterModel*)), _memoryCache, SLOT(clear()));
+    _cacheWarmer = new CacheWarmer(this);
+    connect(this, SIGNAL(rasterModelChanged(const Core::AbstractRasterModel*)), _cacheWarmer, SLOT(abort()));
+    _cacheScrubber = new CacheScrubber(this);
+    connect(this, SIGNAL(rasterModelChanged(const Core::AbstractRasterModel*)), _cacheScrubber, SLOT(abort()));
+
+    /* Tile tracing, could be already enabled from command-line */
+    TileTracer* tracer = TileTracer::instance();
+    if(_configuration.group("trace")->value<bool>("enabled"))
+        tracer->setEnabled(true);
+    if(tracer->filename().isEmpty())
+        tracer->setFilename(QString::fromStdString(_configuration.group("trace")->value<string>("file")));
+    QAction* saveTileTraceAction = new QAction(tr("Save tile trace..."), this);
+    connect(saveTileTraceAction, SIGNAL(triggered(bool)), SLOT(saveTileTrace()));
+    _actions.insert(AbstractUIComponent::Tools, saveTileTraceAction);
+
+    #ifdef KOMPAS_LOCK_PROFILING
+    /* Lock profiler dialog, offered to UI components in Tools category */
+    LockProfilerDialog* lockProfilerDialog = new LockProfilerDialog(this);
+    QAction* lockProfilerAction = new QAction(tr("Lock profiler..."), this);
+    connect(lockProfilerAction, SIGNAL(triggered(bool)), lockProfilerDialog, SLOT(refresh()));
+    connect(lockProfilerAction, SIGNAL(triggered(bool)), lockProfilerDialog, SLOT(show()));
+    _actions.insert(AbstractUIComponent::Tools, lockProfilerAction);
+    #endif
+
+    startupPhase("models and cache setup");
+
     /* Create UI and add UI components on plugin load */
     createUI();
     connect(_pluginManagerStore->uiComponents()->manager(),
             SIGNAL(loadAttempt(std::string,int,int)),
             SLOT(loadUIComponent(std::string,int,int)));
+    startupPhase("user interface");
 
     /* Load map view plugin */
     setMapView(_pluginManagerStore->mapViews()->manager()->instance(_configuration.group("map")->value<string>("viewPlugin")));
+    startupPhase("map view");
 
     /* Load cache */
     string cachePlugin = _configuration.group("cache")->value<string>("plugin");
     string cachePath = _configuration.group("cache")->value<string>("path");
     if(_configuration.group("cache")->value<bool>("enabled") && !cachePlugin.empty() && !cachePath.empty())
         setCache(_pluginManagerStore->caches()->manager()->instance(_configuration.group("cache")->value<string>("plugin")));
+    startupPhase("cache");
 
     /* Load previous session, if autoload enabled */
     _sessionManager->load();
+    startupPhase("session");
+
+    /* Wait for first paint to load the rest of UI */
+    qApp->installEventFilter(this);
 }
 
 MainWindow::~MainWindow() {
     /* It must be done this way, because if it is left to QObject hierarchy,
        the objects which SessionManager queries are already destroyed. */
     delete _sessionManager;
+
+    /* Stop the map view and its tile loading thread, so no download
+       finishing during shutdown touches the cache infrastructure */
+    delete _mapView;
+    _mapView = 0;
+
+    /* Wait for cache replacement to finish */
+    cacheReplace.waitForFinished();
+
+    /* Stop warming and scrubbing and write all pending tiles while the cache
+       and raster model still exist */
+    delete _cacheWarmer;
+    _cacheWarmer = 0;
+    delete _cacheScrubber;
+    _cacheScrubber = 0;
+    delete _cacheWriteQueue;
+    _cacheWriteQueue = 0;
+    delete _cacheStatistics;
+    _cacheStatistics = 0;
+    delete _cachePolicy;
+    _cachePolicy = 0;
+    _cacheIndex->save();
+    delete _cacheIndex;
+    _cacheIndex = 0;
+
+    /* Save tile trace, if anything was traced */
+    if(TileTracer::instance()->eventCount())
+        TileTracer::instance()->save(TileTracer::instance()->filename());
+
+    #ifdef KOMPAS_LOCK_PROFILING
+    /* Dump lock statistics, if requested */
+    QByteArray lockProfile = qgetenv("KOMPAS_LOCK_PROFILE");
+    if(!lockProfile.isEmpty())
+        LockProfiler::instance()->save(QString::fromLocal8Bit(lockProfile));
+    #endif
 }
 
 void MainWindow::setWindowTitle(const QString& title) {
@@ -137,6 +238,10 @@ void MainWindow::loadDefaultConfiguration() {
     unsigned int maxSimultaenousDownloads = 3;
     _configuration.group("map")->value("maxSimultaenousDownloads", &maxSimultaenousDownloads);
 
+    /* Performance overlay in map view */
+    bool performanceHud = false;
+    _configuration.group("map")->value("performanceHud", &performanceHud);
+
     /* Paths */
     string packageDir = Directory::home();
     _configuration.group("paths")->value<string>("packages", &packageDir);
@@ -158,35 +263,127 @@ void MainWindow::loadDefaultConfiguration() {
     _configuration.group("cache")->value<unsigned int>("size", &cacheSize);
     unsigned int cacheBlockSize = 4096;
     _configuration.group("cache")->value<unsigned int>("blockSize", &cacheBlockSize);
+    int writeBatchSize = 32;
+    _configuration.group("cache")->value<int>("writeBatchSize", &writeBatchSize);
+    int writeDelay = 2000;
+    _configuration.group("cache")->value<int>("writeDelay", &writeDelay);
+    int writeQueueSize = 8192;
+    _configuration.group("cache")->value<int>("writeQueueSize", &writeQueueSize);
+    int quota = 0;
+    _configuration.group("cache")->value<int>("quota", &quota);
+    string policy = "lru";
+    _configuration.group("cache")->value<string>("policy", &policy);
+    Zoom lowZoom = 10;
+    _configuration.group("cache")->value<Zoom>("lowZoom", &lowZoom);
+    int memorySize = 16;
+    _configuration.group("cache")->value<int>("memorySize", &memorySize);
+    bool warmOnLoad = true;
+    _configuration.group("cache")->value<bool>("warmOnLoad", &warmOnLoad);
+    int warmMargin = 1;
+    _configuration.group("cache")->value<int>("warmMargin", &warmMargin);
+    int warmZoomLevels = 1;
+    _configuration.group("cache")->value<int>("warmZoomLevels", &warmZoomLevels);
+    bool scrubOnLoad = true;
+    _configuration.group("cache")->value<bool>("scrubOnLoad", &scrubOnLoad);
+    int scrubDelay = 60;
+    _configuration.group("cache")->value<int>("scrubDelay", &scrubDelay);
+    int scrubRate = 20;
+    _configuration.group("cache")->value<int>("scrubRate", &scrubRate);
+
+    /* Package saving */
+    if(_configuration.group("saveRaster")->values<string>("shardedWriting").empty())
+        _configuration.group("saveRaster")->addValue<string>("shardedWriting", "");
+    int maxWriterThreads = 0;
+    _configuration.group("saveRaster")->value<int>("maxWriterThreads", &maxWriterThreads);
+
+    /* UI components loaded after first paint */
+    if(_configuration.group("plugins")->group("uiComponents")->values<string>("__deferred").empty()) {
+        _configuration.group("plugins")->group("uiComponents")->addValue<string>("__deferred", "AboutUIComponent");
+        _configuration.group("plugins")->group("uiComponents")->addValue<string>("__deferred", "DistanceMeterUIComponent");
+        _configuration.group("plugins")->group("uiComponents")->addValue<string>("__deferred", "DmsDecimalConverterUIComponent");
+        _configuration.group("plugins")->group("uiComponents")->addValue<string>("__deferred", "SessionManagementUIComponent");
+    }
+
+    /* Startup */
+    bool logTimings = false;
+    _configuration.group("startup")->value<bool>("logTimings", &logTimings);
+
+    /* Tracing */
+    bool traceEnabled = false;
+    _configuration.group("trace")->value<bool>("enabled", &traceEnabled);
+    string traceFile = Directory::join(Directory::configurationDir("Kompas"), "kompas-trace.json");
+    _configuration.group("trace")->value<string>("file", &traceFile);
 
     _configuration.setAutomaticGroupCreation(false);
     _configuration.setAutomaticKeyCreation(false);
 }
 
-void MainWindow::setCache(AbstractCache* cache) {
-    cacheLock.lockForWrite();
-
+QFuture<void> MainWindow::setCache(AbstractCache* cache) {
     /* Set default values for block and cache size */
     if(cache) {
         cache->setBlockSize(_configuration.group("cache")->value<unsigned int>("blockSize"));
         cache->setCacheSize(_configuration.group("cache")->value<unsigned int>("size")*1024*1024);
     }
-    QtConcurrent::run(this, &MainWindow::setCacheInternal, cache);
+
+    return cacheReplace = QtConcurrent::run(this, &MainWindow::setCacheInternal, cache, _configuration.group("cache")->value<string>("path"));
 }
 
-void MainWindow::setCacheInternal(AbstractCache* cache) {
-    /* Finalize previous cache and replace it with new */
-    if(_cache) {
+void MainWindow::setCacheInternal(AbstractCache* cache, const string& path) {
+    /* Replace one cache at a time */
+    QMutexLocker locker(&cacheReplaceMutex);
+
+    /* Previous cache uses the same files, finalize it first */
+    if(cache && _cache && path == cachePath) {
+        _cacheWriteQueue->flush();
+
+        cacheLock.lockForWrite();
         _cache->finalizeCache();
         delete _cache;
+        _cache = 0;
+        cache->initializeCache(path);
+        _cache = cache;
+        _cacheStatistics->reset();
+        _cacheIndex->load(path);
+        _cachePolicy->setCache(cache->cacheSize(), cache->usedSize(), _cacheIndex->layerCounts());
+        cacheLock.unlock();
+
+        return;
     }
+
+    /* Initialize new cache without locking, tiles can be read from previous
+       cache meanwhile */
+    if(cache) cache->initializeCache(path);
+
+    /* Pending tiles belong to previous cache */
+    _cacheWriteQueue->flush();
+
+    /* Replace the cache */
+    cacheLock.lockForWrite();
+    AbstractCache* previous = _cache;
     _cache = cache;
+    cachePath = cache ? path : string();
+    _cacheStatistics->reset();
+    _cacheIndex->load(cachePath);
+    if(cache) _cachePolicy->setCache(cache->cacheSize(), cache->usedSize(), _cacheIndex->layerCounts());
+    else _cachePolicy->setCache(0, 0, QHash<QString, int>());
+    cacheLock.unlock();
 
-    if(_cache) {
-        _cache->initializeCache(_configuration.group("cache")->value<string>("path"));
+    /* Nobody can access previous cache now, finalize it */
+    if(previous) {
+        previous->finalizeCache();
+        delete previous;
     }
+}
 
-    cacheLock.unlock();
+void MainWindow::updateRasterModelSnapshot() {
+    /* Build the snapshot with only the model locked, publishing it is just a
+       pointer swap */
+    Locker<const AbstractRasterModel> rasterModel = rasterModelForRead();
+    QSharedPointer<const RasterModelSnapshot> snapshot(new RasterModelSnapshot(rasterModel()));
+    rasterModel.unlock();
+
+    QMutexLocker locker(&rasterModelSnapshotMutex);
+    _rasterModelSnapshot = snapshot;
 }
 
 void MainWindow::setMapView(AbstractMapView* view) {
@@ -199,11 +396,18 @@ void MainWindow::setMapView(AbstractMapView* view) {
 }
 
 void MainWindow::setRasterModel(AbstractRasterModel* model) {
+    /* Pending tiles have to be written with the model which downloaded them */
+    _cacheWriteQueue->flush();
+
     rasterModelLock.lockForWrite();
     AbstractRasterModel* oldRasterModel = _rasterModel;
     _rasterModel = model;
+    _rasterModelGeneration.ref();
+    _cachePolicy->setRasterModel(model ? model->plugin() : string());
     rasterModelLock.unlock();
 
+    updateRasterModelSnapshot();
+
     _rasterPackageModel->reload();
     _rasterLayerModel->reload();
     _rasterOverlayModel->reload();
@@ -217,6 +421,7 @@ void MainWindow::setRasterModel(AbstractRasterModel* model) {
 
 void MainWindow::setOnlineEnabled(bool enabled) {
     rasterModelForWrite()()->setOnline(enabled);
+    updateRasterModelSnapshot();
 
     _rasterPackageModel->reload();
     _rasterLayerModel->reload();
@@ -231,10 +436,15 @@ void MainWindow::setOnlineEnabled(bool enabled) {
 AbstractRasterModel* MainWindow::rasterModelForFile(const QString& filename, AbstractRasterModel::SupportLevel* supportLevel) {
     PluginManager<AbstractRasterModel>* rasterModelPluginManager = _pluginManagerStore->rasterModels()->manager();
 
-    /* Try to open the package with current model */
+    /* Try to open the package with current model. Adding package modifies
+       the model, so it must be locked for writing. */
     /** @todo Disable online maps? */
-    if(_rasterModel && _rasterModel->addPackage(filename.toStdString()) != -1) {
+    Locker<AbstractRasterModel> rasterModel = rasterModelForWrite();
+    bool added = rasterModel() && rasterModel()->addPackage(filename.toStdString()) != -1;
+    rasterModel.unlock();
+    if(added) {
         /** @todo Open only if better plugin doesn't exist */
+        updateRasterModelSnapshot();
         _rasterPackageModel->reload();
         _rasterLayerModel->reload();
         _rasterOverlayModel->reload();
@@ -299,9 +509,7 @@ AbstractRasterModel* MainWindow::rasterModelForFile(const QString& filename, Abs
 }
 
 void MainWindow::displayMapIfUsable() {
-    Locker<const AbstractRasterModel> rasterModel = rasterModelForRead();
-    bool isUsable = rasterModel() ? rasterModel()->isUsable() : false;
-    rasterModel.unlock();
+    bool isUsable = rasterModelSnapshot()->usable;
 
     /* Show dock widgets only if map view is usable */
     foreach(QDockWidget* widget, _dockWidgets)
@@ -309,11 +517,48 @@ void MainWindow::displayMapIfUsable() {
 }
 
 void MainWindow::createUI() {
-    /* Foreach all loaded UI plugins and instance them */
-    PluginManager<AbstractUIComponent>* uiComponentPluginManager = _pluginManagerStore->uiComponents()->manager();
-    vector<string> plugins = uiComponentPluginManager->pluginList();
+    /* Foreach all loaded UI plugins and instance them, deferred static
+       plugins are instanced after first paint */
+    PluginManagerStore::Item<AbstractUIComponent>* uiComponents = _pluginManagerStore->uiComponents();
+    vector<string> plugins = uiComponents->manager()->pluginList();
     for(vector<string>::const_iterator it = plugins.begin(); it != plugins.end(); ++it)
-        loadUIComponent(*it, 0, uiComponentPluginManager->loadState(*it));
+        if(!uiComponents->isDeferred(*it))
+            loadUIComponent(*it, 0, uiComponents->manager()->loadState(*it));
+}
+
+void MainWindow::loadDeferredUIComponents() {
+    /* Static plugins are already loaded, only instance them */
+    PluginManagerStore::Item<AbstractUIComponent>* uiComponents = _pluginManagerStore->uiComponents();
+    vector<string> plugins = uiComponents->manager()->pluginList();
+    for(vector<string>::const_iterator it = plugins.begin(); it != plugins.end(); ++it) {
+        int loadState = uiComponents->manager()->loadState(*it);
+        if(uiComponents->isDeferred(*it) && (loadState & AbstractPluginManager::IsStatic))
+            loadUIComponent(*it, 0, loadState);
+    }
+
+    /* Dynamic plugins are instanced in loadUIComponent() on load */
+    uiComponents->loadDeferred();
+    startupPhase("deferred user interface");
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event) {
+    /* First paint of anything in main window, load the rest of UI after it
+       is done */
+    if(event->type() == QEvent::Paint && watched->isWidgetType() && static_cast<QWidget*>(watched)->window() == this) {
+        qApp->removeEventFilter(this);
+        startupPhase("first paint");
+        QTimer::singleShot(0, this, SLOT(loadDeferredUIComponents()));
+    }
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::startupPhase(const char* name) {
+    if(!logStartupTimings) return;
+
+    qint64 elapsed = startupTimer.elapsed();
+    qDebug() << "Startup:" << name << "took" << elapsed-startupPhaseEnd << "ms," << elapsed << "ms total";
+    startupPhaseEnd = elapsed;
 }
 
 void MainWindow::loadUIComponent(const string& plugin, int, int loadState) {
@@ -368,4 +613,12 @@ void MainWindow::loadUIComponent(const string& plugin, int, int loadState) {
     connect(this, SIGNAL(actionAdded(int,QAction*)), instance, SLOT(actionAdded(int,QAction*)));
 }
 
+void MainWindow::saveTileTrace() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save tile trace"), TileTracer::instance()->filename(), tr("Trace files (*.json)"));
+    if(filename.isEmpty()) return;
+
+    if(!TileTracer::instance()->save(filename))
+        MessageBox::warning(this, tr("Cannot save trace"), tr("Cannot write to file <strong>%0</strong>.").arg(filename));
+}
+
 }}
@@ -19,8 +19,13 @@
  * @brief Class Kompas::QtGui::MainWindow
  */
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFuture>
 #include <QtCore/QMultiMap>
+#include <QtCore/QMutex>
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QSharedPointer>
 #include <QtGui/QMainWindow>
 
 #include "Utility/Configuration.h"
@@ -28,6 +33,7 @@
 #include "AbstractUIComponent.h"
 #include "Locker.h"
 #include "AbstractRasterModel.h"
+#include "RasterModelSnapshot.h"
 
 class QStackedWidget;
 class QAction;
@@ -42,6 +48,13 @@ namespace Core {
 namespace QtGui {
 
 class AbstractMapView;
+class CacheIndex;
+class CachePolicy;
+class CacheStatistics;
+class CacheScrubber;
+class CacheWarmer;
+class CacheWriteQueue;
+class MemoryCache;
 class PluginManagerStore;
 class RasterPackageModel;
 class RasterLayerModel;
@@ -67,6 +80,9 @@ viewPlugin=GraphicsMapView
 # Max count of simultaenous downloads
 maxSimultaenousDownloads=3
 
+# Whether map view displays performance overlay, if supported
+performanceHud=false
+
 # Application paths configuration
 [paths]
 
@@ -93,6 +109,58 @@ size=100
 
 # Default cache block size, in bytes (used for newly created caches)
 blockSize=4096
+
+# Writing to cache, see CacheWriteQueue class documentation
+writeBatchSize=32
+writeDelay=2000
+writeQueueSize=8192
+
+# In-memory cache tier, see MemoryCache class documentation
+memorySize=16
+
+# Default quota and policy for each layer, see CachePolicy class
+# documentation for these and per-layer settings
+quota=0
+policy=lru
+lowZoom=10
+
+# Cache warming, see CacheWarmer class documentation
+warmOnLoad=true
+warmMargin=1
+warmZoomLevels=1
+
+# Cache integrity checking, see CacheScrubber class documentation
+scrubOnLoad=true
+scrubDelay=60
+scrubRate=20
+
+# Package saving, see Plugins::UIComponents::SaveRasterThread class documentation
+[saveRaster]
+shardedWriting=
+maxWriterThreads=0
+
+# Tile loading tracing, see TileTracer class documentation
+[trace]
+enabled=false
+file=
+
+# Startup configuration
+[startup]
+
+# Whether to log duration of particular startup phases
+logTimings=false
+</pre>
+
+<p>UI components which aren't needed for displaying the map are loaded and
+instanced only after the main window is painted for the first time, see
+PluginManagerStore class documentation. Default list, set it to single empty
+value to load everything on startup:</p>
+<pre>
+[plugins/uiComponents]
+__deferred=AboutUIComponent
+__deferred=DistanceMeterUIComponent
+__deferred=DmsDecimalConverterUIComponent
+__deferred=SessionManagementUIComponent
 </pre>
 */
 class MainWindow: public QMainWindow {
@@ -169,8 +237,8 @@ class MainWindow: public QMainWindow {
          * has to be unlocked either by destroying @ref Locker instance or
          * calling @ref Locker::unlock().
          */
-        inline Locker<const Core::AbstractCache> cacheForRead() {
-            return Locker<const Core::AbstractCache>(_cache, &cacheLock);
+        inline Locker<const Core::AbstractCache> cacheForRead(KOMPAS_LOCKER_CALL_SITE) {
+            return Locker<const Core::AbstractCache>(_cache, &cacheLock KOMPAS_LOCKER_PASS_CALL_SITE);
         }
 
         /**
@@ -181,10 +249,69 @@ class MainWindow: public QMainWindow {
          * has to be unlocked either by destroying @ref Locker instance or
          * calling @ref Locker::unlock().
          */
-        inline Locker<Core::AbstractCache> cacheForWrite() {
-            return Locker<Core::AbstractCache>(_cache, &cacheLock);
+        inline Locker<Core::AbstractCache> cacheForWrite(KOMPAS_LOCKER_CALL_SITE) {
+            return Locker<Core::AbstractCache>(_cache, &cacheLock KOMPAS_LOCKER_PASS_CALL_SITE);
         }
 
+        /**
+         * @brief Write-behind queue for cache
+         *
+         * Downloaded tiles should be saved to cache through this queue
+         * instead of writing them to cache directly.
+         */
+        inline CacheWriteQueue* cacheWriteQueue()
+            { return _cacheWriteQueue; }
+
+        /**
+         * @brief Index of tiles in cache
+         *
+         * Loaded and saved every time the cache is replaced.
+         */
+        inline CacheIndex* cacheIndex()
+            { return _cacheIndex; }
+
+        /**
+         * @brief Cache quotas and policies
+         *
+         * Consulted by cacheWriteQueue() for each written tile.
+         */
+        inline CachePolicy* cachePolicy()
+            { return _cachePolicy; }
+
+        /**
+         * @brief Cache usage statistics
+         *
+         * Reset every time the cache is replaced.
+         */
+        inline CacheStatistics* cacheStatistics()
+            { return _cacheStatistics; }
+
+        /**
+         * @brief In-memory cache tier
+         *
+         * Tiles should be looked up here before the package and cache and
+         * put here after they are loaded. Cleared on every raster model
+         * change.
+         */
+        inline MemoryCache* memoryCache()
+            { return _memoryCache; }
+
+        /**
+         * @brief Cache warmer
+         *
+         * Warming is stopped on every raster model change.
+         */
+        inline CacheWarmer* cacheWarmer()
+            { return _cacheWarmer; }
+
+        /**
+         * @brief Cache scrubber
+         *
+         * Scrubbing is stopped on every raster model change.
+         */
+        inline CacheScrubber* cacheScrubber()
+            { return _cacheScrubber; }
+
         /**
          * @brief Get raster model for reading
          * @return Locker with raster model
@@ -193,8 +320,8 @@ class MainWindow: public QMainWindow {
          * has to be unlocked either by destroying @ref Locker instance or
          * calling @ref Locker::unlock().
          */
-        inline Locker<const Core::AbstractRasterModel> rasterModelForRead() {
-            return Locker<const Core::AbstractRasterModel>(_rasterModel, &rasterModelLock);
+        inline Locker<const Core::AbstractRasterModel> rasterModelForRead(KOMPAS_LOCKER_CALL_SITE) {
+            return Locker<const Core::AbstractRasterModel>(_rasterModel, &rasterModelLock KOMPAS_LOCKER_PASS_CALL_SITE);
         }
 
         /**
@@ -205,10 +332,36 @@ class MainWindow: public QMainWindow {
          * has to be unlocked either by destroying @ref Locker instance or
          * calling @ref Locker::unlock().
          */
-        inline Locker<Core::AbstractRasterModel> rasterModelForWrite() {
-            return Locker<Core::AbstractRasterModel>(_rasterModel, &rasterModelLock);
+        inline Locker<Core::AbstractRasterModel> rasterModelForWrite(KOMPAS_LOCKER_CALL_SITE) {
+            return Locker<Core::AbstractRasterModel>(_rasterModel, &rasterModelLock KOMPAS_LOCKER_PASS_CALL_SITE);
+        }
+
+        /**
+         * @brief Raster model snapshot
+         *
+         * Metadata of current raster model (zoom levels, area, tile size,
+         * layers, ...). Doesn't lock the raster model, so it can be called
+         * anytime without waiting for tile loading or package operations.
+         * The snapshot is replaced with new one on every raster model change
+         * (before rasterModelChanged() is emitted), already obtained
+         * snapshots are never modified. Prefer this to rasterModelForRead()
+         * if only the metadata are needed.
+         */
+        inline QSharedPointer<const RasterModelSnapshot> rasterModelSnapshot() {
+            QMutexLocker locker(&rasterModelSnapshotMutex);
+            return _rasterModelSnapshot;
         }
 
+        /**
+         * @brief Raster model generation
+         *
+         * Incremented on every raster model replacement, while the raster
+         * model is locked for writing. Tiles fetched with previous model
+         * have different generation than the current one and must not be
+         * stored with current model, see CacheWriteQueue::enqueue().
+         */
+        inline int rasterModelGeneration() const { return _rasterModelGeneration; }
+
         /**
          * @brief Open raster map file
          *
@@ -261,9 +414,16 @@ class MainWindow: public QMainWindow {
          * @brief Set cache
          * @param cache     Instance of cache
          *
-         * Finalizes previous cache and replaces it with this.
+         * @return Future which finishes after the cache is initialized
+         *
+         * The cache is initialized in separate thread, while tiles can be
+         * still read from previous cache. After that pending tiles from
+         * cacheWriteQueue() are written, previous cache is replaced with this
+         * and finalized. If the new cache has the same path as previous
+         * cache, the previous cache is finalized before initializing the new
+         * one and the cache isn't available meanwhile.
          */
-        void setCache(Core::AbstractCache* cache);
+        QFuture<void> setCache(Core::AbstractCache* cache);
 
         /**
          * @brief Set map view
@@ -277,7 +437,8 @@ class MainWindow: public QMainWindow {
          * @brief Set raster model
          * @param model     Instance of raster model
          *
-         * Replaces current raster model with given instance.
+         * Writes pending tiles from cacheWriteQueue() and replaces current
+         * raster model with given instance.
          */
         void setRasterModel(Core::AbstractRasterModel* model);
 
@@ -295,6 +456,19 @@ class MainWindow: public QMainWindow {
          */
         void loadUIComponent(const std::string& plugin, int, int loadState);
 
+        /** @brief Save tile trace into file selected by user */
+        void saveTileTrace();
+
+        /**
+         * @brief Load deferred UI components
+         *
+         * Called after the main window is painted for the first time.
+         */
+        void loadDeferredUIComponents();
+
+    protected:
+        bool eventFilter(QObject* watched, QEvent* event);
+
     private:
         static MainWindow* _instance;
 
@@ -310,18 +484,38 @@ class MainWindow: public QMainWindow {
 
         AbstractMapView* _mapView;
         Core::AbstractCache* _cache;
+        CacheIndex* _cacheIndex;
+        CachePolicy* _cachePolicy;
+        CacheStatistics* _cacheStatistics;
+        CacheWriteQueue* _cacheWriteQueue;
+        MemoryCache* _memoryCache;
+        CacheWarmer* _cacheWarmer;
+        CacheScrubber* _cacheScrubber;
         Core::AbstractRasterModel* _rasterModel;
         QReadWriteLock rasterModelLock, cacheLock;
+        QMutex rasterModelSnapshotMutex;
+        QSharedPointer<const RasterModelSnapshot> _rasterModelSnapshot;
+        QAtomicInt _rasterModelGeneration;
+        QMutex cacheReplaceMutex;
+        std::string cachePath;
+        QFuture<void> cacheReplace;
 
         QMultiMap<AbstractUIComponent::ActionCategory, QAction*> _actions;
 
         QList<QDockWidget*> _dockWidgets;
 
+        bool logStartupTimings;
+        QElapsedTimer startupTimer;
+        qint64 startupPhaseEnd;
+
+        void startupPhase(const char* name);
+
         void createUI();
 
         void displayMapIfUsable();
 
-        void setCacheInternal(Core::AbstractCache* cache);
+        void setCacheInternal(Core::AbstractCache* cache, const std::string& path);
+        void updateRasterModelSnapshot();
 };
 
 }}
@@ -0,0 +1,153 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "MemoryCache.h"
+
+#include "MainWindow.h"
+
+using namespace std;
+
+namespace Kompas { namespace QtGui {
+
+namespace {
+    /* Share of protected segment on total size, in percent */
+    const int protectedShare = 80;
+}
+
+MemoryCache::MemoryCache(QObject* parent): QObject(parent), _maxSize(0), probationSize(0), protectedSize(0), _generation(0) {
+    setMaxSize(MainWindow::instance()->configuration()->group("cache")->value<int>("memorySize")*1024*1024);
+}
+
+MemoryCache::MemoryCache(int maxSize, QObject* parent): QObject(parent), _maxSize(0), probationSize(0), protectedSize(0), _generation(0) {
+    setMaxSize(maxSize);
+}
+
+void MemoryCache::setMaxSize(int size) {
+    QMutexLocker locker(&mutex);
+    _maxSize = qMax(0, size);
+    evict();
+}
+
+QByteArray MemoryCache::get(const TileKey& key, int* generation) {
+    QMutexLocker locker(&mutex);
+
+    QHash<TileKey, list<Entry>::iterator>::iterator found = entries.find(key);
+    if(found == entries.end()) {
+        ++_statistics.memoryMisses;
+        return QByteArray();
+    }
+
+    ++_statistics.memoryHits;
+    if(generation) *generation = _generation;
+    list<Entry>::iterator it = *found;
+
+    /* Hit in protected segment, move to front */
+    if(it->isProtected)
+        protectedSegment.splice(protectedSegment.begin(), protectedSegment, it);
+
+    /* Hit in probation segment, promote to protected */
+    else {
+        it->isProtected = true;
+        probationSize -= it->data.size();
+        protectedSize += it->data.size();
+        protectedSegment.splice(protectedSegment.begin(), probation, it);
+        evict();
+    }
+
+    return it->data;
+}
+
+bool MemoryCache::contains(const TileKey& key) {
+    QMutexLocker locker(&mutex);
+    return entries.contains(key);
+}
+
+void MemoryCache::set(const TileKey& key, const QByteArray& data, int generation, Admission admission) {
+    QMutexLocker locker(&mutex);
+
+    /* Tile read with previous raster model */
+    if(generation != _generation) return;
+
+    /* Tile is larger than whole probation segment, don't bother */
+    if(_maxSize == 0 || data.size() > static_cast<qint64>(_maxSize)*(100-protectedShare)/100) return;
+
+    /* Replace data of existing tile */
+    QHash<TileKey, list<Entry>::iterator>::iterator found = entries.find(key);
+    if(found != entries.end()) {
+        int difference = data.size()-(*found)->data.size();
+        if((*found)->isProtected) protectedSize += difference;
+        else probationSize += difference;
+        (*found)->data = data;
+        evict();
+        return;
+    }
+
+    /* New tiles go to probation, prefetched ones are evicted first */
+    list<Entry>::iterator it = admission == Prefetch ?
+        probation.insert(probation.end(), Entry(key, data, false)) :
+        probation.insert(probation.begin(), Entry(key, data, false));
+    entries.insert(key, it);
+    probationSize += data.size();
+
+    evict();
+}
+
+MemoryCache::Statistics MemoryCache::statistics() {
+    QMutexLocker locker(&mutex);
+    Statistics s = _statistics;
+    s.size = probationSize+protectedSize;
+    s.count = entries.size();
+    return s;
+}
+
+void MemoryCache::clear() {
+    clear(MainWindow::instance()->rasterModelGeneration());
+}
+
+void MemoryCache::clear(int generation) {
+    QMutexLocker locker(&mutex);
+    _generation = generation;
+    entries.clear();
+    probation.clear();
+    protectedSegment.clear();
+    probationSize = 0;
+    protectedSize = 0;
+}
+
+void MemoryCache::resetStatistics() {
+    QMutexLocker locker(&mutex);
+    _statistics = Statistics();
+}
+
+void MemoryCache::evict() {
+    /* Demote least recently used tiles from full protected segment */
+    int maxProtectedSize = static_cast<qint64>(_maxSize)*protectedShare/100;
+    while(protectedSize > maxProtectedSize && !protectedSegment.empty()) {
+        list<Entry>::iterator it = --protectedSegment.end();
+        it->isProtected = false;
+        protectedSize -= it->data.size();
+        probationSize += it->data.size();
+        probation.splice(probation.begin(), protectedSegment, it);
+    }
+
+    /* Evict least recently used tiles from probation segment */
+    while(probationSize+protectedSize > _maxSize && !probation.empty()) {
+        probationSize -= probation.back().data.size();
+        entries.remove(probation.back().key);
+        probation.pop_back();
+    }
+}
+
+}}
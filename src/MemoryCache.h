@@ -0,0 +1,186 @@
+#ifndef Kompas_QtGui_MemoryCache_h
+#define Kompas_QtGui_MemoryCache_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::MemoryCache
+ */
+
+#include <list>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief In-memory tier in front of persistent cache
+
+Keeps recently used tiles in memory, so repeated lookups don't have to go to
+the cache plugin storage. Uses segmented LRU: newly added tiles go to
+probation segment and only tiles which are hit again are promoted to
+protected segment. Tiles evicted from protected segment are demoted back to
+probation. Thus tiles used only once (e.g. while panning over the map) never
+evict the working set. Prefetched tiles (see @ref Admission) are moreover
+added to the least recently used end of probation segment, so they are
+evicted first if not used.
+
+The cache is keyed by tile, not by cache key, so it works with any cache
+plugin and also without any. It is cleared every time the raster model
+changes, because the tile data depend on it. Tiles are added together with
+raster model generation they were read with (see
+MainWindow::rasterModelGeneration()) and tiles of other generation than the
+current one are refused, so tile read with previous raster model can't get
+into the cache after it was cleared. All functions are thread-safe.
+@see MainWindow::memoryCache()
+
+@configuration
+
+<p>Configuration is stored in <tt>cache</tt> group, see MainWindow class
+documentation.</p>
+<pre>
+[cache]
+
+# Size of memory cache in megabytes, 0 disables it
+memorySize=16
+</pre>
+*/
+class MemoryCache: public QObject {
+    Q_OBJECT
+
+    public:
+        /** @brief Admission of newly added tiles */
+        enum Admission {
+            Demand,     /**< @brief Tile was requested for display */
+            Prefetch    /**< @brief Tile was loaded in advance */
+        };
+
+        /** @brief Hit and miss counters */
+        struct Statistics {
+            /** @brief Constructor */
+            inline Statistics(): memoryHits(0), memoryMisses(0), size(0), count(0) {}
+
+            quint64 memoryHits,         /**< @brief Hits in memory tier */
+                memoryMisses;           /**< @brief Misses in memory tier */
+
+            int size,                   /**< @brief Size of all tiles in memory */
+                count;                  /**< @brief Count of tiles in memory */
+        };
+
+        /**
+         * @brief Constructor
+         * @param parent    Parent object
+         *
+         * Size is taken from configuration.
+         */
+        MemoryCache(QObject* parent = 0);
+
+        /**
+         * @brief Constructor with explicit size
+         * @param maxSize   Max size in bytes, 0 disables the cache
+         * @param parent    Parent object
+         */
+        MemoryCache(int maxSize, QObject* parent = 0);
+
+        /** @brief Max size in bytes */
+        inline int maxSize() const { return _maxSize; }
+
+        /**
+         * @brief Set max size
+         * @param size      Size in bytes, 0 disables the cache
+         *
+         * If the cache is larger, least recently used tiles are evicted.
+         */
+        void setMaxSize(int size);
+
+        /**
+         * @brief Get tile data
+         * @param key           Tile
+         * @param generation    If not null, raster model generation of
+         *      returned data is saved there
+         * @return Tile data or empty array, if the tile is not in memory
+         *
+         * Counts memory hit or miss.
+         */
+        QByteArray get(const TileKey& key, int* generation = 0);
+
+        /**
+         * @brief Whether the tile is in memory
+         *
+         * Unlike get() doesn't count hit or miss and doesn't affect eviction
+         * order.
+         */
+        bool contains(const TileKey& key);
+
+        /**
+         * @brief Add tile data
+         * @param key           Tile
+         * @param data          Tile data
+         * @param generation    Raster model generation with which the data
+         *      were read
+         * @param admission     Whether the tile was requested or prefetched
+         *
+         * If the generation is not the one passed to last clear(), the tile
+         * is not added.
+         */
+        void set(const TileKey& key, const QByteArray& data, int generation, Admission admission = Demand);
+
+        /** @brief Hit and miss counters and current usage */
+        Statistics statistics();
+
+        /**
+         * @brief Remove all tiles
+         * @param generation    Generation of tiles accepted from now on
+         */
+        void clear(int generation);
+
+    public slots:
+        /**
+         * @brief Remove all tiles
+         *
+         * Tiles of current raster model generation are accepted from now on.
+         */
+        void clear();
+
+        /** @brief Reset hit and miss counters */
+        void resetStatistics();
+
+    private:
+        struct Entry {
+            inline Entry(const TileKey& _key, const QByteArray& _data, bool _protected): key(_key), data(_data), isProtected(_protected) {}
+
+            TileKey key;
+            QByteArray data;
+            bool isProtected;
+        };
+
+        QMutex mutex;
+
+        int _maxSize, probationSize, protectedSize, _generation;
+        Statistics _statistics;
+
+        /* Most recently used at the front */
+        std::list<Entry> probation, protectedSegment;
+        QHash<TileKey, std::list<Entry>::iterator> entries;
+
+        void evict();
+};
+
+}}
+
+#endif
@@ -81,10 +81,13 @@ void PluginManagerStore::AbstractItem::pluginDirectoryToConfiguration() {
 }
 
 void PluginManagerStore::AbstractItem::loadedFromConfiguration() {
+    vector<string> deferred = _configurationGroup->values<string>("__deferred");
+    _deferred = set<string>(deferred.begin(), deferred.end());
+
     vector<string> plugins = _manager->pluginList();
 
     for(vector<string>::const_iterator it = plugins.begin(); it != plugins.end(); ++it)
-        if(_configurationGroup->value<bool>(*it))
+        if(_configurationGroup->value<bool>(*it) && !isDeferred(*it))
             _manager->load(*it);
 }
 
@@ -94,8 +97,19 @@ void PluginManagerStore::AbstractItem::loadedToConfiguration() {
     for(vector<string>::const_iterator it = plugins.begin(); it != plugins.end(); ++it)
         if(_manager->loadState(*it) & (AbstractPluginManager::LoadOk|AbstractPluginManager::IsStatic))
             _configurationGroup->setValue<bool>(*it, true);
-        else
+
+        /* Plugin waiting for deferred load isn't loaded yet, keep it */
+        else if(!isDeferred(*it))
             _configurationGroup->removeValue(*it);
 }
 
+void PluginManagerStore::AbstractItem::loadDeferred() {
+    set<string> deferred;
+    deferred.swap(_deferred);
+
+    for(set<string>::const_iterator it = deferred.begin(); it != deferred.end(); ++it)
+        if(!(_manager->loadState(*it) & AbstractPluginManager::IsStatic) && _configurationGroup->value<bool>(*it))
+            _manager->load(*it);
+}
+
 }}
@@ -19,6 +19,8 @@
  * @brief Class Kompas::QtGui::PluginManagerStore
  */
 
+#include <set>
+
 #include "PluginManager.h"
 
 #include "AbstractCache.h"
@@ -48,11 +50,15 @@ given plugin group, and several parameters named after plugins with boolean
 values indicating whether the plugin is loaded or not. Load state of static
 plugins is saved too (set to <tt>true</tt>), so when any plugin is made
 non-static in next version, it will be still loaded.</p>
+<p>Plugins listed in multi-value parameter <tt>__deferred</tt> are not loaded
+on startup, but later with @ref AbstractItem::loadDeferred(), see
+MainWindow class documentation for default list.</p>
 <p>Example structure with all current plugin group names. Group names correspond
 with plugin manangers' accessor function names.</p>
 <pre>
 [caches]
 __dir=
+__deferred=
 pluginName1=
 pluginName2=
 
@@ -163,12 +169,41 @@ class PluginManagerStore::AbstractItem: public QObject {
         /** @brief Save plugin directory to configuration */
         void pluginDirectoryToConfiguration();
 
-        /** @brief Load plugins as configured */
+        /**
+         * @brief Load plugins as configured
+         *
+         * Plugins listed in <tt>__deferred</tt> configuration parameter are
+         * skipped, load them later with @ref loadDeferred().
+         */
         void loadedFromConfiguration();
 
-        /** @brief Save list of loaded plugins to configuration */
+        /**
+         * @brief Save list of loaded plugins to configuration
+         *
+         * Plugins which are still waiting for deferred load are kept as
+         * configured.
+         */
         void loadedToConfiguration();
 
+        /**
+         * @brief Whether loading of given plugin is deferred
+         *
+         * True if the plugin is listed in <tt>__deferred</tt> configuration
+         * parameter and @ref loadDeferred() wasn't called yet.
+         */
+        inline bool isDeferred(const std::string& plugin) const {
+            return _deferred.find(plugin) != _deferred.end();
+        }
+
+        /**
+         * @brief Load deferred plugins
+         *
+         * Loads plugins skipped in @ref loadedFromConfiguration(), if they
+         * are configured to be loaded. Static plugins are not touched, as
+         * they are always loaded.
+         */
+        void loadDeferred();
+
     private:
         Corrade::Utility::ConfigurationGroup* _configurationGroup;
 
@@ -178,6 +213,8 @@ class PluginManagerStore::AbstractItem: public QObject {
         AbstractPluginManager* _manager;
         PluginModel *_model,
             *_loadedOnlyModel;
+
+        std::set<std::string> _deferred;
 };
 
 /**
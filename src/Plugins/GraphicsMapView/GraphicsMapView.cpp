@@ -18,6 +18,8 @@
 #include <cmath>
 #include <vector>
 #include <QtCore/QBitArray>
+#include <QtCore/QTimer>
+#include <QtGui/QAction>
 #include <QtGui/QHBoxLayout>
 #include <QtGui/QGraphicsItem>
 #include <QtGui/QMouseEvent>
@@ -28,6 +30,7 @@
 #include "MapView.h"
 #include "Tile.h"
 #include "TileDataThread.h"
+#include "TileTracer.h"
 
 using namespace std;
 using namespace Corrade::Utility;
@@ -39,12 +42,12 @@ PLUGIN_REGISTER(GraphicsMapView, Kompas::Plugins::GraphicsMapView,
 
 namespace Kompas { namespace Plugins {
 
-GraphicsMapView::GraphicsMapView(Corrade::PluginManager::AbstractPluginManager* manager, const std::string& plugin): AbstractMapView(manager, plugin), _zoom(0), tileNotFoundImage(":/notfound-256.png"), tileLoadingImage(":/loading-256.png") {
+GraphicsMapView::GraphicsMapView(Corrade::PluginManager::AbstractPluginManager* manager, const std::string& plugin): AbstractMapView(manager, plugin), _zoom(0), tileNotFoundImage(":/notfound-256.png"), tileLoadingImage(":/loading-256.png"), decodeTime(0), decodeCount(0), lastDownloadedSize(0) {
     /* Enable mouse tracking */
     setMouseTracking(true);
 
     /* Graphics view */
-    view = new MapView(&_copyright, this);
+    view = new MapView(&_copyright, &_hud, this);
     view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     view->setDragMode(QGraphicsView::ScrollHandDrag);
@@ -66,17 +69,28 @@ GraphicsMapView::GraphicsMapView(Corrade::PluginManager::AbstractPluginManager*
     layout->setContentsMargins(0, 0, 0, 0);
     setLayout(layout);
 
+    /* Performance overlay */
+    hudTimer = new QTimer(this);
+    hudTimer->setInterval(500);
+    connect(hudTimer, SIGNAL(timeout()), SLOT(updateHud()));
+    QAction* hudAction = new QAction(tr("Performance overlay"), this);
+    hudAction->setCheckable(true);
+    hudAction->setShortcut(QKeySequence("Ctrl+Alt+P"));
+    hudAction->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    addAction(hudAction);
+    hudAction->setChecked(MainWindow::instance()->configuration()->group("map")->value<bool>("performanceHud"));
+    setHudEnabled(hudAction->isChecked());
+    connect(hudAction, SIGNAL(toggled(bool)), SLOT(setHudEnabled(bool)));
+
     updateRasterModel();
 }
 
 bool GraphicsMapView::zoomIn(const QPoint& pos) {
     if(!isReady()) return false;
 
-    set<Zoom> z = MainWindow::instance()->rasterModelForRead()()->zoomLevels();
-
     /* Check whether we can zoom in */
-    set<Zoom>::const_iterator it = z.find(_zoom);
-    if(++it == z.end()) return false;
+    std::map<Zoom, ZoomMetadata>::const_iterator it = metadata.zoomLevels.find(_zoom);
+    if(it == metadata.zoomLevels.end() || ++it == metadata.zoomLevels.end()) return false;
 
     /* Abort all jobs from previous zoom */
     tileDataThread->abort();
@@ -90,8 +104,8 @@ bool GraphicsMapView::zoomIn(const QPoint& pos) {
     QPointF coords = view->mapToScene(view->width()/2, view->height()/2)+move;
 
     /* Zoom in, update map area */
-    unsigned int multiplier = pow2(*it-_zoom);
-    _zoom = *it;
+    unsigned int multiplier = pow2(it->first-_zoom);
+    _zoom = it->first;
     updateMapArea();
 
     /* Remove old tiles */
@@ -112,11 +126,9 @@ bool GraphicsMapView::zoomIn(const QPoint& pos) {
 bool GraphicsMapView::zoomOut(const QPoint& pos) {
     if(!isReady()) return false;
 
-    set<Zoom> z = MainWindow::instance()->rasterModelForRead()()->zoomLevels();
-
     /* Check whether we can zoom out */
-    set<Zoom>::const_iterator it = z.find(_zoom);
-    if(it-- == z.begin()) return false;
+    std::map<Zoom, ZoomMetadata>::const_iterator it = metadata.zoomLevels.find(_zoom);
+    if(it == metadata.zoomLevels.end() || it-- == metadata.zoomLevels.begin()) return false;
 
     /* Abort all jobs from previous zoom */
     tileDataThread->abort();
@@ -130,8 +142,8 @@ bool GraphicsMapView::zoomOut(const QPoint& pos) {
     QPointF coords = view->mapToScene(view->width()/2, view->height()/2)+move;
 
     /* Zoom out, update map area */
-    unsigned int divisor = pow2(_zoom-*it);
-    _zoom = *it;
+    unsigned int divisor = pow2(_zoom-it->first);
+    _zoom = it->first;
     updateMapArea();
 
     /* Remove old tiles */
@@ -155,10 +167,8 @@ bool GraphicsMapView::zoomTo(Core::Zoom zoom, const QPoint& pos) {
     /* If we are at the zoom already, nothing to do */
     if(zoom == _zoom) return true;
 
-    set<Zoom> z = MainWindow::instance()->rasterModelForRead()()->zoomLevels();
-
     /* Check whether given zoom exists */
-    if(z.find(zoom) == z.end()) return false;
+    if(metadata.zoomLevels.find(zoom) == metadata.zoomLevels.end()) return false;
 
     /* Abort all jobs from previous zoom */
     tileDataThread->abort();
@@ -193,12 +203,19 @@ bool GraphicsMapView::zoomTo(Core::Zoom zoom, const QPoint& pos) {
 }
 
 LatLonCoords GraphicsMapView::coords(const QPoint& pos) {
-    return coords(MainWindow::instance()->rasterModelForRead()(), pos);
+    /* Called on every mouse move, use the snapshot to avoid locking */
+    QSharedPointer<const RasterModelSnapshot> rasterModel = MainWindow::instance()->rasterModelSnapshot();
+    if(!rasterModel->usable) return LatLonCoords();
+    return coords(rasterModel->projection, rasterModel->tileSize, pos);
 }
 
 LatLonCoords GraphicsMapView::coords(const AbstractRasterModel* rasterModel, const QPoint& pos) {
     if(!isReady()) return LatLonCoords();
 
+    return coords(rasterModel->projection(), rasterModel->tileSize(), pos);
+}
+
+LatLonCoords GraphicsMapView::coords(const AbstractProjection* projection, const TileSize& tileSize, const QPoint& pos) {
     /* Position where to get coordinates */
     QPointF center;
     if(pos.isNull())
@@ -207,11 +224,11 @@ LatLonCoords GraphicsMapView::coords(const AbstractRasterModel* rasterModel, con
         center = view->mapToScene(pos);
 
     /* The model doesn't have projection, return invalid coordinates */
-    if(!rasterModel->projection()) return LatLonCoords();
+    if(!projection) return LatLonCoords();
 
-    LatLonCoords ret = rasterModel->projection()->toLatLon(Coords<double>(
-        center.x()/(pow2(_zoom)*rasterModel->tileSize().x),
-        center.y()/(pow2(_zoom)*rasterModel->tileSize().y)
+    LatLonCoords ret = projection->toLatLon(Coords<double>(
+        center.x()/(pow2(_zoom)*tileSize.x),
+        center.y()/(pow2(_zoom)*tileSize.y)
     ));
 
     return ret;
@@ -227,10 +244,8 @@ AbsoluteArea<double> GraphicsMapView::viewedArea(const QRect& area) {
         sceneArea.setBottomRight(view->mapToScene(area.bottomRight()).toPoint());
     }
 
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    TileSize tileSize = rasterModel()->tileSize();
-    TileArea a = rasterModel()->area()*tileSize*pow2(_zoom-*rasterModel()->zoomLevels().begin());
-    rasterModel.unlock();
+    const TileSize& tileSize = metadata.tileSize;
+    TileArea a = current.area*tileSize;
 
     /* Fix cases where scene is smaller than viewed area */
     if(sceneArea.left() < 0) {
@@ -263,18 +278,16 @@ bool GraphicsMapView::setCoords(const LatLonCoords& coords, const QPoint& pos) {
         y = pos.y()-view->height()/2;
     }
 
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-
     /* The model doesn't have projection, nothing to do */
-    if(!rasterModel()->projection()) return false;
+    const AbstractProjection* projection = MainWindow::instance()->rasterModelSnapshot()->projection;
+    if(!projection) return false;
 
     /* Convert coordinates to raster */
-    Coords<double> rc = rasterModel()->projection()->fromLatLon(coords);
+    Coords<double> rc = projection->fromLatLon(coords);
 
     /* Center map to that coordinates (moved by 'pos' distance from center) */
-    view->centerOn(rc.x*pow2(_zoom)*rasterModel()->tileSize().x-x,
-                   rc.y*pow2(_zoom)*rasterModel()->tileSize().y-y);
-    rasterModel.unlock();
+    view->centerOn(rc.x*pow2(_zoom)*metadata.tileSize.x-x,
+                   rc.y*pow2(_zoom)*metadata.tileSize.y-y);
 
     /* Update tile positions */
     updateTileCount();
@@ -297,10 +310,8 @@ bool GraphicsMapView::setLayer(const QString& layer) {
     /* Abort all jobs with current layer */
     tileDataThread->abort(_layer);
 
-    vector<string> layers = MainWindow::instance()->rasterModelForRead()()->layers();
-
     /* Check whether given layer exists */
-    if(::find(layers.begin(), layers.end(), layer.toStdString()) == layers.end())
+    if(::find(metadata.layers.begin(), metadata.layers.end(), layer.toStdString()) == metadata.layers.end())
         return false;
 
     /* Update tile data */
@@ -321,9 +332,7 @@ bool GraphicsMapView::addOverlay(const QString& overlay) {
     if(!isReady()) return false;
 
     /* Check whether given overlay exists */
-    vector<string> layers = MainWindow::instance()->rasterModelForRead()()->overlays();
-
-    if(::find(layers.begin(), layers.end(), overlay.toStdString()) == layers.end())
+    if(::find(metadata.overlays.begin(), metadata.overlays.end(), overlay.toStdString()) == metadata.overlays.end())
         return false;
 
     _overlays.append(overlay);
@@ -369,16 +378,11 @@ void GraphicsMapView::mouseMoveEvent(QMouseEvent* event) {
 void GraphicsMapView::updateMapArea() {
     if(!isReady()) return;
 
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-
-    /* Compute tile area */
-    unsigned int multiplier = pow2(_zoom-*rasterModel()->zoomLevels().begin());
+    std::map<Zoom, ZoomMetadata>::const_iterator found = metadata.zoomLevels.find(_zoom);
+    current = found == metadata.zoomLevels.end() ? ZoomMetadata() : found->second;
 
     /* Resize map to area */
-    map.setSceneRect(rasterModel()->area().x*rasterModel()->tileSize().x*multiplier,
-                     rasterModel()->area().y*rasterModel()->tileSize().y*multiplier,
-                     rasterModel()->area().w*rasterModel()->tileSize().x*multiplier,
-                     rasterModel()->area().h*rasterModel()->tileSize().y*multiplier);
+    map.setSceneRect(current.sceneRect);
 }
 
 void GraphicsMapView::updateTileCount() {
@@ -391,23 +395,20 @@ void GraphicsMapView::updateTileCount() {
         view->visibleRegion().boundingRect().width(),
         view->visibleRegion().boundingRect().height()));
 
-    /* If map area is smaller than view area, set tile count to map area */
-    unsigned int multiplier = pow2(_zoom-*rasterModel()->zoomLevels().begin());
-    if(tileCount.x > rasterModel()->area().w*multiplier) tileCount.x = rasterModel()->area().w*multiplier;
-    if(tileCount.y > rasterModel()->area().h*multiplier) tileCount.y = rasterModel()->area().h*multiplier;
-
     rasterModel.unlock();
 
+    /* If map area is smaller than view area, set tile count to map area */
+    if(tileCount.x > current.area.w) tileCount.x = current.area.w;
+    if(tileCount.y > current.area.h) tileCount.y = current.area.h;
+
     updateTilePositions();
 }
 
 void GraphicsMapView::updateTilePositions() {
     if(!isReady() || !isVisible()) return;
 
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    TileArea area = rasterModel()->area()*pow2(_zoom-*rasterModel()->zoomLevels().begin());
-    TileSize tileSize = rasterModel()->tileSize();
-    rasterModel.unlock();
+    const TileArea& area = current.area;
+    const TileSize& tileSize = metadata.tileSize;
 
     QPointF viewed = view->mapToScene(0, 0);
 
@@ -461,6 +462,70 @@ void GraphicsMapView::updateTilePositions() {
     }
 }
 
+void GraphicsMapView::setHudEnabled(bool enabled) {
+    MainWindow::instance()->configuration()->group("map")->setValue<bool>("performanceHud", enabled);
+
+    if(enabled) {
+        /* Start measuring intervals from now */
+        decodeTime = 0;
+        decodeCount = 0;
+        lastDownloadedSize = tileDataThread->statistics().downloadedSize;
+        lastMemoryCacheStatistics = MainWindow::instance()->memoryCache()->statistics();
+        hudInterval.start();
+
+        hudTimer->start();
+        updateHud();
+    } else {
+        hudTimer->stop();
+        _hud.clear();
+        view->viewport()->update();
+    }
+}
+
+void GraphicsMapView::updateHud() {
+    double seconds = hudInterval.restart()/1000.0;
+
+    TileDataThread::Statistics jobs = tileDataThread->statistics();
+    MemoryCache::Statistics memory = MainWindow::instance()->memoryCache()->statistics();
+
+    /* Counters could be reset meanwhile */
+    quint64 downloadedSize = jobs.downloadedSize >= lastDownloadedSize ? jobs.downloadedSize-lastDownloadedSize : jobs.downloadedSize;
+    quint64 hits = memory.memoryHits >= lastMemoryCacheStatistics.memoryHits ? memory.memoryHits-lastMemoryCacheStatistics.memoryHits : memory.memoryHits;
+    quint64 misses = memory.memoryMisses >= lastMemoryCacheStatistics.memoryMisses ? memory.memoryMisses-lastMemoryCacheStatistics.memoryMisses : memory.memoryMisses;
+    lastDownloadedSize = jobs.downloadedSize;
+    lastMemoryCacheStatistics = memory;
+
+    QStringList lines;
+    lines << tr("Frame: %0 ms").arg(view->frameTime()/1.0e6, 0, 'f', 1)
+          << tr("Tiles: %0").arg(tiles.size())
+          << tr("Jobs: %0 pending, %1 running, %2 downloaded").arg(jobs.pending).arg(jobs.running).arg(jobs.downloaded)
+          << tr("Decoding: %0 ms/tile").arg(decodeCount ? decodeTime/1.0e6/decodeCount : 0.0, 0, 'f', 2)
+          << tr("Memory cache: %0 % hits").arg(hits+misses ? hits*100/(hits+misses) : 0)
+          << tr("Network: %0 kB/s").arg(seconds > 0 ? downloadedSize/1024.0/seconds : 0.0, 0, 'f', 1);
+    _hud = lines.join("\n");
+
+    decodeTime = 0;
+    decodeCount = 0;
+
+    view->viewport()->update();
+}
+
+void GraphicsMapView::tileData(const QString& layer, Core::Zoom z, const Core::TileCoords& coords, const QByteArray& data) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QPixmap pixmap;
+    {
+        TileTracer::Span span("decode", layer, z, coords);
+        pixmap.loadFromData(data);
+    }
+
+    decodeTime += timer.nsecsElapsed();
+    ++decodeCount;
+
+    tileData(layer, z, coords, pixmap);
+}
+
 void GraphicsMapView::tileData(const QString& layer, Core::Zoom z, const Core::TileCoords& coords, const QPixmap& data) {
     /* Compute layer/overlay number */
     int layerNumber;
@@ -468,12 +533,29 @@ void GraphicsMapView::tileData(const QString& layer, Core::Zoom z, const Core::T
     else layerNumber = _overlays.indexOf(layer)+1;
 
     for(int i = tiles.size()-1; i >= 0; --i) if(tiles[i]->coords() == coords) {
+        TileTracer::Span span("Tile::setLayer", layer, z, coords);
         tiles[i]->setLayer(layerNumber, data);
         break;
     }
 }
 
 void GraphicsMapView::updateRasterModel(const Core::AbstractRasterModel* previous) {
+    /* Precompute metadata of the model, the snapshot is already updated when
+       this is called */
+    QSharedPointer<const RasterModelSnapshot> snapshot = MainWindow::instance()->rasterModelSnapshot();
+    metadata = Metadata();
+    current = ZoomMetadata();
+    metadata.tileSize = snapshot->tileSize;
+    metadata.layers = snapshot->layers;
+    metadata.overlays = snapshot->overlays;
+    for(set<Zoom>::const_iterator it = snapshot->zoomLevels.begin(); it != snapshot->zoomLevels.end(); ++it) {
+        ZoomMetadata& z = metadata.zoomLevels[*it];
+        z.area = snapshot->area*pow2(*it-*snapshot->zoomLevels.begin());
+        z.sceneRect = QRectF(qreal(z.area.x)*metadata.tileSize.x, qreal(z.area.y)*metadata.tileSize.y,
+                             qreal(z.area.w)*metadata.tileSize.x, qreal(z.area.h)*metadata.tileSize.y);
+    }
+    snapshot.clear();
+
     if(!isReady()) return;
 
     /**
@@ -491,21 +573,20 @@ void GraphicsMapView::updateRasterModel(const Core::AbstractRasterModel* previou
     _overlays.clear();
 
     Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    QString layer = QString::fromStdString(rasterModel()->layers()[0]);
+    QString layer = QString::fromStdString(metadata.layers[0]);
     _copyright = QString::fromStdString(rasterModel()->copyright());
 
     updateMapArea();
 
-    Zoom desiredZoom = *rasterModel()->zoomLevels().begin();
+    Zoom desiredZoom = metadata.zoomLevels.begin()->first;
     LatLonCoords desiredCoordinates;
 
     /* If we stay on the same celestial body and both models support coordinate
        conversion and we are on the map, center on the same coordinates and
        nearest zoom level */
     if(previous && previous->celestialBody() == rasterModel()->celestialBody() && (previous->features() & rasterModel()->features() & AbstractRasterModel::ConvertableCoords) && (desiredCoordinates = coords(previous)).isValid()) {
-        set<Zoom> zoomLevels = rasterModel()->zoomLevels();
-        TileSize tileSize = rasterModel()->tileSize();
-        TileArea area = rasterModel()->area();
+        const TileSize& tileSize = metadata.tileSize;
+        const TileArea& area = metadata.zoomLevels.begin()->second.area;
 
         /* Previous coordinates halfway from center to edges */
         LatLonCoords previousTopCoords = coords(previous, QPoint(view->width()/2, view->height()/4));
@@ -552,11 +633,11 @@ void GraphicsMapView::updateRasterModel(const Core::AbstractRasterModel* previou
             );
         }
 
-        set<Zoom>::iterator it = zoomLevels.lower_bound(desiredZoom);
-        if(it == zoomLevels.end())
-            desiredZoom = *zoomLevels.begin();
+        std::map<Zoom, ZoomMetadata>::const_iterator it = metadata.zoomLevels.lower_bound(desiredZoom);
+        if(it == metadata.zoomLevels.end())
+            desiredZoom = metadata.zoomLevels.begin()->first;
         else
-            desiredZoom = *it;
+            desiredZoom = it->first;
 
     } else rasterModel.unlock();
 
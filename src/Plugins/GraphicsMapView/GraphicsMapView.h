@@ -19,9 +19,14 @@
  * @brief Class Kompas::Plugins::GraphicsMapView
  */
 
+#include <map>
+#include <QtCore/QElapsedTimer>
 #include <QtGui/QGraphicsScene>
 
 #include "AbstractMapView.h"
+#include "MemoryCache.h"
+
+class QTimer;
 
 namespace Kompas { namespace Plugins {
 
@@ -31,6 +36,25 @@ class Tile;
 /**
  * @brief Map viewer using QGraphicsView
  *
+ * @section GraphicsMapView-hud Performance overlay
+ * The view can display performance overlay next to map copyright, toggled
+ * with <tt>Ctrl+Alt+P</tt>. It shows duration of last frame, count of tiles
+ * in the view, count of pending and running jobs and downloaded tiles in
+ * TileDataThread, average tile decoding time, memory cache hit rate and
+ * network throughput. All rates and averages are computed over last refresh
+ * interval (half a second).
+ *
+ * @configuration
+ *
+ * <p>Whether the overlay is displayed is stored in <tt>map</tt> group, see
+ * MainWindow class documentation.</p>
+ * <pre>
+ * [map]
+ *
+ * # Whether to display performance overlay
+ * performanceHud=false
+ * </pre>
+ *
  * @todo @c VERSION-0.1.1 Display copyright
  */
 class GraphicsMapView: public QtGui::AbstractMapView {
@@ -72,6 +96,29 @@ class GraphicsMapView: public QtGui::AbstractMapView {
         void mouseMoveEvent(QMouseEvent* event);
 
     private:
+        /** @brief Precomputed data for one zoom level */
+        struct ZoomMetadata {
+            Core::TileArea area;                /**< @brief Tile area */
+            QRectF sceneRect;                   /**< @brief Scene rect */
+        };
+
+        /**
+         * @brief Precomputed raster model metadata
+         *
+         * Rebuilt only in updateRasterModel(), so the interaction paths
+         * (panning, zooming) don't need to lock the raster model or copy
+         * its zoom levels and layers.
+         */
+        struct Metadata {
+            Core::TileSize tileSize;            /**< @brief Tile size */
+            std::map<Core::Zoom, ZoomMetadata> zoomLevels; /**< @brief Zoom levels */
+            std::vector<std::string> layers,    /**< @brief Layers */
+                overlays;                       /**< @brief Overlays */
+        };
+
+        Metadata metadata;                      /**< @brief Raster model metadata */
+        ZoomMetadata current;                   /**< @brief Data for current zoom level */
+
         MapView* view;                          /**< @brief Map view */
         QGraphicsScene map;                     /**< @brief Map scene */
         Core::Coords<unsigned int> tileCount;   /**< @brief Tile count for current view */
@@ -80,12 +127,21 @@ class GraphicsMapView: public QtGui::AbstractMapView {
         QPixmap tileNotFoundImage,              /**< @brief "Tile not found" image */
             tileLoadingImage;                   /**< @brief "Tile loading" image */
 
+        QString _hud;                           /**< @brief Performance overlay text */
+        QTimer* hudTimer;                       /**< @brief Performance overlay refresh timer */
+        QElapsedTimer hudInterval;              /**< @brief Time since last overlay refresh */
+        qint64 decodeTime;                      /**< @brief Tile decoding time since last overlay refresh */
+        unsigned int decodeCount;               /**< @brief Count of decoded tiles since last overlay refresh */
+        quint64 lastDownloadedSize;             /**< @brief Downloaded size at last overlay refresh */
+        QtGui::MemoryCache::Statistics lastMemoryCacheStatistics; /**< @brief Memory cache statistics at last overlay refresh */
+
     private slots:
         /**
          * @brief Update map area
          *
-         * Updates available map area. Called after zooming, adding/removing
-         * map packages or enabling/disabling online maps.
+         * Updates available map area from precomputed metadata. Called
+         * after zooming and raster model changes (adding/removing map
+         * packages, enabling/disabling online maps).
          */
         void updateMapArea();
 
@@ -106,11 +162,21 @@ class GraphicsMapView: public QtGui::AbstractMapView {
          */
         void updateTilePositions();
 
-        void tileData(const QString& layer, Core::Zoom z, const Core::TileCoords& coords, const QByteArray& data) {
-            QPixmap pixmap;
-            pixmap.loadFromData(data);
-            tileData(layer, z, coords, pixmap);
-        }
+        /**
+         * @brief Enable or disable performance overlay
+         *
+         * Saves the state to configuration.
+         */
+        void setHudEnabled(bool enabled);
+
+        /**
+         * @brief Update performance overlay
+         *
+         * Called periodically when the overlay is enabled.
+         */
+        void updateHud();
+
+        void tileData(const QString& layer, Core::Zoom z, const Core::TileCoords& coords, const QByteArray& data);
         inline void tileLoading(const QString& layer, Core::Zoom z, const Core::TileCoords& coords) {
             /* Don't display loading for overlays */
             if(layer == _layer) tileData(layer, z, coords, tileLoadingImage);
@@ -131,6 +197,13 @@ class GraphicsMapView: public QtGui::AbstractMapView {
          */
         Core::LatLonCoords coords(const Core::AbstractRasterModel* rasterModel, const QPoint& pos = QPoint());
 
+        /**
+         * @brief Get current map coordinates for given projection and tile size
+         *
+         * Used by both coords() functions above.
+         */
+        Core::LatLonCoords coords(const Core::AbstractProjection* projection, const Core::TileSize& tileSize, const QPoint& pos);
+
         QString _copyright;
 };
 
@@ -40,36 +40,47 @@ void MapView::resizeEvent(QResizeEvent* event) {
     QTimer::singleShot(0, this, SIGNAL(mapResized()));
 }
 
+void MapView::paintEvent(QPaintEvent* event) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QGraphicsView::paintEvent(event);
+
+    _frameTime = timer.nsecsElapsed();
+}
+
 void MapView::drawForeground(QPainter* painter, const QRectF& _rect) {
-    /* If the copyright is empty, nothing to do */
-    if(_copyright->isEmpty()) return;
+    if(!_copyright->isEmpty()) drawBox(painter, *_copyright, Qt::AlignRight);
+    if(!_hud->isEmpty()) drawBox(painter, *_hud, Qt::AlignLeft);
+}
 
+void MapView::drawBox(QPainter* painter, const QString& text, Qt::Alignment alignment) {
     /* The background rect has margin 1px, the text has left and right margin
        2px, top and bottom margin 1px. */
     QRect textBounds = QRect(QPoint(3, 2), contentsRect().size()-QSize(6, 4));
 
     /* Compute text rectangle from font metrics */
     QFontMetrics metrics = painter->fontMetrics();
-    QRect textRect = metrics.boundingRect(textBounds, 0, *_copyright);
+    QRect textRect = metrics.boundingRect(textBounds, 0, text);
 
-    /* Pixmap for rendering copyright */
-    QPixmap copyright(textRect.width()+6, textRect.height()+4);
-    copyright.fill(QColor(0, 0, 0, 0));
-    QPainter copyrightPainter(&copyright);
+    /* Pixmap for rendering the text */
+    QPixmap box(textRect.width()+6, textRect.height()+4);
+    box.fill(QColor(0, 0, 0, 0));
+    QPainter boxPainter(&box);
 
     /* Draw background with light white brush and no pen */
-    copyrightPainter.setBrush(QBrush(QColor(255, 255, 255, 160)));
-    copyrightPainter.setPen(Qt::NoPen);
-    copyrightPainter.drawRoundedRect(1, 1, copyright.width()-2, copyright.height()-2, 2, 2);
+    boxPainter.setBrush(QBrush(QColor(255, 255, 255, 160)));
+    boxPainter.setPen(Qt::NoPen);
+    boxPainter.drawRoundedRect(1, 1, box.width()-2, box.height()-2, 2, 2);
 
     /* Draw text */
-    copyrightPainter.setPen(QPen(Qt::black));
-    copyrightPainter.drawText(textRect, *_copyright);
+    boxPainter.setPen(QPen(Qt::black));
+    boxPainter.drawText(textRect, text);
 
-    /* Draw the copyright onto the widget */
+    /* Draw the box onto bottom left or right corner of the widget */
     QPoint topLeft = mapToScene(0, 0).toPoint() +
-        QPoint(contentsRect().width() - copyright.width(), contentsRect().height() - copyright.height());
-    painter->drawPixmap(topLeft, copyright);
+        QPoint(alignment & Qt::AlignLeft ? 0 : contentsRect().width() - box.width(), contentsRect().height() - box.height());
+    painter->drawPixmap(topLeft, box);
 }
 
 }}
@@ -19,6 +19,7 @@
  * @brief Class Kompas::Plugins::MapView
  */
 
+#include <QtCore/QElapsedTimer>
 #include <QtGui/QGraphicsView>
 #include <QtGui/QMouseEvent>
 
@@ -31,12 +32,22 @@ class MapView: public QGraphicsView {
     public:
         /**
          * @brief Constructor
+         * @param copyright     Map copyright
+         * @param hud           Performance overlay text, not displayed if
+         *      empty
          * @param parent        Parent widget
          */
-        inline MapView(QString* copyright, QWidget* parent = 0): QGraphicsView(parent), _copyright(copyright) {
+        inline MapView(QString* copyright, QString* hud, QWidget* parent = 0): QGraphicsView(parent), _copyright(copyright), _hud(hud), _frameTime(0) {
             setMouseTracking(true);
         }
 
+        /**
+         * @brief Duration of last frame
+         *
+         * In nanoseconds, measured around whole viewport paint event.
+         */
+        inline qint64 frameTime() const { return _frameTime; }
+
     protected:
         /**
          * @brief Mouse move event
@@ -63,7 +74,19 @@ class MapView: public QGraphicsView {
          */
         void resizeEvent(QResizeEvent* event);
 
-        /** @brief Draws map copyright on bottom right */
+        /**
+         * @brief Paint event
+         * @param event         Event
+         *
+         * Measures frame time.
+         */
+        void paintEvent(QPaintEvent* event);
+
+        /**
+         * @brief Draws map copyright on bottom right
+         *
+         * If performance overlay text is not empty, draws it on bottom left.
+         */
         void drawForeground(QPainter* painter, const QRectF &rect);
 
     signals:
@@ -74,6 +97,10 @@ class MapView: public QGraphicsView {
 
     private:
         QString* _copyright;
+        QString* _hud;
+        qint64 _frameTime;
+
+        void drawBox(QPainter* painter, const QString& text, Qt::Alignment alignment);
 };
 
 }}
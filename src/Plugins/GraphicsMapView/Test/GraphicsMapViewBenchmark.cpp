@@ -0,0 +1,164 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "GraphicsMapViewBenchmark.h"
+
+#include <algorithm>
+#include <vector>
+#include <QtGui/QGraphicsView>
+#include <QtTest/QtTest>
+
+#include "PluginManager/AbstractPluginManager.h"
+#include "Utility/utilities.h"
+#include "MainWindow.h"
+#include "Test/AllocationCounter.h"
+#include "Test/BenchmarkEnvironment.h"
+#include "Test/SyntheticRasterModel.h"
+
+QTEST_MAIN(Kompas::Plugins::Test::GraphicsMapViewBenchmark)
+
+/* Map view plugin has to be registered before MainWindow is created */
+int registerBenchmarkStaticPlugins() {
+    PLUGIN_IMPORT(GraphicsMapView)
+    return 1;
+} AUTOMATIC_INITIALIZER(registerBenchmarkStaticPlugins)
+
+using namespace std;
+using namespace Kompas::Core;
+using namespace Kompas::QtGui;
+using namespace Kompas::QtGui::Test;
+
+namespace Kompas { namespace Plugins { namespace Test {
+
+namespace {
+    template<class T> T percentile(const vector<T>& sorted, int percent) {
+        return sorted[qMin<size_t>(sorted.size()-1, sorted.size()*percent/100)];
+    }
+}
+
+void GraphicsMapViewBenchmark::initTestCase() {
+    useTemporaryHome();
+
+    /* GraphicsMapView is the default map view */
+    mainWindow = new MainWindow;
+    mainWindow->resize(1024, 768);
+    mainWindow->show();
+    QTest::qWaitForWindowShown(mainWindow);
+
+    mapView = mainWindow->mapView();
+    QVERIFY(mapView);
+    view = mapView->findChild<QGraphicsView*>();
+    QVERIFY(view);
+
+    frames = qgetenv("KOMPAS_BENCHMARK_FRAMES").toInt();
+    if(frames <= 0) frames = 200;
+    clock.start();
+}
+
+void GraphicsMapViewBenchmark::cleanupTestCase() {
+    delete mainWindow;
+}
+
+void GraphicsMapViewBenchmark::render_data() {
+    QTest::addColumn<QString>("scenario");
+    QTest::addColumn<int>("tileSize");
+
+    const char* scenarios[] = { "pan", "pan-fast", "wheel-zoom", "zoom-to", "overlays" };
+    const int tileSizes[] = { 256, 512 };
+
+    for(int s = 0; s != 5; ++s) for(int t = 0; t != 2; ++t) {
+        QByteArray name = QString("%0, %1px").arg(scenarios[s]).arg(tileSizes[t]).toUtf8();
+        QTest::newRow(name.constData()) << QString(scenarios[s]) << tileSizes[t];
+    }
+}
+
+void GraphicsMapViewBenchmark::render() {
+    QFETCH(QString, scenario);
+    QFETCH(int, tileSize);
+
+    SyntheticRasterModel::Settings settings;
+    settings.tileSize = TileSize(tileSize, tileSize);
+    settings.minZoom = 2;
+    settings.maxZoom = 16;
+    settings.overlayCount = 3;
+    mainWindow->setRasterModel(new SyntheticRasterModel(settings));
+
+    /* Start in the middle of the map, let initial tiles load */
+    QVERIFY(mapView->zoomTo(10));
+    QTest::qWait(200);
+
+    vector<qint64> times;
+    vector<int> allocations, items;
+    times.reserve(frames);
+    allocations.reserve(frames);
+    items.reserve(frames);
+
+    for(int i = 0; i != frames; ++i) {
+        int allocationsBegin = allocationCount();
+        qint64 begin = clock.nsecsElapsed();
+
+        step(scenario, i, tileSize);
+        QCoreApplication::processEvents();
+        view->viewport()->repaint();
+
+        times.push_back(clock.nsecsElapsed()-begin);
+        allocations.push_back(allocationCount()-allocationsBegin);
+        items.push_back(view->scene()->items().size());
+    }
+
+    sort(times.begin(), times.end());
+    qint64 totalAllocations = 0;
+    for(size_t i = 0; i != allocations.size(); ++i)
+        totalAllocations += allocations[i];
+    sort(allocations.begin(), allocations.end());
+    sort(items.begin(), items.end());
+
+    qDebug("frame p50 %6.2f ms, p95 %6.2f ms, p99 %6.2f ms, max %6.2f ms; allocations/frame avg %lld, max %d; scene items p50 %d, max %d",
+           percentile(times, 50)/1.0e6, percentile(times, 95)/1.0e6,
+           percentile(times, 99)/1.0e6, times.back()/1.0e6,
+           totalAllocations/frames, allocations.back(),
+           percentile(items, 50), items.back());
+    QTest::setBenchmarkResult(percentile(times, 50)/1.0e6, QTest::WalltimeMilliseconds);
+}
+
+void GraphicsMapViewBenchmark::step(const QString& scenario, int frame, int tileSize) {
+    /* Slow panning back and forth, new tiles appear once in a few frames */
+    if(scenario == "pan") {
+        int direction = (frame/50)%2 ? -1 : 1;
+        mapView->move(16*direction, 9*direction);
+
+    /* Fast panning, new column of tiles in every frame */
+    } else if(scenario == "pan-fast") {
+        int direction = (frame/25)%2 ? -1 : 1;
+        mapView->move(tileSize*direction, 0);
+
+    /* Zooming in and out around a point off the center, as with mouse wheel */
+    } else if(scenario == "wheel-zoom") {
+        QPoint pos(view->width()/3, view->height()/3);
+        if((frame/4)%2) mapView->zoomOut(pos);
+        else mapView->zoomIn(pos);
+
+    /* Jumping between distant zoom levels */
+    } else if(scenario == "zoom-to") {
+        mapView->zoomTo(4+(frame*3)%11);
+
+    /* Adding and removing overlays */
+    } else if(scenario == "overlays") {
+        QString overlay = QString("overlay%0").arg((frame/2)%3);
+        if(frame%2) mapView->removeOverlay(overlay);
+        else mapView->addOverlay(overlay);
+    }
+}
+
+}}}
@@ -0,0 +1,81 @@
+#ifndef Kompas_Plugins_Test_GraphicsMapViewBenchmark_h
+#define Kompas_Plugins_Test_GraphicsMapViewBenchmark_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::Test::GraphicsMapViewBenchmark
+ */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QObject>
+
+class QGraphicsView;
+
+namespace Kompas {
+
+namespace QtGui {
+    class AbstractMapView;
+    class MainWindow;
+}
+
+namespace Plugins { namespace Test {
+
+/**
+@brief GraphicsMapView rendering benchmark
+
+Displays GraphicsMapView with QtGui::Test::SyntheticRasterModel and runs
+scripted scenarios through public QtGui::AbstractMapView slots: slow and fast
+panning with @ref QtGui::AbstractMapView::move() "move()", wheel zooming with
+@ref QtGui::AbstractMapView::zoomIn() "zoomIn()" and
+@ref QtGui::AbstractMapView::zoomOut() "zoomOut()" around a point, jumping
+between zoom levels with @ref QtGui::AbstractMapView::zoomTo() "zoomTo()" and
+toggling overlays with @ref QtGui::AbstractMapView::addOverlay() "addOverlay()"
+and @ref QtGui::AbstractMapView::removeOverlay() "removeOverlay()". Each
+scenario step is one frame: the step itself, processing of pending events
+(including tiles which arrived meanwhile) and synchronous repaint of the map
+viewport. For each scenario it reports 50th, 95th and 99th percentile and
+maximum of frame time, heap allocations per frame (see
+QtGui::Test::allocationCount()) and count of items in the scene.
+
+All tiles are in synthetic package, so the benchmark measures rendering and
+not network. Uses temporary configuration directory. Needs a display, on
+headless machines run it under e.g. <tt>xvfb-run</tt>. Count of frames in
+each scenario can be changed with <tt>KOMPAS_BENCHMARK_FRAMES</tt> environment
+variable (default 200).
+*/
+class GraphicsMapViewBenchmark: public QObject {
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+
+        void render_data();
+        void render();
+
+    private:
+        QtGui::MainWindow* mainWindow;
+        QtGui::AbstractMapView* mapView;
+        QGraphicsView* view;
+        QElapsedTimer clock;
+        int frames;
+
+        void step(const QString& scenario, int frame, int tileSize);
+};
+
+}}}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CacheStatisticsDialog.h"
+
+#include <QtCore/QFile>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QFileDialog>
+#include <QtGui/QHeaderView>
+#include <QtGui/QLabel>
+#include <QtGui/QPushButton>
+#include <QtGui/QTreeWidget>
+#include <QtGui/QVBoxLayout>
+
+#include "CachePolicy.h"
+#include "CacheStatistics.h"
+#include "MainWindow.h"
+#include "MessageBox.h"
+
+#ifdef _WIN32
+#undef MessageBox /* I fucking hate windows.h defines! */
+#endif
+
+using namespace std;
+using namespace Kompas::Core;
+using namespace Kompas::QtGui;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+CacheStatisticsDialog::CacheStatisticsDialog(QWidget* parent, Qt::WindowFlags f): QDialog(parent, f) {
+    summary = new QLabel;
+    summary->setWordWrap(true);
+
+    counters = new QTreeWidget;
+    counters->setRootIsDecorated(false);
+    counters->setHeaderLabels(QStringList() << tr("Layer") << tr("Zoom") << tr("Hits") << tr("Misses") << tr("Hit ratio") << tr("Read") << tr("Writes") << tr("Written"));
+    counters->header()->setResizeMode(QHeaderView::ResizeToContents);
+
+    QPushButton* refreshButton = new QPushButton(tr("Refresh"));
+    QPushButton* resetButton = new QPushButton(tr("Reset"));
+    QPushButton* exportButton = new QPushButton(tr("Export..."));
+    connect(refreshButton, SIGNAL(clicked(bool)), SLOT(refresh()));
+    connect(resetButton, SIGNAL(clicked(bool)), SLOT(reset()));
+    connect(exportButton, SIGNAL(clicked(bool)), SLOT(exportJson()));
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    buttons->addButton(refreshButton, QDialogButtonBox::ActionRole);
+    buttons->addButton(resetButton, QDialogButtonBox::ResetRole);
+    buttons->addButton(exportButton, QDialogButtonBox::ActionRole);
+    connect(buttons, SIGNAL(rejected()), SLOT(reject()));
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addWidget(summary);
+    layout->addWidget(counters);
+    layout->addWidget(buttons);
+    setLayout(layout);
+
+    setWindowTitle(tr("Cache statistics"));
+    resize(640, 480);
+
+    refresh();
+}
+
+void CacheStatisticsDialog::refresh() {
+    CacheStatistics* statistics = MainWindow::instance()->cacheStatistics();
+
+    CacheStatistics::Counters total = statistics->total();
+    CacheStatistics::Histogram read = statistics->readLatency();
+    CacheStatistics::Histogram write = statistics->writeLatency();
+    CacheStatistics::Histogram entrySize = statistics->entrySize();
+    quint64 evicted = statistics->evictedSize();
+    qint64 elapsed = statistics->elapsed();
+
+    /* Figures provided by the plugin */
+    QString cacheInfo = tr("No cache is used.");
+    Locker<const AbstractCache> cache = MainWindow::instance()->cacheForRead();
+    if(cache()) cacheInfo = tr("Used %0 of %1 MB, block size %2 B.")
+        .arg(cache()->usedSize()/1024/1024)
+        .arg(cache()->cacheSize()/1024/1024)
+        .arg(cache()->blockSize());
+    cache.unlock();
+
+    quint64 allocated = total.writtenSize+total.wastedSize;
+
+    summary->setText(tr("%0<br />"
+        "Hit ratio: %1 % (%2 hits, %3 misses)<br />"
+        "Lookup latency: average %4 us, 90 % under %5 us, 99 % under %6 us<br />"
+        "Write latency: average %7 us, 90 % under %8 us, 99 % under %9 us<br />"
+        "Average entry size: %10 B, fragmentation %11 %<br />"
+        "Estimated eviction: %12 kB (%13 kB per minute)<br />"
+        "Tiles refused by quotas and policies: %14")
+        .arg(cacheInfo)
+        .arg(total.hitRatio()*100, 0, 'f', 1).arg(total.hits).arg(total.misses)
+        .arg(read.average(), 0, 'f', 0).arg(read.percentile(0.9)).arg(read.percentile(0.99))
+        .arg(write.average(), 0, 'f', 0).arg(write.percentile(0.9)).arg(write.percentile(0.99))
+        .arg(entrySize.average(), 0, 'f', 0)
+        .arg(allocated == 0 ? 0.0 : total.wastedSize*100.0/allocated, 0, 'f', 1)
+        .arg(evicted/1024)
+        .arg(elapsed == 0 ? 0.0 : evicted*60000.0/1024/elapsed, 0, 'f', 1)
+        .arg(MainWindow::instance()->cachePolicy()->rejectedCount()));
+
+    /* Counters for each layer and zoom */
+    counters->clear();
+    QMap<CacheStatistics::LayerZoom, CacheStatistics::Counters> c = statistics->counters();
+    for(QMap<CacheStatistics::LayerZoom, CacheStatistics::Counters>::const_iterator it = c.constBegin(); it != c.constEnd(); ++it) {
+        QTreeWidgetItem* item = new QTreeWidgetItem(counters);
+        item->setText(0, it.key().first);
+        item->setText(1, QString::number(it.key().second));
+        item->setText(2, QString::number(it->hits));
+        item->setText(3, QString::number(it->misses));
+        item->setText(4, QString("%0 %").arg(it->hitRatio()*100, 0, 'f', 1));
+        item->setText(5, QString("%0 kB").arg(it->readSize/1024));
+        item->setText(6, QString::number(it->writes));
+        item->setText(7, QString("%0 kB").arg(it->writtenSize/1024));
+    }
+}
+
+void CacheStatisticsDialog::reset() {
+    MainWindow::instance()->cacheStatistics()->reset();
+    refresh();
+}
+
+void CacheStatisticsDialog::exportJson() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export cache statistics"), QString::fromStdString(MainWindow::instance()->configuration()->group("paths")->value<string>("packages")), tr("JSON files (*.json)"));
+    if(filename.isEmpty()) return;
+
+    Locker<const AbstractCache> cache = MainWindow::instance()->cacheForRead();
+    QByteArray json = MainWindow::instance()->cacheStatistics()->toJson(cache());
+    cache.unlock();
+
+    QFile file(filename);
+    if(!file.open(QFile::WriteOnly|QFile::Truncate) || file.write(json) != json.size())
+        MessageBox::critical(this, tr("Cannot export statistics"), tr("Cannot write to file %0.").arg(filename));
+}
+
+}}}
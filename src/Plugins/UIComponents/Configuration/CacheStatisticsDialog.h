@@ -0,0 +1,59 @@
+#ifndef Kompas_Plugins_UIComponents_CacheStatisticsDialog_h
+#define Kompas_Plugins_UIComponents_CacheStatisticsDialog_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::UIComponents::CacheStatisticsDialog
+ */
+
+#include <QtGui/QDialog>
+
+class QLabel;
+class QTreeWidget;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+/**
+ * @brief Detailed cache statistics
+ *
+ * Displays counters collected in QtGui::CacheStatistics for each layer and
+ * zoom level, latency histogram percentiles, estimated eviction rate and
+ * fragmentation. The statistics can be exported as JSON.
+ */
+class CacheStatisticsDialog: public QDialog {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param parent        Parent widget
+         * @param f             Window flags
+         */
+        CacheStatisticsDialog(QWidget* parent = 0, Qt::WindowFlags f = 0);
+
+    private slots:
+        void refresh();
+        void reset();
+        void exportJson();
+
+    private:
+        QLabel* summary;
+        QTreeWidget* counters;
+};
+
+}}}
+
+#endif
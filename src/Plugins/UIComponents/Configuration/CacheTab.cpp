@@ -29,7 +29,13 @@
 #include <QtGui/QSpinBox>
 #include <QtGui/QToolButton>
 
+#include "CacheStatistics.h"
+#include "CacheImporter.h"
+#include "CacheScrubber.h"
+#include "CacheIndex.h"
+#include "CacheStatisticsDialog.h"
 #include "MainWindow.h"
+#include "MemoryCache.h"
 #include "MessageBox.h"
 #include "PluginManager.h"
 #include "PluginManagerStore.h"
@@ -42,7 +48,7 @@ using namespace Kompas::QtGui;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
-CacheTab::CacheTab(QWidget* parent, Qt::WindowFlags f): AbstractConfigurationWidget(parent, f) {
+CacheTab::CacheTab(QWidget* parent, Qt::WindowFlags f): AbstractConfigurationWidget(parent, f), importer(0) {
     /* Cache model */
     pluginModel = MainWindow::instance()->pluginManagerStore()->caches()->loadedOnlyModel();
 
@@ -70,12 +76,29 @@ CacheTab::CacheTab(QWidget* parent, Qt::WindowFlags f): AbstractConfigurationWid
     blockSize->setMinimum(0);
     blockSize->setMaximum(33554432); /* 32 MB */
 
+    /* Block size recommendation */
+    recommendedBlockSize = new QLabel;
+    useRecommendedBlockSize = new QPushButton(tr("Use"));
+    useRecommendedBlockSize->setDisabled(true);
+    connect(useRecommendedBlockSize, SIGNAL(clicked(bool)), SLOT(useRecommendation()));
+
     /* Cache usage */
     usageLabel = new QLabel(tr("Used size:"));
     usage = new QProgressBar;
     usage->setMinimum(0);
     usage->setMaximum(100);
 
+    /* Memory cache size */
+    memorySize = new QSpinBox;
+    memorySize->setSuffix(" MB");
+    memorySize->setSpecialValueText(tr("Disabled"));
+    memorySize->setMinimum(0);
+    memorySize->setMaximum(1024);
+
+    /* Hit and miss statistics */
+    statistics = new QLabel;
+    statistics->setWordWrap(true);
+
     /* Disable-able configuration */
     configurationGroup = new QGroupBox(tr("Use cache"));
     configurationGroup->setCheckable(true);
@@ -85,6 +108,23 @@ CacheTab::CacheTab(QWidget* parent, Qt::WindowFlags f): AbstractConfigurationWid
     purgeButton = new QPushButton(tr("Purge cache"));
     connect(optimizeButton, SIGNAL(clicked(bool)), SLOT(optimize()));
     connect(purgeButton, SIGNAL(clicked(bool)), SLOT(purge()));
+    importButton = new QPushButton(tr("Import opened packages"));
+    connect(importButton, SIGNAL(clicked(bool)), SLOT(importPackages()));
+
+    /* Raster model for which the packages are imported */
+    rasterModelPluginModel = MainWindow::instance()->pluginManagerStore()->rasterModels()->loadedOnlyModel();
+    importModel = new QComboBox;
+    importModel->setModel(rasterModelPluginModel);
+    importModel->setModelColumn(PluginModel::Name);
+
+    /* Detailed statistics */
+    QPushButton* statisticsButton = new QPushButton(tr("Detailed statistics..."));
+    connect(statisticsButton, SIGNAL(clicked(bool)), SLOT(showStatistics()));
+
+    /* Cancelling long operations */
+    cancelButton = new QPushButton(tr("Cancel"));
+    cancelButton->setDisabled(true);
+    connect(cancelButton, SIGNAL(clicked(bool)), SLOT(cancel()));
 
     /* Emit signal when edited */
     connect(configurationGroup, SIGNAL(toggled(bool)), SIGNAL(edited()));
@@ -92,6 +132,8 @@ CacheTab::CacheTab(QWidget* parent, Qt::WindowFlags f): AbstractConfigurationWid
     connect(dir, SIGNAL(textChanged(QString)), SIGNAL(edited()));
     connect(size, SIGNAL(valueChanged(int)), SIGNAL(edited()));
     connect(blockSize, SIGNAL(valueChanged(int)), SIGNAL(edited()));
+    connect(blockSize, SIGNAL(valueChanged(int)), SLOT(updateRecommendation()));
+    connect(memorySize, SIGNAL(valueChanged(int)), SIGNAL(edited()));
 
     /* If the plugin dir or size is changed, reset cache size and usage fields
        to indicate that new cache is being created */
@@ -109,22 +151,42 @@ CacheTab::CacheTab(QWidget* parent, Qt::WindowFlags f): AbstractConfigurationWid
     formLayout->addRow(tr("Cache dir:"), cacheDirLayout);
     formLayout->addRow(tr("Cache size:"), size);
     formLayout->addRow(tr("Cache block size:"), blockSize);
+    QHBoxLayout* recommendationLayout = new QHBoxLayout;
+    recommendationLayout->addWidget(recommendedBlockSize, 1);
+    recommendationLayout->addWidget(useRecommendedBlockSize);
+    formLayout->addRow(QString(), recommendationLayout);
 
     /* Configuration layout */
     QGridLayout* configurationLayout = new QGridLayout;
     configurationLayout->addLayout(formLayout, 0, 0, 1, 2);
     configurationLayout->setRowStretch(0, 1);
     configurationLayout->addWidget(usageLabel, 1, 0, 1, 2);
-    configurationLayout->addWidget(usage, 2, 0, 1, 2);
+    configurationLayout->addWidget(usage, 2, 0);
+    configurationLayout->addWidget(cancelButton, 2, 1);
     configurationLayout->addWidget(optimizeButton, 3, 0);
     configurationLayout->addWidget(purgeButton, 3, 1);
+    QHBoxLayout* importLayout = new QHBoxLayout;
+    importLayout->addWidget(new QLabel(tr("For map:")));
+    importLayout->addWidget(importModel, 1);
+    configurationLayout->addLayout(importLayout, 4, 0);
+    configurationLayout->addWidget(importButton, 4, 1);
     setLayout(configurationLayout);
 
     configurationGroup->setLayout(configurationLayout);
 
+    /* Memory cache layout */
+    QFormLayout* memoryLayout = new QFormLayout;
+    memoryLayout->addRow(tr("Memory cache size:"), memorySize);
+    memoryLayout->addRow(statistics);
+    memoryLayout->addRow(statisticsButton);
+
+    QGroupBox* memoryGroup = new QGroupBox(tr("Memory cache"));
+    memoryGroup->setLayout(memoryLayout);
+
     /* Layout */
     QVBoxLayout* layout = new QVBoxLayout;
     layout->addWidget(configurationGroup);
+    layout->addWidget(memoryGroup);
     setLayout(layout);
 
     /* Fill in values */
@@ -143,7 +205,17 @@ void CacheTab::reset() {
     QString::fromStdString(conf->value<string>("plugin"))));
     dir->setText(QString::fromStdString(conf->value<string>("path")));
 
+    disconnect(memorySize, SIGNAL(valueChanged(int)), this, SIGNAL(edited()));
+    memorySize->setValue(conf->value<int>("memorySize"));
+    connect(memorySize, SIGNAL(valueChanged(int)), SIGNAL(edited()));
+
+    /* Import for current raster model by default */
+    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
+    if(rasterModel()) importModel->setCurrentIndex(rasterModelPluginModel->findPlugin(QString::fromStdString(rasterModel()->plugin())));
+    rasterModel.unlock();
+
     resetCacheSize();
+    updateStatistics();
 
     /* Connect edited() back */
     connect(plugin, SIGNAL(currentIndexChanged(int)), SIGNAL(edited()));
@@ -188,12 +260,15 @@ void CacheTab::restoreDefaults() {
     conf->removeValue("path");
     conf->removeValue("size");
     conf->removeValue("blockSize");
+    conf->removeValue("memorySize");
     MainWindow::instance()->loadDefaultConfiguration();
 
     /* If the plugin/path was changed, initialize new cache */
     if(plugin != conf->value<string>("plugin") || path != conf->value<string>("path"))
         initialize();
 
+    MainWindow::instance()->memoryCache()->setMaxSize(conf->value<int>("memorySize")*1024*1024);
+
     reset();
 }
 
@@ -202,6 +277,10 @@ void CacheTab::save() {
 
     conf->setValue<bool>("enabled", configurationGroup->isChecked());
 
+    /* Memory cache doesn't need any blocking operation */
+    conf->setValue<int>("memorySize", memorySize->value());
+    MainWindow::instance()->memoryCache()->setMaxSize(memorySize->value()*1024*1024);
+
     /* Modifying already initialized cache */
     if(MainWindow::instance()->cacheForRead()() && pluginModel->index(plugin->currentIndex(), PluginModel::Plugin).data().toString().toStdString() == conf->value<string>("plugin") && dir->text().toStdString() == conf->value<string>("path")) {
         QFutureWatcher<void>* blockSizeWatcher = 0;
@@ -244,10 +323,9 @@ void CacheTab::initialize() {
     AbstractCache* cache = 0;
     if(conf->value<bool>("enabled"))
         cache = MainWindow::instance()->pluginManagerStore()->caches()->manager()->instance(conf->value<string>("plugin"));
-    MainWindow::instance()->setCache(cache);
+    QFuture<void> future = MainWindow::instance()->setCache(cache);
 
     startBlockingOperation(tr("Initializing cache..."));
-    QFuture<void> future = QtConcurrent::run(this, &CacheTab::initializeInternal);
     QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
     watcher->setFuture(future);
     connect(watcher, SIGNAL(finished()), SLOT(finishBlockingOperation()));
@@ -268,7 +346,7 @@ void CacheTab::selectCacheDir() {
 }
 
 void CacheTab::setSize() {
-    startBlockingOperation(tr("Setting cache size to %0 MB...").arg(size->value()));
+    startBlockingOperation(tr("Setting cache size to %0 MB...").arg(size->value()), true);
     QFuture<void> future = QtConcurrent::run(this, &CacheTab::setSizeInternal, size->value());
     QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
     watcher->setFuture(future);
@@ -287,23 +365,101 @@ void CacheTab::purge() {
     if(MessageBox::question(this, tr("Cache purge"), tr("Are you sure you want to remove all items from the cache?"), QMessageBox::Yes|QMessageBox::No, QMessageBox::No) == QMessageBox::No)
         return;
 
-    startBlockingOperation(tr("Purging cache..."));
+    startBlockingOperation(tr("Purging cache..."), true);
     QFuture<void> future = QtConcurrent::run(this, &CacheTab::purgeInternal);
     QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
     watcher->setFuture(future);
     connect(watcher, SIGNAL(finished()), SLOT(finishBlockingOperation()));
 }
 
-void CacheTab::initializeInternal() {
-    /* Wait for the initialization thread in MainWindow to start */
-    sleep(100);
+void CacheTab::importPackages() {
+    if(!MainWindow::instance()->cacheForRead()()) return;
+
+    /* All opened packages */
+    QStringList packages;
+    string plugin;
+    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
+    if(rasterModel()) {
+        plugin = rasterModel()->plugin();
+        for(int i = 0; i != rasterModel()->packageCount(); ++i)
+            packages.append(QString::fromStdString(rasterModel()->packageAttribute(i, AbstractRasterModel::Filename)));
+    }
+    rasterModel.unlock();
+
+    if(packages.isEmpty()) {
+        MessageBox::warning(this, tr("No packages"), tr("There are no opened packages to import into the cache."));
+        return;
+    }
+
+    startBlockingOperation(tr("Importing packages..."), true);
+    string targetPlugin = rasterModelPluginModel->index(importModel->currentIndex(), PluginModel::Plugin).data().toString().toStdString();
+    if(targetPlugin.empty()) targetPlugin = plugin;
+    importer = new CacheImporter(plugin, targetPlugin, packages, this);
+    connect(importer, SIGNAL(progress(int,quint64,double)), SLOT(importProgress(int,quint64,double)));
+    connect(importer, SIGNAL(finished()), SLOT(importFinished()));
+    importer->start(QThread::LowPriority);
+}
+
+void CacheTab::importProgress(int percent, quint64 imported, double tilesPerSecond) {
+    if(!cancelled)
+        usageLabel->setText(tr("Importing packages... %0 tiles imported, %1 tiles per second").arg(imported).arg(tilesPerSecond, 0, 'f', 0));
+    usage->setValue(percent);
+}
+
+void CacheTab::importFinished() {
+    quint64 imported = importer->importedCount();
+    double tilesPerSecond = importer->tilesPerSecond();
+    importer->deleteLater();
+    importer = 0;
+
+    finishBlockingOperation();
+    usageLabel->setText(tr("Imported %0 tiles, %1 tiles per second.").arg(imported).arg(tilesPerSecond, 0, 'f', 0));
+}
+
+bool CacheTab::shrinkInternal(size_t size) {
+    /* Number of steps for shrinking the cache */
+    const size_t steps = 20;
+
+    Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+    if(!cache()) return false;
+
+    /* Setting size above used size doesn't remove anything, do it at once */
+    size_t used = cache()->usedSize();
+    if(used <= size) {
+        cache()->setCacheSize(size);
+        return true;
+    }
+    cache()->setCacheSize(used);
+    cache.unlock();
+
+    /* Remove the tiles in steps, unlock the cache after each of them */
+    for(size_t i = 1; i <= steps; ++i) {
+        if(cancelled) return false;
+
+        Locker<AbstractCache> stepCache = MainWindow::instance()->cacheForWrite();
+        if(!stepCache()) return false;
+        stepCache()->setCacheSize(used-(used-size)*i/steps);
+        stepCache.unlock();
+
+        QMetaObject::invokeMethod(this, "setOperationProgress", Qt::QueuedConnection, Q_ARG(int, static_cast<int>(i*100/steps)));
+    }
 
-    /* Block until the cache is initialized */
-    MainWindow::instance()->cacheForRead()();
+    return true;
 }
 
 void CacheTab::setSizeInternal(size_t size) {
-    MainWindow::instance()->cacheForWrite()()->setCacheSize(size*1024*1024);
+    size *= 1024*1024;
+
+    /* Enlarging the cache doesn't remove anything */
+    Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+    if(!cache()) return;
+    if(cache()->cacheSize() <= size) {
+        cache()->setCacheSize(size);
+        return;
+    }
+    cache.unlock();
+
+    shrinkInternal(size);
 }
 
 void CacheTab::setBlockSizeInternal(size_t size) {
@@ -315,26 +471,85 @@ void CacheTab::optimizeInternal() {
 }
 
 void CacheTab::purgeInternal() {
-    MainWindow::instance()->cacheForWrite()()->purge();
+    Locker<const AbstractCache> cache = MainWindow::instance()->cacheForRead();
+    if(!cache()) return;
+    size_t originalSize = cache()->cacheSize();
+    cache.unlock();
+
+    /* Remove most of the tiles in steps, purge the rest at once and restore
+       original size */
+    bool shrinked = shrinkInternal(0);
+    Locker<AbstractCache> writableCache = MainWindow::instance()->cacheForWrite();
+    if(!writableCache()) return;
+    if(shrinked) writableCache()->purge();
+    writableCache()->setCacheSize(originalSize);
+    writableCache.unlock();
+
+    /* Everything was removed, forget all the tiles */
+    if(shrinked) {
+        MainWindow::instance()->memoryCache()->clear();
+        MainWindow::instance()->cacheIndex()->clear();
+        return;
+    }
+
+    /* Cancelled purge left part of the tiles in the cache, remove the evicted
+       ones from the index. Only tiles of current raster model can be looked
+       up, the others are removed lazily on lookup. */
+    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
+    if(!rasterModel()) return;
+    string model = rasterModel()->plugin();
+    rasterModel.unlock();
+
+    QList<TileKey> tiles = MainWindow::instance()->cacheIndex()->tiles(model);
+    foreach(const TileKey& key, tiles) {
+        Locker<AbstractRasterModel> lookupModel = MainWindow::instance()->rasterModelForWrite();
+        if(!lookupModel() || lookupModel()->plugin() != model) return;
+        Locker<AbstractCache> lookupCache = MainWindow::instance()->cacheForWrite();
+        if(!lookupCache()) return;
+        bool found = !lookupModel()->tileFromCache(lookupCache(), key.layer.toStdString(), key.zoom, key.coords).empty();
+        lookupCache.unlock();
+        lookupModel.unlock();
+
+        MainWindow::instance()->cacheIndex()->update(model, key, found);
+    }
 }
 
-void CacheTab::startBlockingOperation(const QString& description) {
-    usage->setMaximum(0);
+void CacheTab::startBlockingOperation(const QString& description, bool cancellable) {
+    cancelled = 0;
+
+    /* Progress is reported only for cancellable operations */
+    usage->setMaximum(cancellable ? 100 : 0);
+    usage->setValue(0);
     usageLabel->setText(description);
+    cancelButton->setEnabled(cancellable);
 
     plugin->setDisabled(true);
     dir->setDisabled(true);
     size->setDisabled(true);
     blockSize->setDisabled(true);
+    useRecommendedBlockSize->setDisabled(true);
     optimizeButton->setDisabled(true);
     purgeButton->setDisabled(true);
+    importButton->setDisabled(true);
 
     emit blockingOperation(true);
 }
 
+void CacheTab::cancel() {
+    cancelled = 1;
+    if(importer) importer->abort();
+    cancelButton->setDisabled(true);
+    usageLabel->setText(tr("Cancelling..."));
+}
+
+void CacheTab::setOperationProgress(int percent) {
+    usage->setValue(percent);
+}
+
 void CacheTab::finishBlockingOperation() {
     usage->setMaximum(100);
     usageLabel->setText(tr("Used size:"));
+    cancelButton->setDisabled(true);
 
     plugin->setDisabled(false);
     dir->setDisabled(false);
@@ -342,10 +557,66 @@ void CacheTab::finishBlockingOperation() {
     blockSize->setDisabled(false);
     optimizeButton->setDisabled(false);
     purgeButton->setDisabled(false);
+    importButton->setDisabled(false);
 
     resetCacheSize();
+    updateStatistics();
 
     emit blockingOperation(false);
 }
 
+void CacheTab::updateStatistics() {
+    MemoryCache::Statistics s = MainWindow::instance()->memoryCache()->statistics();
+    CacheStatistics::Counters persistent = MainWindow::instance()->cacheStatistics()->total();
+
+    quint64 memoryTotal = s.memoryHits+s.memoryMisses;
+
+    statistics->setText(tr("Memory: %0 tiles (%1 kB), %2 hits, %3 misses (%4 % hit rate)<br />Persistent: %5 hits, %6 misses (%7 % hit rate)")
+        .arg(s.count).arg(s.size/1024)
+        .arg(s.memoryHits).arg(s.memoryMisses)
+        .arg(memoryTotal == 0 ? 0 : s.memoryHits*100/memoryTotal)
+        .arg(persistent.hits).arg(persistent.misses)
+        .arg(static_cast<int>(persistent.hitRatio()*100)));
+
+    CacheScrubber* scrubber = MainWindow::instance()->cacheScrubber();
+    if(scrubber->checkedCount() != 0)
+        statistics->setText(statistics->text() + tr("<br />Integrity check: %0 tiles checked, %1 corrupted tiles dropped")
+            .arg(scrubber->checkedCount()).arg(scrubber->corruptedCount()));
+
+    updateRecommendation();
+}
+
+void CacheTab::updateRecommendation() {
+    CacheStatistics* statistics = MainWindow::instance()->cacheStatistics();
+
+    size_t recommended = statistics->recommendedBlockSize();
+    if(recommended == 0) {
+        recommendedBlockSize->setText(tr("Not enough tiles for block size recommendation."));
+        useRecommendedBlockSize->setDisabled(true);
+        return;
+    }
+
+    /* Estimated storage overhead with current and recommended block size */
+    double current = statistics->storageRatio(blockSize->value());
+    double optimal = statistics->storageRatio(recommended);
+    if(current == 0)
+        recommendedBlockSize->setText(tr("Recommended: %0 B (%1 % overhead)")
+            .arg(recommended).arg((optimal-1)*100, 0, 'f', 0));
+    else
+        recommendedBlockSize->setText(tr("Recommended: %0 B (%1 % overhead, currently %2 %)")
+            .arg(recommended).arg((optimal-1)*100, 0, 'f', 0).arg((current-1)*100, 0, 'f', 0));
+
+    useRecommendedBlockSize->setEnabled(static_cast<size_t>(blockSize->value()) != recommended);
+}
+
+void CacheTab::useRecommendation() {
+    blockSize->setValue(MainWindow::instance()->cacheStatistics()->recommendedBlockSize());
+}
+
+void CacheTab::showStatistics() {
+    CacheStatisticsDialog dialog(this);
+    dialog.exec();
+    updateStatistics();
+}
+
 }}}
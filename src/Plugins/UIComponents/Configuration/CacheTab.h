@@ -19,6 +19,8 @@
  * @brief Class Kompas::Plugins::UIComponents::CacheTab
  */
 
+#include <QtCore/QAtomicInt>
+
 #include "AbstractConfigurationWidget.h"
 
 class QGroupBox;
@@ -32,6 +34,7 @@ class QLineEdit;
 namespace Kompas {
 
 namespace QtGui {
+    class CacheImporter;
     class PluginModel;
 }
 
@@ -41,13 +44,33 @@ namespace Plugins { namespace UIComponents {
 @brief Cache configuration tab
 
 Cache configuration can be slow, thus all operations are done in separate
-thread and the dialog indicates that an operation is in progress.
+thread and the dialog indicates that an operation is in progress. New cache is
+initialized while tiles are still read from the previous one, see
+QtGui::MainWindow::setCache(). Shrinking and purging the cache is done in
+steps, the cache is unlocked between them, so tiles can be read from it
+meanwhile. These two operations report their progress and can be cancelled,
+cancelled shrinking leaves the cache at intermediate size, cancelled purge
+leaves part of the tiles in the cache and removes only the evicted tiles of
+current raster model from QtGui::CacheIndex.
 
 Only cache dir and cache plugin is stored in configuration, cache size and
 block size stores the cache itself. Default values for cache size and block
 size are used only when new cache is set up (the plugin name changes or the dir
 changes). These values are on cache initialization saved as default (and used
 in future as default for new caches).
+
+Size of in-memory cache tier (see QtGui::MemoryCache) is independent on the
+persistent cache and is applied immediately on save. The tab also shows hit
+and miss counts of both tiers and result of last cache integrity check (see
+QtGui::CacheScrubber), detailed persistent cache statistics are shown
+in CacheStatisticsDialog. Block size is recommended from sizes of tiles
+which went through the cache (see QtGui::CacheStatistics::recommendedBlockSize()),
+changing block size of existing cache converts its contents, so it doesn't
+have to be purged.
+
+Tiles from all opened packages can be imported into the cache with
+QtGui::CacheImporter for selected raster model (current one by default), the
+import reports throughput and can be cancelled.
 */
 class CacheTab: public QtGui::AbstractConfigurationWidget {
     Q_OBJECT
@@ -68,22 +91,34 @@ class CacheTab: public QtGui::AbstractConfigurationWidget {
         void setSize();
         void optimize();
         void purge();
+        void importPackages();
+        void importProgress(int percent, quint64 imported, double tilesPerSecond);
+        void importFinished();
 
+        void cancel();
+        void setOperationProgress(int percent);
         void finishBlockingOperation();
+        void updateStatistics();
+        void showStatistics();
+        void updateRecommendation();
+        void useRecommendation();
 
     private:
         QGroupBox* configurationGroup;
-        QtGui::PluginModel *pluginModel;
-        QComboBox *plugin;
-        QLabel* usageLabel;
+        QtGui::PluginModel *pluginModel, *rasterModelPluginModel;
+        QComboBox *plugin, *importModel;
+        QLabel *usageLabel, *statistics, *recommendedBlockSize;
         QLineEdit *dir;
         QProgressBar* usage;
-        QPushButton *optimizeButton, *purgeButton;
-        QSpinBox *size, *blockSize;
+        QPushButton *optimizeButton, *purgeButton, *importButton, *cancelButton, *useRecommendedBlockSize;
+        QtGui::CacheImporter* importer;
+        QSpinBox *size, *blockSize, *memorySize;
+
+        QAtomicInt cancelled;
 
-        void startBlockingOperation(const QString& description);
+        void startBlockingOperation(const QString& description, bool cancellable = false);
 
-        void initializeInternal();
+        bool shrinkInternal(size_t size);
         void setSizeInternal(size_t size);
         void setBlockSizeInternal(size_t size);
         void optimizeInternal();
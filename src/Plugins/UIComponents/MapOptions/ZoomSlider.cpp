@@ -49,11 +49,11 @@ void ZoomSlider::updateRasterModel() {
        connect it back when it's done */
     disconnect(this, SIGNAL(valueChanged(int)), this, SLOT(zoomTo(int)));
 
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    if(rasterModel() && rasterModel()->zoomLevels().size() > 1) {
+    QSharedPointer<const RasterModelSnapshot> rasterModel = MainWindow::instance()->rasterModelSnapshot();
+    if(rasterModel->zoomLevels.size() > 1) {
         setDisabled(false);
-        setMinimum(*rasterModel()->zoomLevels().begin());
-        setMaximum(*--rasterModel()->zoomLevels().end());
+        setMinimum(*rasterModel->zoomLevels.begin());
+        setMaximum(*rasterModel->zoomLevels.rbegin());
     } else {
         setDisabled(true);
         setMinimum(0);
@@ -68,10 +68,8 @@ void ZoomSlider::updateZoom(Core::Zoom z) {
 }
 
 void ZoomSlider::zoomTo(int value) {
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    set<Zoom> levels;
-    if(rasterModel()) levels = rasterModel()->zoomLevels();
-    rasterModel.unlock();
+    QSharedPointer<const RasterModelSnapshot> rasterModel = MainWindow::instance()->rasterModelSnapshot();
+    const set<Zoom>& levels = rasterModel->zoomLevels;
 
     Zoom wanted = static_cast<Zoom>(value);
     set<Zoom>::const_iterator lower = levels.lower_bound(wanted);
@@ -22,14 +22,21 @@
 
 #include "SaveRasterWizard.h"
 #include "MainWindow.h"
+#include "MessageBox.h"
 #include "AbstractMapView.h"
+#include "CustomAreaDialog.h"
 
+#ifdef _WIN32
+#undef MessageBox /* I fucking hate windows.h defines! */
+#endif
+
+using namespace std;
 using namespace Kompas::Core;
 using namespace Kompas::QtGui;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
-AreaPage::AreaPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wizard(_wizard) {
+AreaPage::AreaPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wizard(_wizard), customAreaCorridor(false), corridorWidth(1.0) {
     setTitle(tr("1/5: Map area"));
     setSubTitle(tr("Select map area which you want to save."));
     setPixmap(QWizard::LogoPixmap, QPixmap(":/progress1-48.png"));
@@ -58,19 +65,27 @@ AreaPage::AreaPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wizard(_wiz
     visibleAreaLabel->setAlignment(Qt::AlignJustify);
     customArea = new QRadioButton(tr("Custom area"));
     customArea->setFont(boldFont);
-    customArea->setDisabled(true);
     customAreaSelect = new QPushButton(tr("Select..."));
     customAreaSelect->setDisabled(true);
     connect(customArea, SIGNAL(toggled(bool)), customAreaSelect, SLOT(setEnabled(bool)));
+    connect(customAreaSelect, SIGNAL(clicked(bool)), SLOT(selectCustomArea()));
+    customAreaSummary = new QLabel;
     QLabel* customAreaLabel = new QLabel(tr("This is good if you want to have "
-        "the smallest package size without unneccessary margins."));
+        "the smallest package size without unneccessary margins. Only tiles "
+        "inside given polygon or route corridor are saved."));
     customAreaLabel->setWordWrap(true);
     customAreaLabel->setAlignment(Qt::AlignJustify);
-    customAreaLabel->setDisabled(true);
+
+    /* Custom area can be converted to tiles only if the map has projection */
+    if(!MainWindow::instance()->rasterModelForRead()()->projection()) {
+        customArea->setDisabled(true);
+        customAreaLabel->setDisabled(true);
+    }
 
     QHBoxLayout* customAreaLayout = new QHBoxLayout;
     customAreaLayout->addWidget(customArea);
-    customAreaLayout->addWidget(customAreaSelect, 1, Qt::AlignLeft);
+    customAreaLayout->addWidget(customAreaSelect);
+    customAreaLayout->addWidget(customAreaSummary, 1, Qt::AlignLeft);
 
     QVBoxLayout* layout = new QVBoxLayout;
     layout->addWidget(wholeMap);
@@ -83,7 +98,23 @@ AreaPage::AreaPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wizard(_wiz
     setLayout(layout);
 }
 
+void AreaPage::selectCustomArea() {
+    CustomAreaDialog dialog(customAreaVertices, customAreaCorridor, corridorWidth, this);
+    if(dialog.exec() != QDialog::Accepted) return;
+
+    customAreaVertices = dialog.vertices();
+    customAreaCorridor = dialog.isCorridor();
+    corridorWidth = dialog.width();
+
+    if(customAreaCorridor)
+        customAreaSummary->setText(tr("Route with %0 points, %1 km wide").arg(customAreaVertices.size()).arg(corridorWidth));
+    else
+        customAreaSummary->setText(tr("Polygon with %0 vertices").arg(customAreaVertices.size()));
+}
+
 bool AreaPage::validatePage() {
+    wizard->customArea.clear();
+
     /* Tile count for whole map at _lowest possible_ zoom */
     if(wholeMap->isChecked())
         wizard->absoluteArea = AbsoluteArea<double>(0, 0, 1, 1);
@@ -95,9 +126,35 @@ bool AreaPage::validatePage() {
         /* Tile coordinates in visible area, divide them for smallest zoom */
         wizard->absoluteArea = mapView->viewedArea();
 
-    /* Tile count for selected area at _current_ zoom */
+    /* Bounding area of custom area, computed at _highest possible_ zoom to
+       have it as tight as possible */
     } else {
-        /** @todo @c VERSION-0.2 CustomArea to be implemented... */
+        if(customAreaVertices.empty()) {
+            MessageBox::warning(this, tr("No custom area"), tr("Please select the custom area first."));
+            return false;
+        }
+
+        wizard->customArea = customAreaVertices;
+        wizard->customAreaCorridor = customAreaCorridor;
+        wizard->corridorWidth = corridorWidth;
+
+        Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
+        Zoom maxZoom = *rasterModel()->zoomLevels().rbegin();
+        TileArea modelArea = rasterModel()->area()*pow2(maxZoom-*rasterModel()->zoomLevels().begin());
+        TileArea bounds = wizard->customTileSet(rasterModel(), maxZoom, modelArea).boundingArea();
+        rasterModel.unlock();
+
+        if(bounds.w == 0 || bounds.h == 0) {
+            wizard->customArea.clear();
+            MessageBox::warning(this, tr("Custom area outside the map"), tr("The custom area doesn't contain any part of the map."));
+            return false;
+        }
+
+        wizard->absoluteArea = AbsoluteArea<double>(
+            static_cast<double>(bounds.x-modelArea.x)/modelArea.w,
+            static_cast<double>(bounds.y-modelArea.y)/modelArea.h,
+            static_cast<double>(bounds.x+bounds.w-modelArea.x)/modelArea.w,
+            static_cast<double>(bounds.y+bounds.h-modelArea.y)/modelArea.h);
     }
 
     return true;
@@ -19,8 +19,13 @@
  * @brief Class Kompas::Plugins::UIComponents::AreaPage
  */
 
+#include <vector>
 #include <QtGui/QWizardPage>
 
+#include "LatLonCoords.h"
+
+class QLabel;
+class QPushButton;
 class QRadioButton;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
@@ -30,8 +35,9 @@ class SaveRasterWizard;
 /**
  * @brief Area selection wizard page
  *
- * Provides selection of whole map, visible area or custom specified area.
- * @see SaveRasterWizard::AreaType
+ * Provides selection of whole map, visible area or custom area (polygon or
+ * corridor around route, see CustomAreaDialog). Custom area is available only
+ * if the map has projection.
  */
 class AreaPage: public QWizardPage {
     Q_OBJECT
@@ -46,10 +52,15 @@ class AreaPage: public QWizardPage {
         /**
          * @brief Page validator
          *
-         * Saves selected area type into SaveRasterWizard::areaType.
+         * Saves selected area into SaveRasterWizard::absoluteArea. For custom
+         * area saves also SaveRasterWizard::customArea, the absolute area is
+         * then its bounding area.
          */
         bool validatePage();
 
+    private slots:
+        void selectCustomArea();
+
     private:
         SaveRasterWizard* wizard;
 
@@ -58,6 +69,11 @@ class AreaPage: public QWizardPage {
             *customArea;
 
         QPushButton* customAreaSelect;
+        QLabel* customAreaSummary;
+
+        std::vector<Core::LatLonCoords> customAreaVertices;
+        bool customAreaCorridor;
+        double corridorWidth;
 };
 
 }}}
@@ -16,6 +16,7 @@
 #include "ContentsPage.h"
 
 #include <QtGui/QListView>
+#include <QtGui/QCheckBox>
 #include <QtGui/QGridLayout>
 #include <QtGui/QLabel>
 
@@ -63,6 +64,8 @@ ContentsPage::ContentsPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wiz
         overlaysView->selectionModel()->select(current.sibling(current.row(), RasterLayerModel::Translated), QItemSelectionModel::Select);
     }
 
+    cacheOnly = new QCheckBox(tr("Save only tiles available offline (in packages or cache)"));
+
     QGridLayout* layout = new QGridLayout;
     layout->addWidget(new QLabel(tr("Zoom levels:")), 0, 0);
     layout->addWidget(new QLabel(tr("Layers:")), 0, 1);
@@ -70,6 +73,7 @@ ContentsPage::ContentsPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wiz
     layout->addWidget(zoomLevelsView, 1, 0);
     layout->addWidget(layersView, 1, 1);
     layout->addWidget(overlaysView, 1, 2);
+    layout->addWidget(cacheOnly, 2, 0, 1, 3);
 
     setLayout(layout);
 }
@@ -116,6 +120,8 @@ bool ContentsPage::validatePage() {
     foreach(const QModelIndex& index, overlayList)
         wizard->overlays.push_back(index.sibling(index.row(), RasterOverlayModel::Name).data().toString().toStdString());
 
+    wizard->cacheOnly = cacheOnly->isChecked();
+
     return true;
 }
 
@@ -22,6 +22,7 @@
 #include <QtGui/QWizardPage>
 
 class QListView;
+class QCheckBox;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
@@ -30,7 +31,8 @@ class SaveRasterWizard;
 /**
  * @brief Map contents wizard page
  *
- * Provides three listviews for selecting zoom levels, layers and overlays.
+ * Provides three listviews for selecting zoom levels, layers and overlays and
+ * option for saving only tiles which are available locally.
  */
 class ContentsPage: public QWizardPage {
     Q_OBJECT
@@ -60,8 +62,9 @@ class ContentsPage: public QWizardPage {
          * @brief Page validator
          *
          * Saves selected zoom levels into SaveRasterWizard::zoomLevels,
-         * layers into SaveRasterWizard::layers and overlays into
-         * SaveRasterWizard::overlays.
+         * layers into SaveRasterWizard::layers, overlays into
+         * SaveRasterWizard::overlays and cache-only option into
+         * SaveRasterWizard::cacheOnly.
          */
         bool validatePage();
 
@@ -71,6 +74,7 @@ class ContentsPage: public QWizardPage {
         QListView *zoomLevelsView,
             *layersView,
             *overlaysView;
+        QCheckBox* cacheOnly;
 };
 
 }}}
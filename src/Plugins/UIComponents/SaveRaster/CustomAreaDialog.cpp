@@ -0,0 +1,119 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "CustomAreaDialog.h"
+
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QPlainTextEdit>
+#include <QtGui/QPushButton>
+#include <QtGui/QRadioButton>
+
+#include "AbstractMapView.h"
+#include "MainWindow.h"
+#include "MessageBox.h"
+
+#ifdef _WIN32
+#undef MessageBox /* I fucking hate windows.h defines! */
+#endif
+
+using namespace std;
+using namespace Kompas::Core;
+using namespace Kompas::QtGui;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+CustomAreaDialog::CustomAreaDialog(const vector<LatLonCoords>& vertices, bool _corridor, double width, QWidget* parent, Qt::WindowFlags f): QDialog(parent, f), _vertices(vertices) {
+    polygon = new QRadioButton(tr("Polygon"));
+    corridor = new QRadioButton(tr("Corridor around route"));
+    if(_corridor) corridor->setChecked(true);
+    else polygon->setChecked(true);
+
+    _width = new QDoubleSpinBox;
+    _width->setRange(0.1, 1000.0);
+    _width->setDecimals(1);
+    _width->setSuffix(" km");
+    _width->setValue(width);
+    _width->setEnabled(_corridor);
+    connect(corridor, SIGNAL(toggled(bool)), _width, SLOT(setEnabled(bool)));
+
+    coordinates = new QPlainTextEdit;
+    for(vector<LatLonCoords>::const_iterator it = vertices.begin(); it != vertices.end(); ++it)
+        coordinates->appendPlainText(QString::fromStdString(it->toString(3, true)));
+
+    QPushButton* addCurrent = new QPushButton(tr("Add current position"));
+    connect(addCurrent, SIGNAL(clicked(bool)), SLOT(addCurrentPosition()));
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
+    connect(buttons, SIGNAL(accepted()), SLOT(accept()));
+    connect(buttons, SIGNAL(rejected()), SLOT(reject()));
+
+    QGridLayout* layout = new QGridLayout;
+    layout->addWidget(polygon, 0, 0, 1, 2);
+    layout->addWidget(corridor, 1, 0);
+    layout->addWidget(_width, 1, 1);
+    layout->addWidget(new QLabel(tr("Coordinates, one per line:")), 2, 0, 1, 2);
+    layout->addWidget(coordinates, 3, 0, 1, 2);
+    layout->addWidget(addCurrent, 4, 0, 1, 2, Qt::AlignLeft);
+    layout->addWidget(buttons, 5, 0, 1, 2);
+    layout->setColumnStretch(1, 1);
+    setLayout(layout);
+
+    setWindowTitle(tr("Custom area"));
+    setMinimumWidth(320);
+}
+
+bool CustomAreaDialog::isCorridor() const {
+    return corridor->isChecked();
+}
+
+double CustomAreaDialog::width() const {
+    return _width->value();
+}
+
+void CustomAreaDialog::accept() {
+    vector<LatLonCoords> parsed;
+    QStringList lines = coordinates->toPlainText().split('\n', QString::SkipEmptyParts);
+    foreach(const QString& line, lines) {
+        if(line.trimmed().isEmpty()) continue;
+
+        LatLonCoords c(line.trimmed().toStdString());
+        if(!c.isValid()) {
+            MessageBox::warning(this, tr("Invalid coordinates"), tr("Cannot parse coordinates <strong>%0</strong>.").arg(line.trimmed()));
+            return;
+        }
+
+        parsed.push_back(c);
+    }
+
+    if(parsed.size() < (corridor->isChecked() ? 1u : 3u)) {
+        MessageBox::warning(this, tr("Not enough coordinates"), corridor->isChecked() ?
+            tr("Please specify at least one point of the route.") :
+            tr("Please specify at least three vertices of the polygon."));
+        return;
+    }
+
+    _vertices = parsed;
+    QDialog::accept();
+}
+
+void CustomAreaDialog::addCurrentPosition() {
+    LatLonCoords c = MainWindow::instance()->mapView()->coords();
+    if(c.isValid()) coordinates->appendPlainText(QString::fromStdString(c.toString(3, true)));
+}
+
+}}}
@@ -0,0 +1,86 @@
+#ifndef Kompas_Plugins_UIComponents_CustomAreaDialog_h
+#define Kompas_Plugins_UIComponents_CustomAreaDialog_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::UIComponents::CustomAreaDialog
+ */
+
+#include <vector>
+#include <QtGui/QDialog>
+
+#include "LatLonCoords.h"
+
+class QDoubleSpinBox;
+class QPlainTextEdit;
+class QRadioButton;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+/**
+ * @brief Dialog for specifying custom area
+ *
+ * The area is either polygon or corridor of given width around polyline (e.g.
+ * planned route). Vertices are entered one per line, current map position can
+ * be appended with a button.
+ */
+class CustomAreaDialog: public QDialog {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param vertices      Initial vertices
+         * @param corridor      Whether the vertices are corridor polyline
+         * @param width         Corridor width in kilometers
+         * @param parent        Parent widget
+         * @param f             Window flags
+         */
+        CustomAreaDialog(const std::vector<Core::LatLonCoords>& vertices, bool corridor, double width, QWidget* parent = 0, Qt::WindowFlags f = 0);
+
+        /** @brief Polygon or polyline vertices */
+        inline std::vector<Core::LatLonCoords> vertices() const { return _vertices; }
+
+        /** @brief Whether the vertices are corridor polyline */
+        bool isCorridor() const;
+
+        /** @brief Corridor width in kilometers */
+        double width() const;
+
+    public slots:
+        /**
+         * @brief Accept the dialog
+         *
+         * Parses the vertices, if they are not valid, displays an error and
+         * doesn't close the dialog.
+         */
+        void accept();
+
+    private slots:
+        void addCurrentPosition();
+
+    private:
+        std::vector<Core::LatLonCoords> _vertices;
+
+        QRadioButton *polygon,
+            *corridor;
+        QDoubleSpinBox* _width;
+        QPlainTextEdit* coordinates;
+};
+
+}}}
+
+#endif
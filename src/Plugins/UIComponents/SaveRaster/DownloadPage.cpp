@@ -49,6 +49,8 @@ DownloadPage::DownloadPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wiz
     currentLayer = new QLabel;
     totalCompleted = new QProgressBar;
     currentZoomLayerCompleted = new QProgressBar;
+    summary = new QLabel;
+    summary->setWordWrap(true);
 
     QCheckBox* openWhenFinished = new QCheckBox(tr("Open the package when finished"));
     openWhenFinished->setChecked(wizard->openWhenFinished);
@@ -62,9 +64,10 @@ DownloadPage::DownloadPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wiz
     layout->addWidget(currentZoomLayerCompleted, 3, 0, 1, 2);
     layout->addWidget(new QLabel(tr("Total progress:")), 4, 0, 1, 2);
     layout->addWidget(totalCompleted, 5, 0, 1, 2);
-    layout->addWidget(openWhenFinished, 6, 0, 1, 2);
+    layout->addWidget(summary, 6, 0, 1, 2);
+    layout->addWidget(openWhenFinished, 7, 0, 1, 2);
     layout->setRowMinimumHeight(1, 48);
-    layout->setRowMinimumHeight(6, 48);
+    layout->setRowMinimumHeight(7, 48);
     setLayout(layout);
 }
 
@@ -75,6 +78,7 @@ void DownloadPage::initializePage() {
     TileArea area = wizard->area();
 
     updateStatus(0, 0, "", 0, 0, 0);
+    summary->setText("");
 
     if(!saveThread->initializePackage(wizard->model, wizard->filename, wizard->tileSize, wizard->zoomLevels, area, wizard->layers, wizard->overlays)) {
         filename->setText(tr("Failed to initialize package %0").arg(QString::fromStdString(wizard->filename)));
@@ -89,6 +93,9 @@ void DownloadPage::initializePage() {
     if(!wizard->packager.empty())
         saveThread->setPackageAttribute(AbstractRasterModel::Packager, wizard->packager);
 
+    saveThread->setTileSets(wizard->tileSets());
+    saveThread->setTranscoding(wizard->transcoding);
+    saveThread->setCacheOnly(wizard->cacheOnly);
     saveThread->start();
 }
 
@@ -114,6 +121,29 @@ void DownloadPage::updateStatus(Zoom _currentZoom, int currentZoomNumber, const
 void DownloadPage::completed() {
     filename->setText(tr("Package completed."));
 
+    /* Deduplication statistics */
+    SaveRasterThread::Statistics statistics = saveThread->statistics();
+    QString size = QString::number(statistics.size/(1024.0*1024.0), 'f', 1);
+    QString uniqueSize = QString::number(statistics.uniqueSize/(1024.0*1024.0), 'f', 1);
+    QString ratio = QString::number(statistics.ratio()*100, 'f', 1);
+    summary->setText(tr("%0 of %1 tiles are unique (%2 MB of %3 MB), storing identical tiles only once would save %4 %.")
+        .arg(statistics.uniqueTileCount).arg(statistics.tileCount).arg(uniqueSize).arg(size).arg(ratio));
+
+    /* Recompression statistics */
+    if(statistics.transcodedTileCount) {
+        double saved = (static_cast<double>(statistics.transcodedOriginalSize)-statistics.transcodedSize)/(1024.0*1024.0);
+        double savedRatio = statistics.transcodedOriginalSize == 0 ? 0.0 :
+            1.0-static_cast<double>(statistics.transcodedSize)/statistics.transcodedOriginalSize;
+        double seconds = statistics.transcodingTime/1000000.0;
+        double throughput = seconds == 0 ? 0.0 : statistics.transcodedOriginalSize/(1024.0*1024.0)/seconds;
+
+        summary->setText(summary->text() + "\n" + tr("Recompression of %0 tiles saved %1 MB (%2 %), throughput %3 MB/s per thread.")
+            .arg(statistics.transcodedTileCount)
+            .arg(saved, 0, 'f', 1)
+            .arg(savedRatio*100, 0, 'f', 1)
+            .arg(throughput, 0, 'f', 1));
+    }
+
     _isComplete = true;
     wizard->button(QWizard::CancelButton)->setDisabled(true);
     emit completeChanged();
@@ -34,7 +34,8 @@ class SaveRasterThread;
 /**
  * @brief Download wizard page
  *
- * Downloads all tile data and creates the package.
+ * Downloads all tile data and creates the package. When finished, displays
+ * how many tiles are duplicate and how much recompression saved.
  */
 class DownloadPage: public QWizardPage {
     Q_OBJECT
@@ -73,7 +74,8 @@ class DownloadPage: public QWizardPage {
 
         QLabel *filename,
             *currentZoom,
-            *currentLayer;
+            *currentLayer,
+            *summary;
 
         QProgressBar *totalCompleted,
             *currentZoomLayerCompleted;
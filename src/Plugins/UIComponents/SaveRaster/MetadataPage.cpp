@@ -16,15 +16,20 @@
 #include "MetadataPage.h"
 
 #include <QtCore/QFileInfo>
+#include <QtGui/QComboBox>
 #include <QtGui/QGridLayout>
+#include <QtGui/QGroupBox>
 #include <QtGui/QLineEdit>
 #include <QtGui/QFileDialog>
 #include <QtGui/QLabel>
 #include <QtGui/QPushButton>
+#include <QtGui/QSpinBox>
 
 #include "SaveRasterWizard.h"
 #include "MessageBox.h"
 #include "MainWindow.h"
+#include "RasterLayerModel.h"
+#include "RasterOverlayModel.h"
 
 using namespace std;
 using namespace Kompas::Core;
@@ -60,9 +65,70 @@ MetadataPage::MetadataPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wiz
     layout->addWidget(new QLabel(tr("Packager:")), 3, 0);
     layout->addWidget(packager, 3, 1);
 
+    /* Recompression settings, populated in initializePage() */
+    QGroupBox* transcodingGroup = new QGroupBox(tr("Tile recompression"));
+    transcodingLayout = new QGridLayout;
+    transcodingGroup->setLayout(transcodingLayout);
+    layout->addWidget(transcodingGroup, 4, 0, 1, 2);
+
     setLayout(layout);
 }
 
+void MetadataPage::initializePage() {
+    /* Remove previous settings */
+    QLayoutItem* item;
+    while((item = transcodingLayout->takeAt(0))) {
+        delete item->widget();
+        delete item;
+    }
+    transcodingLayers.clear();
+    transcodingModes.clear();
+    transcodingQualities.clear();
+
+    transcodingLayers = wizard->layers;
+    transcodingLayers.insert(transcodingLayers.end(), wizard->overlays.begin(), wizard->overlays.end());
+
+    for(vector<string>::const_iterator it = transcodingLayers.begin(); it != transcodingLayers.end(); ++it) {
+        int row = it-transcodingLayers.begin();
+
+        /* Get translated layer name */
+        QString layer;
+        QModelIndex found = MainWindow::instance()->rasterLayerModel()->find(QString::fromStdString(*it));
+        if(found.isValid()) layer = found.sibling(found.row(), RasterLayerModel::Translated).data().toString();
+        else {
+            found = MainWindow::instance()->rasterOverlayModel()->find(QString::fromStdString(*it));
+            if(found.isValid()) layer = found.sibling(found.row(), RasterOverlayModel::Translated).data().toString();
+            else layer = QString::fromStdString(*it);
+        }
+
+        /* Previous settings, if any */
+        TileTranscoder::Settings settings;
+        map<string, TileTranscoder::Settings>::const_iterator previous = wizard->transcoding.find(*it);
+        if(previous != wizard->transcoding.end()) settings = previous->second;
+
+        QComboBox* mode = new QComboBox;
+        mode->addItem(tr("Keep original"), TileTranscoder::None);
+        mode->addItem(tr("PNG, 256 colors"), TileTranscoder::PngPalette);
+        mode->addItem(tr("JPEG"), TileTranscoder::Jpeg);
+        mode->addItem(tr("PNG, lossless optimization"), TileTranscoder::PngOptimize);
+        mode->setCurrentIndex(mode->findData(settings.mode));
+        connect(mode, SIGNAL(currentIndexChanged(int)), SLOT(updateQuality()));
+
+        QSpinBox* quality = new QSpinBox;
+        quality->setRange(0, 100);
+        quality->setValue(settings.quality);
+        quality->setPrefix(tr("Quality: "));
+
+        transcodingLayout->addWidget(new QLabel(layer), row, 0);
+        transcodingLayout->addWidget(mode, row, 1);
+        transcodingLayout->addWidget(quality, row, 2);
+        transcodingModes.append(mode);
+        transcodingQualities.append(quality);
+    }
+
+    updateQuality();
+}
+
 bool MetadataPage::isComplete() const {
     if(filename->text().isEmpty()) return false;
     else return true;
@@ -76,9 +142,21 @@ bool MetadataPage::validatePage() {
     wizard->description = description->text().toStdString();
     wizard->packager = packager->text().toStdString();
 
+    wizard->transcoding.clear();
+    for(int i = 0; i != transcodingModes.size(); ++i)
+        wizard->transcoding[transcodingLayers[i]] = TileTranscoder::Settings(
+            static_cast<TileTranscoder::Mode>(transcodingModes[i]->itemData(transcodingModes[i]->currentIndex()).toInt()),
+            transcodingQualities[i]->value());
+
     return true;
 }
 
+void MetadataPage::updateQuality() {
+    /* Quality makes sense only for JPEG */
+    for(int i = 0; i != transcodingModes.size(); ++i)
+        transcodingQualities[i]->setEnabled(transcodingModes[i]->itemData(transcodingModes[i]->currentIndex()).toInt() == TileTranscoder::Jpeg);
+}
+
 void MetadataPage::saveFileDialog(QString path) {
     /* Compose file extension filter, if available */
     QString extensions;
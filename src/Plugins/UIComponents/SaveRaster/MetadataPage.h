@@ -19,9 +19,14 @@
  * @brief Class Kompas::Plugins::UIComponents::MetadataPage
  */
 
+#include <string>
+#include <vector>
 #include <QtGui/QWizardPage>
 
+class QComboBox;
+class QGridLayout;
 class QLineEdit;
+class QSpinBox;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
@@ -30,8 +35,9 @@ class SaveRasterWizard;
 /**
  * @brief Metadata wizard page
  *
- * Allows user to specify package filename and package metadata (name,
- * description, packager name).
+ * Allows user to specify package filename, package metadata (name,
+ * description, packager name) and tile recompression for each saved layer and
+ * overlay.
  */
 class MetadataPage: public QWizardPage {
     Q_OBJECT
@@ -49,16 +55,26 @@ class MetadataPage: public QWizardPage {
          */
         bool isComplete() const;
 
+        /**
+         * @brief Page initializer
+         *
+         * Populates recompression settings with selected layers and
+         * overlays.
+         */
+        void initializePage();
+
         /**
          * @brief Page validator
          *
          * Saves data to SaveRasterWizard::filename, SaveRasterWizard::name,
-         * SaveRasterWizard::description and SaveRasterWizard::packager.
+         * SaveRasterWizard::description, SaveRasterWizard::packager and
+         * SaveRasterWizard::transcoding.
          */
         bool validatePage();
 
     private slots:
         void saveFileDialog(QString path = "");
+        void updateQuality();
 
     private:
         SaveRasterWizard* wizard;
@@ -68,6 +84,11 @@ class MetadataPage: public QWizardPage {
             *description,
             *packager;
 
+        QGridLayout* transcodingLayout;
+        std::vector<std::string> transcodingLayers;
+        QList<QComboBox*> transcodingModes;
+        QList<QSpinBox*> transcodingQualities;
+
         bool checkSaveFile(const QString& filename);
 };
 
@@ -15,10 +15,23 @@
 
 #include "SaveRasterThread.h"
 
+#include <algorithm>
+#include <cstring>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMetaType>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QtConcurrentMap>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkReply>
 
+#include "CacheIndex.h"
+#include "CacheWriteQueue.h"
 #include "MainWindow.h"
 #include "PluginManager.h"
 #include "PluginManagerStore.h"
@@ -32,7 +45,145 @@ Q_DECLARE_METATYPE(std::string)
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
-SaveRasterThread::SaveRasterThread(QObject* parent): QThread(parent), abort(false), destinationModel(0) {
+namespace {
+    /* Count of local tiles fetched with model and cache locked at once */
+    const unsigned int localBatchSize = 16;
+}
+
+/* One zoom level and layer pair written through its own model instance */
+class SaveRasterThread::Shard: public QRunnable {
+    public:
+        inline Shard(SaveRasterThread* _thread, AbstractRasterModel* _shardModel, Zoom _zoom, int _zoomNumber, const string& _layer, int _layerNumber): thread(_thread), shardModel(_shardModel), zoom(_zoom), zoomNumber(_zoomNumber), layer(_layer), layerNumber(_layerNumber) {}
+
+        void run();
+
+    private:
+        SaveRasterThread* thread;
+        AbstractRasterModel* shardModel;
+        Zoom zoom;
+        int zoomNumber;
+        string layer;
+        int layerNumber;
+};
+
+/* Recompression functor for QtConcurrent */
+class SaveRasterThread::Transcode {
+    public:
+        typedef void result_type;
+
+        inline Transcode(SaveRasterThread* _thread, const TileTranscoder::Settings& _settings): thread(_thread), settings(_settings) {}
+
+        inline void operator()(string& data) { thread->transcode(settings, data); }
+
+    private:
+        SaveRasterThread* thread;
+        TileTranscoder::Settings settings;
+};
+
+void SaveRasterThread::Shard::run() {
+    if(thread->abort) return;
+
+    /* Tile area and tiles to save for this zoom level */
+    TileArea currentArea = thread->area*pow2(zoom-thread->zoomLevels[0]);
+    const TileSet& tileSet = thread->tileSets[zoomNumber-1];
+    quint64 currentAreaSize = tileSet.count();
+
+    /* Shard contains only one zoom level and one layer or overlay */
+    vector<Zoom> shardZoomLevels(1, zoom);
+    vector<string> shardLayers, shardOverlays;
+    if(static_cast<size_t>(layerNumber-1) < thread->overlayStart)
+        shardLayers.push_back(layer);
+    else
+        shardOverlays.push_back(layer);
+
+    /* Partial metadata go to temporary file, only tiles are shared with the
+       package */
+    QString metadataFilename = thread->shardFilename(zoomNumber, layerNumber);
+    if(!shardModel->initializePackage(metadataFilename.toStdString(), thread->tileSize, shardZoomLevels, currentArea, shardLayers, shardOverlays)) {
+        thread->failed = 1;
+        thread->abort = 1;
+        return;
+    }
+
+    /* Network manager has to live in the thread where it is used */
+    QNetworkAccessManager manager;
+
+    TileTranscoder::Settings settings = thread->transcodingSettings(layer);
+
+    int lastTotalCompleted = -1, lastCurrentCompleted = -1;
+    quint64 tilesCompleted = 0;
+    vector<string> spanData;
+    QElapsedTimer timer;
+    for(vector<TileSet::Span>::const_iterator it = tileSet.spans().begin(); it != tileSet.spans().end(); ++it) {
+        /* First try to get tiles of whole span from file or cache */
+        timer.start();
+        thread->localTileData(layer, zoom, *it, spanData);
+        thread->addTime(&Statistics::fetchTime, timer);
+
+        for(unsigned int col = it->begin; col != it->end; ++col) {
+            if(thread->abort) {
+                shardModel->finalizePackage();
+                QFile::remove(metadataFilename);
+                return;
+            }
+
+            TileCoords coords(col, it->row);
+            string& data = spanData[col-it->begin];
+
+            if(data.empty() && !thread->cacheOnly) {
+                timer.start();
+                data = thread->downloadTileData(&manager, layer, zoom, coords);
+                thread->cacheTileData(layer, zoom, coords, data);
+                thread->addTime(&Statistics::fetchTime, timer);
+            }
+            thread->transcode(settings, data);
+
+            /* Missing tiles are not saved if saving only local tiles */
+            timer.start();
+            bool saved = (data.empty() && thread->cacheOnly) || thread->tileToPackage(shardModel, layer, zoom, coords, data);
+            thread->addTime(&Statistics::writeTime, timer);
+            if(!saved) {
+                shardModel->finalizePackage();
+                QFile::remove(metadataFilename);
+                thread->failed = 1;
+                thread->abort = 1;
+                return;
+            }
+
+            /* Update progress, emit it only if something visibly changed */
+            thread->progressMutex.lock();
+            int totalCompleted = ++thread->completedCount*100/thread->totalCount;
+            thread->progressMutex.unlock();
+            int currentCompleted = ++tilesCompleted*100/currentAreaSize;
+
+            if(totalCompleted != lastTotalCompleted || currentCompleted != lastCurrentCompleted) {
+                emit thread->completeChanged(zoom, zoomNumber, layer, layerNumber, totalCompleted, currentCompleted);
+                lastTotalCompleted = totalCompleted;
+                lastCurrentCompleted = currentCompleted;
+            }
+        }
+    }
+
+    timer.start();
+    shardModel->finalizePackage();
+    QFile::remove(metadataFilename);
+    thread->addTime(&Statistics::finalizationTime, timer);
+}
+
+bool SaveRasterThread::supportsShardedWriting(const string& model) {
+    vector<string> models = MainWindow::instance()->configuration()->group("saveRaster")->values<string>("shardedWriting");
+    if(::find(models.begin(), models.end(), model) == models.end()) return false;
+
+    /* Independent files are possible only in multi-file formats */
+    AbstractRasterModel* instance = MainWindow::instance()->pluginManagerStore()->rasterModels()->manager()->instance(model);
+    if(!instance) return false;
+    bool supported = instance->features() & AbstractRasterModel::MultipleFileFormat;
+    delete instance;
+
+    return supported;
+}
+
+SaveRasterThread::SaveRasterThread(QObject* parent): QThread(parent), abort(0), failed(0), sharded(false), cacheOnly(false), destinationModel(0), overlayStart(0), maxWriterThreads(0), rasterModelGeneration(0), totalCount(0), completedCount(0) {
     manager = new QNetworkAccessManager(this);
     connect(this, SIGNAL(download(std::string,Core::Zoom,Core::TileCoords)), SLOT(startDownload(std::string,Core::Zoom,Core::TileCoords)));
     connect(manager, SIGNAL(finished(QNetworkReply*)), SLOT(finishDownload(QNetworkReply*)));
@@ -41,7 +192,7 @@ SaveRasterThread::SaveRasterThread(QObject* parent): QThread(parent), abort(fals
 
 SaveRasterThread::~SaveRasterThread() {
     /* Schedule thread to abort and wake it up, if it waits for download to finish */
-    abort = true;
+    abort = 1;
     condition.wakeOne();
 
     /* Wait for thread to finish */
@@ -52,9 +203,11 @@ SaveRasterThread::~SaveRasterThread() {
         destinationModel->finalizePackage();
         delete destinationModel;
     }
+
+    deleteShardModels();
 }
 
-bool SaveRasterThread::initializePackage(const string& model, const string& filename, const TileSize& tileSize, const vector<Zoom>& _zoomLevels, const TileArea& _area, const vector<string>& _layers, const vector<string>& overlays) {
+bool SaveRasterThread::initializePackage(const string& _model, const string& _filename, const TileSize& _tileSize, const vector<Zoom>& _zoomLevels, const TileArea& _area, const vector<string>& _layers, const vector<string>& overlays) {
     /* Cleanup previous */
     if(destinationModel) {
         delete destinationModel;
@@ -62,22 +215,49 @@ bool SaveRasterThread::initializePackage(const string& model, const string& file
         zoomLevels.clear();
         area = TileArea();
         layers.clear();
+        tileSets.clear();
     }
+    deleteShardModels();
 
     /* Get model instance */
-    if(!(destinationModel = MainWindow::instance()->pluginManagerStore()->rasterModels()->manager()->instance(model)))
+    if(!(destinationModel = MainWindow::instance()->pluginManagerStore()->rasterModels()->manager()->instance(_model)))
         return false;
 
     /* Initialize package */
-    if(!destinationModel->initializePackage(filename, tileSize, _zoomLevels, _area, _layers, overlays))
+    if(!destinationModel->initializePackage(_filename, _tileSize, _zoomLevels, _area, _layers, overlays))
         return false;
 
     /* Save area, zoom levels, merged layers and overlays */
+    model = _model;
+    filename = _filename;
+    tileSize = _tileSize;
     zoomLevels = _zoomLevels;
     area = _area;
     layers = _layers;
+    overlayStart = layers.size();
     layers.insert(layers.end(), overlays.begin(), overlays.end());
 
+    /* Save whole area in each zoom level, until said otherwise */
+    tileSets.clear();
+    for(vector<Zoom>::const_iterator it = zoomLevels.begin(); it != zoomLevels.end(); ++it)
+        tileSets.push_back(TileSet::fromArea(area*pow2(*it-zoomLevels[0])));
+
+    /* Shard the package only if there is more than one shard */
+    sharded = zoomLevels.size()*layers.size() > 1 && supportsShardedWriting(model);
+    maxWriterThreads = MainWindow::instance()->configuration()->group("saveRaster")->value<int>("maxWriterThreads");
+    if(maxWriterThreads <= 0) maxWriterThreads = QThread::idealThreadCount();
+
+    /* Shard instances are created here, as plugin manager is not thread-safe.
+       One for each zoom level and layer pair, in the order of runSharded(). */
+    if(sharded) for(size_t i = 0; i != zoomLevels.size()*layers.size(); ++i) {
+        AbstractRasterModel* instance = MainWindow::instance()->pluginManagerStore()->rasterModels()->manager()->instance(model);
+        if(!instance) {
+            deleteShardModels();
+            return false;
+        }
+        shardModels.push_back(instance);
+    }
+
     return true;
 }
 
@@ -85,49 +265,79 @@ void SaveRasterThread::run() {
     if(!destinationModel) return;
 
     /* Compute tile count for all zoom levels */
-    quint64 totalZoom = 0;
-    for(vector<Zoom>::const_iterator zit = zoomLevels.begin(); zit != zoomLevels.end(); ++zit) {
-        TileArea currentArea = area*pow2(*zit-zoomLevels[0]);
-        totalZoom += static_cast<quint64>(currentArea.w)*currentArea.h;
+    progressMutex.lock();
+    totalCount = 0;
+    completedCount = 0;
+    _statistics = Statistics();
+    writtenTiles.clear();
+    progressMutex.unlock();
+
+    /* Tiles downloaded after raster model change are not cached */
+    rasterModelGeneration = MainWindow::instance()->rasterModelGeneration();
+
+    QElapsedTimer timer;
+    timer.start();
+    for(vector<TileSet>::const_iterator it = tileSets.begin(); it != tileSets.end(); ++it)
+        totalCount += it->count();
+    totalCount *= layers.size();
+    addTime(&Statistics::enumerationTime, timer);
+
+    if(sharded) runSharded();
+    else runSequential();
+
+    progressMutex.lock();
+    writtenTiles.clear();
+    progressMutex.unlock();
+
+    if(abort || failed) {
+        if(failed) emit error();
+        return;
     }
-    totalZoom *= layers.size();
 
+    /* Main model is finalized last, so its metadata (containing all zoom
+       levels and layers) replace metadata written by particular shards */
+    timer.start();
+    destinationModel->finalizePackage();
+    delete destinationModel;
+    destinationModel = 0;
+    addTime(&Statistics::finalizationTime, timer);
+    emit completed();
+}
+
+void SaveRasterThread::runSequential() {
     /* Foreach all zoom levels */
     quint64 completedZoom = 0;
     for(vector<Zoom>::const_iterator zit = zoomLevels.begin(); zit != zoomLevels.end(); ++zit) {
         Zoom zoom(*zit);
 
-        /* Compute tile area for this level */
-        TileArea currentArea = area*pow2(zoom-zoomLevels[0]);
+        /* Tiles to save in this level */
+        const TileSet& tileSet = tileSets[zit-zoomLevels.begin()];
 
-        quint64 currentAreaSize = static_cast<quint64>(currentArea.w)*currentArea.h;
+        quint64 currentAreaSize = tileSet.count();
 
         /* Foreach all layers */
         int completedLayers = 0;
         for(vector<string>::const_iterator lit = layers.begin(); lit != layers.end(); ++lit) {
             string layer(*lit);
 
-            /* Foreach all rows */
-            for(unsigned int row = 0; row != currentArea.h; ++row) {
-
-                /* Foreach all columns */
-                for(unsigned int col = 0; col != currentArea.w; ++col) {
-                    if(abort) return;
-
-                    TileCoords coords(currentArea.x+col, currentArea.y+row);
-
-                    Locker<AbstractRasterModel> model = MainWindow::instance()->rasterModelForWrite();
+            TileTranscoder::Settings settings = transcodingSettings(layer);
 
-                    /* First try to get tile from file */
-                    string data = model()->tileFromPackage(layer, zoom, coords);
+            /* Foreach all rows (or their parts) */
+            quint64 tilesCompleted = 0;
+            vector<string> spanData;
+            QElapsedTimer timer;
+            for(vector<TileSet::Span>::const_iterator it = tileSet.spans().begin(); it != tileSet.spans().end(); ++it) {
+                /* First try to get tiles of whole span from file or cache */
+                timer.start();
+                localTileData(layer, zoom, *it, spanData);
 
-                    /* Then from cache */
-                    if(data.empty())
-                        data = model()->tileFromCache(MainWindow::instance()->cacheForWrite()(), layer, zoom, coords);
+                /* Download the rest */
+                if(!cacheOnly) for(unsigned int col = it->begin; col != it->end; ++col) {
+                    if(abort) return;
 
-                    model.unlock();
+                    TileCoords coords(col, it->row);
+                    string& data = spanData[col-it->begin];
 
-                    /* Otherwise download */
                     if(data.empty()) {
                         emit download(layer, zoom, coords);
                         mutex.lock();
@@ -135,16 +345,33 @@ void SaveRasterThread::run() {
                         mutex.unlock();
 
                         data = lastDownloadedData;
+                        cacheTileData(layer, zoom, coords, data);
                     }
+                }
+                addTime(&Statistics::fetchTime, timer);
+
+                /* Recompress the span in parallel */
+                if(settings.mode != TileTranscoder::None)
+                    QtConcurrent::blockingMap(spanData, Transcode(this, settings));
 
-                    if(!destinationModel->tileToPackage(layer, zoom, coords, data)) {
-                        emit error();
+                /* Write the span */
+                for(unsigned int col = it->begin; col != it->end; ++col) {
+                    if(abort) return;
+
+                    TileCoords coords(col, it->row);
+
+                    /* Missing tiles are not saved if saving only local tiles */
+                    timer.start();
+                    const string& data = spanData[col-it->begin];
+                    if((!data.empty() || !cacheOnly) && !tileToPackage(destinationModel, layer, zoom, coords, data)) {
+                        failed = 1;
                         return;
                     }
+                    addTime(&Statistics::writeTime, timer);
 
-                    int tilesCompleted = (static_cast<quint64>(row)*currentArea.w+col+1);
+                    ++tilesCompleted;
 
-                    emit completeChanged(zoom, zit-zoomLevels.begin()+1, layer, completedLayers+1, (completedZoom+currentAreaSize*completedLayers+tilesCompleted)*100/totalZoom, tilesCompleted*100/currentAreaSize);
+                    emit completeChanged(zoom, zit-zoomLevels.begin()+1, layer, completedLayers+1, (completedZoom+currentAreaSize*completedLayers+tilesCompleted)*100/totalCount, tilesCompleted*100/currentAreaSize);
                 }
             }
 
@@ -153,11 +380,150 @@ void SaveRasterThread::run() {
 
         completedZoom += currentAreaSize*layers.size();
     }
+}
 
-    destinationModel->finalizePackage();
-    delete destinationModel;
-    destinationModel = 0;
-    emit completed();
+void SaveRasterThread::runSharded() {
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxWriterThreads);
+
+    /* One shard for each zoom level and layer pair */
+    vector<AbstractRasterModel*>::const_iterator shardModel = shardModels.begin();
+    for(vector<Zoom>::const_iterator zit = zoomLevels.begin(); zit != zoomLevels.end(); ++zit)
+        for(vector<string>::const_iterator lit = layers.begin(); lit != layers.end(); ++lit)
+            pool.start(new Shard(this, *shardModel++, *zit, zit-zoomLevels.begin()+1, *lit, lit-layers.begin()+1));
+
+    pool.waitForDone();
+    deleteShardModels();
+}
+
+void SaveRasterThread::deleteShardModels() {
+    for(vector<AbstractRasterModel*>::const_iterator it = shardModels.begin(); it != shardModels.end(); ++it)
+        delete *it;
+    shardModels.clear();
+}
+
+QString SaveRasterThread::shardFilename(int zoomNumber, int layerNumber) const {
+    /* E.g. map.conf -> map.shard-1-2.conf, in the same directory */
+    QFileInfo info(QString::fromStdString(filename));
+    QString name = QString("%0.shard-%1-%2").arg(info.completeBaseName()).arg(zoomNumber).arg(layerNumber);
+    if(!info.suffix().isEmpty()) name += '.' + info.suffix();
+    return info.dir().filePath(name);
+}
+
+SaveRasterThread::Statistics SaveRasterThread::statistics() {
+    QMutexLocker locker(&progressMutex);
+    return _statistics;
+}
+
+void SaveRasterThread::addTime(quint64 Statistics::*time, const QElapsedTimer& timer) {
+    qint64 elapsed = timer.nsecsElapsed()/1000;
+
+    QMutexLocker locker(&progressMutex);
+    _statistics.*time += elapsed;
+}
+
+TileTranscoder::Settings SaveRasterThread::transcodingSettings(const string& layer) const {
+    map<string, TileTranscoder::Settings>::const_iterator found = transcoding.find(layer);
+    if(found == transcoding.end()) return TileTranscoder::Settings();
+    return found->second;
+}
+
+void SaveRasterThread::transcode(const TileTranscoder::Settings& settings, string& data) {
+    if(settings.mode == TileTranscoder::None || data.empty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    string transcoded = TileTranscoder::transcode(data, settings);
+    qint64 elapsed = timer.nsecsElapsed()/1000;
+
+    progressMutex.lock();
+    ++_statistics.transcodedTileCount;
+    _statistics.transcodedOriginalSize += data.size();
+    _statistics.transcodedSize += transcoded.size();
+    _statistics.transcodingTime += elapsed;
+    progressMutex.unlock();
+
+    data.swap(transcoded);
+}
+
+bool SaveRasterThread::tileToPackage(AbstractRasterModel* model, const string& layer, Zoom zoom, const TileCoords& coords, const string& data) {
+    /* First 64 bits of the digest are enough for statistics */
+    QByteArray digest = QCryptographicHash::hash(QByteArray::fromRawData(data.data(), data.size()), QCryptographicHash::Sha1);
+    quint64 hash;
+    memcpy(&hash, digest.constData(), sizeof(hash));
+
+    /* Hashes are shared by all shards, they are not remembered after the
+       limit is reached */
+    progressMutex.lock();
+    bool unique = !writtenTiles.contains(hash);
+    if(unique && writtenTiles.size() < MaxTileHashes) writtenTiles.insert(hash);
+    ++_statistics.tileCount;
+    _statistics.size += data.size();
+    if(unique) {
+        ++_statistics.uniqueTileCount;
+        _statistics.uniqueSize += data.size();
+    }
+    progressMutex.unlock();
+
+    return model->tileToPackage(layer, zoom, coords, data);
+}
+
+void SaveRasterThread::localTileData(const string& layer, Zoom zoom, const TileSet::Span& span, vector<string>& data) {
+    data.assign(span.end-span.begin, string());
+
+    QString layerName = QString::fromStdString(layer);
+    CacheIndex* index = MainWindow::instance()->cacheIndex();
+
+    /* Lock the model and cache only for a small batch of tiles, so the map
+       and cache writes aren't blocked for whole span */
+    for(unsigned int begin = span.begin; begin < span.end; begin += localBatchSize) {
+        Locker<AbstractRasterModel> model = MainWindow::instance()->rasterModelForWrite();
+        if(!model()) return;
+        Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+        string plugin = model()->plugin();
+
+        unsigned int end = qMin(span.end, begin+localBatchSize);
+        for(unsigned int col = begin; col != end; ++col) {
+            TileCoords coords(col, span.row);
+            string& d = data[col-span.begin];
+
+            /* First try to get tile from file, then from cache */
+            d = model()->tileFromPackage(layer, zoom, coords);
+            if(!d.empty() || !cache()) continue;
+
+            /* When saving only local tiles, don't probe the cache for tiles
+               which aren't in the index */
+            TileKey key(layerName, zoom, coords);
+            if(cacheOnly && !index->contains(plugin, key)) continue;
+
+            d = model()->tileFromCache(cache(), layer, zoom, coords);
+            index->update(plugin, key, !d.empty());
+        }
+    }
+}
+
+void SaveRasterThread::cacheTileData(const string& layer, Zoom zoom, const TileCoords& coords, const string& data) {
+    if(data.empty()) return;
+
+    MainWindow::instance()->cacheWriteQueue()->enqueue(TileKey(QString::fromStdString(layer), zoom, coords), QByteArray(data.data(), data.size()), rasterModelGeneration);
+}
+
+string SaveRasterThread::downloadTileData(QNetworkAccessManager* manager, const string& layer, Zoom zoom, const TileCoords& coords) {
+    QString url = QString::fromStdString(MainWindow::instance()->rasterModelForRead()()->tileUrl(layer, zoom, coords));
+
+    /* Wait for the download in local event loop */
+    QNetworkReply* reply = manager->get(QNetworkRequest(QUrl(url)));
+    QEventLoop loop;
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+
+    /* Failed responses are not tiles, treat them as missing */
+    QByteArray data;
+    if(reply->error() == QNetworkReply::NoError && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200)
+        data = reply->readAll();
+    delete reply;
+
+    return string(data.data(), data.size());
 }
 
 void SaveRasterThread::startDownload(const string& layer, Zoom zoom, const TileCoords& coords) {
@@ -165,7 +531,10 @@ void SaveRasterThread::startDownload(const string& layer, Zoom zoom, const TileC
 }
 
 void SaveRasterThread::finishDownload(QNetworkReply* reply) {
-    QByteArray data = reply->readAll();
+    /* Failed responses are not tiles, treat them as missing */
+    QByteArray data;
+    if(reply->error() == QNetworkReply::NoError && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200)
+        data = reply->readAll();
     lastDownloadedData.assign(data.data(), data.size());
     reply->deleteLater();
     condition.wakeOne();
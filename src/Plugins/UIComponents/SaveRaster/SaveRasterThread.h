@@ -19,21 +19,142 @@
  * @brief Class Kompas::Plugins::UIComponents::SaveRasterThread
  */
 
+#include <map>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QThread>
 #include <QtCore/QMutex>
+#include <QtCore/QSet>
 #include <QtCore/QWaitCondition>
 #include <QtNetwork/QNetworkAccessManager>
 
 #include "AbstractRasterModel.h"
 #include "MainWindow.h"
+#include "TileSet.h"
+#include "TileTranscoder.h"
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
-/** @brief Thread for saving raster package */
+/**
+@brief Thread for saving raster package
+
+Tiles are fetched from source model packages, cache or downloaded and written to
+destination model one by one. Locally available tiles are fetched a whole row
+span at a time, with source model and cache locked once for a small batch of
+tiles. When saving only local tiles, the cache is probed only for tiles in
+QtGui::MainWindow::cacheIndex(). Only tiles in given tile sets are saved (see
+@ref setTileSets()), the rest of package area is left empty. If destination
+model stores each zoom level and layer in independent files (see
+@ref supportsShardedWriting()), the work is split into shards, one per zoom
+level and layer pair, which are fetched and written in parallel, each shard
+through its own destination model instance. The shard instances are created in
+@ref initializePackage(), as plugin manager must not be accessed from multiple
+threads at once. Each shard writes its partial metadata into its own temporary
+file next to the package, which is removed after the shard is finalized, so the
+package metadata are written only through the main destination model instance.
+
+All tiles are hashed before writing and the hashes are used only for
+reporting how much could be saved by storing identical tiles only once (see
+@ref statistics()), the tiles are still written to the package one by one, as
+no raster model is able to store one tile referenced by many coordinates yet.
+Identical tiles are detected in scope of whole package, also across shards.
+Only first 64 bits of each hash are kept and at most @ref MaxTileHashes of
+them, tiles written after that are detected as duplicate only if identical to
+some of the remembered ones, so the memory usage stays bounded even for huge
+packages.
+
+Downloaded tiles are also written to cache through
+QtGui::MainWindow::cacheWriteQueue(), subject to cache quotas (see
+QtGui::CachePolicy). Tiles can be optionally recompressed before writing, see
+@ref setTranscoding().
+
+For sequential writing, tiles are fetched one row span at a time and each span
+is recompressed in parallel on global thread pool, for sharded writing each
+shard recompresses its tiles itself.
+
+@configuration
+
+<p>Configuration is stored in <tt>saveRaster</tt> group.</p>
+<pre>
+[saveRaster]
+
+# Raster model plugins which store each zoom level and layer in independent
+# files and thus can be written in parallel. The files must be placed relative
+# to package directory, independently of metadata file name. The model must
+# also have Core::AbstractRasterModel::MultipleFileFormat feature. Empty by
+# default, the key can be repeated for more plugins, e.g.
+# shardedWriting=KompasRasterModel
+shardedWriting=
+
+# Max count of parallel writers, 0 means QThread::idealThreadCount()
+maxWriterThreads=0
+</pre>
+*/
 class SaveRasterThread: public QThread {
     Q_OBJECT
 
     public:
+        /** @brief Max count of remembered tile hashes */
+        static const int MaxTileHashes = 1 << 20;
+
+        /** @brief Package writing statistics */
+        struct Statistics {
+            /** @brief Constructor */
+            inline Statistics(): tileCount(0), uniqueTileCount(0), size(0), uniqueSize(0), transcodedTileCount(0), transcodedOriginalSize(0), transcodedSize(0), transcodingTime(0), enumerationTime(0), fetchTime(0), writeTime(0), finalizationTime(0) {}
+
+            quint64 tileCount,          /**< @brief Count of all written tiles */
+                uniqueTileCount;        /**< @brief Count of unique tiles */
+            quint64 size,               /**< @brief Size of all written tiles */
+                uniqueSize;             /**< @brief Size of unique tiles */
+
+            /**
+             * @brief Deduplication ratio
+             *
+             * Fraction of data size which could be saved by storing
+             * identical tiles only once. If more than @ref MaxTileHashes
+             * unique tiles were written, it is only a lower bound.
+             */
+            inline double ratio() const {
+                return size == 0 ? 0.0 : 1.0-static_cast<double>(uniqueSize)/size;
+            }
+
+            /** @brief Count of tiles passed through recompression */
+            quint64 transcodedTileCount;
+            quint64 transcodedOriginalSize, /**< @brief Size of recompressed tiles before recompression */
+                transcodedSize;         /**< @brief Size of recompressed tiles after recompression */
+
+            /**
+             * @brief Time spent in recompression
+             *
+             * In microseconds, summed for all threads.
+             */
+            quint64 transcodingTime;
+
+            /**
+             * @brief Time spent in particular stages
+             *
+             * In microseconds, summed for all threads. Enumeration is
+             * counting tiles to save, fetching is reading tiles from
+             * source model packages and cache and downloading the rest,
+             * writing includes hashing and deduplication and finalization
+             * is finalizing all destination model instances. Recompression
+             * is not included, see @ref transcodingTime.
+             */
+            quint64 enumerationTime,
+                fetchTime,              /**< @copydoc enumerationTime */
+                writeTime,              /**< @copydoc enumerationTime */
+                finalizationTime;       /**< @copydoc enumerationTime */
+        };
+
+        /**
+         * @brief Whether given destination model supports sharded writing
+         * @param model     Model plugin name
+         *
+         * True if the model is listed in <tt>shardedWriting</tt> configuration
+         * key and has Core::AbstractRasterModel::MultipleFileFormat feature.
+         */
+        static bool supportsShardedWriting(const std::string& model);
+
         /**
          * @brief Constructor
          * @param parent    Parent object
@@ -48,12 +169,58 @@ class SaveRasterThread: public QThread {
          */
         bool initializePackage(const std::string& model, const std::string& filename, const Core::TileSize& tileSize, const std::vector<Core::Zoom>& zoomLevels, const Core::TileArea& area, const std::vector<std::string>& layers, const std::vector<std::string>& overlays);
 
+        /**
+         * @brief Set tiles to save
+         * @param sets      Tile set for each zoom level passed to
+         *      initializePackage(), all tiles must be inside the area.
+         *
+         * By default the whole area is saved in each zoom level. Must be
+         * called after initializePackage() and before the thread is started.
+         */
+        inline void setTileSets(const std::vector<TileSet>& sets) {
+            if(sets.size() == zoomLevels.size()) tileSets = sets;
+        }
+
+        /**
+         * @brief Set tile recompression
+         * @param settings  Recompression settings for particular layers and
+         *      overlays. Layers which are not present are not recompressed.
+         *
+         * Must be called before the thread is started.
+         */
+        inline void setTranscoding(const std::map<std::string, TileTranscoder::Settings>& settings) {
+            transcoding = settings;
+        }
+
+        /**
+         * @brief Save only locally available tiles
+         *
+         * If enabled, tiles which are not in source model packages or in
+         * cache are not downloaded and not written to the package. Must be
+         * called before the thread is started.
+         */
+        inline void setCacheOnly(bool enabled) { cacheOnly = enabled; }
+
         /** @copydoc Core::AbstractRasterModel::setPackageAttribute() */
         inline bool setPackageAttribute(Core::AbstractRasterModel::PackageAttribute type, const std::string& data) {
             if(!destinationModel) return false;
             return destinationModel->setPackageAttribute(type, data);
         }
 
+        /**
+         * @brief Whether the package is written in shards
+         *
+         * Available after successful initializePackage().
+         */
+        inline bool isSharded() const { return sharded; }
+
+        /**
+         * @brief Package writing statistics
+         *
+         * Safe to call while the thread is running.
+         */
+        Statistics statistics();
+
         /** @brief Run the thread */
         void run();
 
@@ -88,7 +255,11 @@ class SaveRasterThread: public QThread {
         void finishDownload(QNetworkReply* reply);
 
     private:
-        bool abort;
+        class Shard;
+        class Transcode;
+
+        QAtomicInt abort, failed;
+        bool sharded, cacheOnly;
 
         QNetworkAccessManager* manager;
         QMutex mutex;
@@ -96,10 +267,40 @@ class SaveRasterThread: public QThread {
         std::string lastDownloadedData;
 
         Core::AbstractRasterModel* destinationModel;
+        std::vector<Core::AbstractRasterModel*> shardModels;
 
+        std::string model, filename;
+        Core::TileSize tileSize;
         std::vector<Core::Zoom> zoomLevels;
         Core::TileArea area;
+        std::vector<TileSet> tileSets;
         std::vector<std::string> layers;
+        std::size_t overlayStart;
+        int maxWriterThreads;
+        int rasterModelGeneration;
+        QSet<quint64> writtenTiles;
+        std::map<std::string, TileTranscoder::Settings> transcoding;
+
+        QMutex progressMutex;
+        quint64 totalCount, completedCount;
+        Statistics _statistics;
+
+        void runSequential();
+        void runSharded();
+
+        void deleteShardModels();
+        QString shardFilename(int zoomNumber, int layerNumber) const;
+
+        void addTime(quint64 Statistics::*time, const QElapsedTimer& timer);
+
+        TileTranscoder::Settings transcodingSettings(const std::string& layer) const;
+        void transcode(const TileTranscoder::Settings& settings, std::string& data);
+
+        bool tileToPackage(Core::AbstractRasterModel* model, const std::string& layer, Core::Zoom zoom, const Core::TileCoords& coords, const std::string& data);
+
+        void localTileData(const std::string& layer, Core::Zoom zoom, const TileSet::Span& span, std::vector<std::string>& data);
+        void cacheTileData(const std::string& layer, Core::Zoom zoom, const Core::TileCoords& coords, const std::string& data);
+        std::string downloadTileData(QNetworkAccessManager* manager, const std::string& layer, Core::Zoom zoom, const Core::TileCoords& coords);
 };
 
 }}}
@@ -16,6 +16,7 @@
 #include "SaveRasterWizard.h"
 
 #include <cmath>
+#include <set>
 #include <QtGui/QGroupBox>
 #include <QtGui/QGridLayout>
 #include <QtGui/QLabel>
@@ -27,6 +28,8 @@
 #include <QtGui/QProgressBar>
 #include <QtGui/QCheckBox>
 
+#include "AbstractProjection.h"
+#include "CacheIndex.h"
 #include "MainWindow.h"
 #include "RasterLayerModel.h"
 #include "RasterOverlayModel.h"
@@ -48,7 +51,7 @@ using namespace Kompas::QtGui;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
-SaveRasterWizard::SaveRasterWizard(const string& _model, QWidget* parent, Qt::WindowFlags flags): QWizard(parent, flags), model(_model), features(0), openWhenFinished(false) {
+SaveRasterWizard::SaveRasterWizard(const string& _model, QWidget* parent, Qt::WindowFlags flags): QWizard(parent, flags), model(_model), features(0), customAreaCorridor(false), corridorWidth(1.0), cacheOnly(false), openWhenFinished(false) {
     addPage(new AreaPage(this));
     addPage(new ContentsPage(this));
     addPage(new MetadataPage(this));
@@ -131,6 +134,70 @@ TileArea SaveRasterWizard::area() const {
     return ta;
 }
 
+vector<TileSet> SaveRasterWizard::tileSets() const {
+    TileArea a = area();
+
+    vector<TileSet> sets;
+    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
+
+    /* Area covered by opened packages. Tiles from them are not in the
+       index and area of current model can be larger (e.g. whole world, if
+       online), so open the packages in separate offline instance. */
+    AbstractRasterModel* packages = 0;
+    set<Zoom> packageZoomLevels;
+    if(cacheOnly && rasterModel()->packageCount() != 0) {
+        packages = MainWindow::instance()->pluginManagerStore()->rasterModels()->manager()->instance(rasterModel()->plugin());
+        if(packages) {
+            packages->setOnline(false);
+            for(int i = 0; i != rasterModel()->packageCount(); ++i)
+                packages->addPackage(rasterModel()->packageAttribute(i, AbstractRasterModel::Filename));
+            packageZoomLevels = packages->zoomLevels();
+            if(packageZoomLevels.empty()) {
+                delete packages;
+                packages = 0;
+            }
+        }
+    }
+
+    for(vector<Zoom>::const_iterator it = zoomLevels.begin(); it != zoomLevels.end(); ++it) {
+        TileArea currentArea = a*pow2(*it-zoomLevels[0]);
+        if(customArea.empty()) sets.push_back(TileSet::fromArea(currentArea));
+        else sets.push_back(customTileSet(rasterModel(), *it, currentArea));
+
+        /* Restrict to cached tiles and tiles covered by opened packages */
+        if(cacheOnly) {
+            vector<TileCoords> cached;
+            for(vector<string>::const_iterator lit = layers.begin(); lit != layers.end(); ++lit) {
+                vector<TileCoords> t = MainWindow::instance()->cacheIndex()->tiles(rasterModel()->plugin(), QString::fromStdString(*lit), *it);
+                cached.insert(cached.end(), t.begin(), t.end());
+            }
+            for(vector<string>::const_iterator lit = overlays.begin(); lit != overlays.end(); ++lit) {
+                vector<TileCoords> t = MainWindow::instance()->cacheIndex()->tiles(rasterModel()->plugin(), QString::fromStdString(*lit), *it);
+                cached.insert(cached.end(), t.begin(), t.end());
+            }
+            TileSet local = TileSet::fromTiles(cached);
+            if(packages && packageZoomLevels.find(*it) != packageZoomLevels.end())
+                local |= TileSet::fromArea(packages->area()*pow2(*it-*packageZoomLevels.begin()));
+            sets.back() &= local;
+        }
+    }
+
+    delete packages;
+    return sets;
+}
+
+TileSet SaveRasterWizard::customTileSet(const AbstractRasterModel* rasterModel, Zoom zoom, const TileArea& bounds) const {
+    if(!rasterModel->projection()) return TileSet();
+
+    if(customAreaCorridor)
+        return TileSet::fromCorridor(customArea, corridorWidth, rasterModel->projection(), zoom, bounds);
+
+    vector<Coords<double> > polygon;
+    for(vector<LatLonCoords>::const_iterator it = customArea.begin(); it != customArea.end(); ++it)
+        polygon.push_back(rasterModel->projection()->fromLatLon(*it));
+    return TileSet::fromPolygon(polygon, zoom, bounds);
+}
+
 void SaveRasterWizard::done(int result) {
     /* If cancelling unfinished download, display question messagebox */
     if(result == Rejected && currentId() == 4 && !currentPage()->isComplete() && MessageBox::question(this, tr("Download in progress"), tr("Package creation is in progress. Do you really want to cancel the operation?"), QMessageBox::Yes|QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
@@ -23,6 +23,9 @@
 
 #include "AbsoluteArea.h"
 #include "AbstractRasterModel.h"
+#include "LatLonCoords.h"
+#include "TileSet.h"
+#include "TileTranscoder.h"
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
@@ -74,6 +77,16 @@ class SaveRasterWizard: public QWizard {
         Core::TileSize tileSize;        /**< @brief Tile size of source model */
         Core::AbsoluteArea<double> absoluteArea; /**< @brief Area to download */
 
+        /**
+         * @brief Custom area
+         *
+         * Polygon or polyline vertices. If empty, whole absoluteArea is
+         * saved, otherwise absoluteArea is bounding area of it.
+         */
+        std::vector<Core::LatLonCoords> customArea;
+        bool customAreaCorridor;        /**< @brief Whether custom area is corridor around polyline */
+        double corridorWidth;           /**< @brief Corridor width in kilometers */
+
         /**
          * @brief List of zoom levels to save
          */
@@ -82,11 +95,26 @@ class SaveRasterWizard: public QWizard {
             layers,                     /**< @brief Layers to save */
             overlays;                   /**< @brief Overlays to save */
 
+        /**
+         * @brief Whether to save only cached tiles
+         *
+         * If set, only tiles present in source model packages or recorded
+         * in QtGui::MainWindow::cacheIndex() are saved, nothing is
+         * downloaded. Tile sets are restricted to indexed tiles and area of
+         * opened packages.
+         */
+        bool cacheOnly;
+
         std::string filename,           /**< @brief Package filename */
             name,                       /**< @brief Package name */
             description,                /**< @brief Package description */
             packager;                   /**< @brief Packager name */
 
+        /**
+         * @brief Tile recompression settings for layers and overlays
+         */
+        std::map<std::string, TileTranscoder::Settings> transcoding;
+
         bool openWhenFinished;          /**< @brief Whether to open the package when finished */
 
         /**
@@ -97,6 +125,24 @@ class SaveRasterWizard: public QWizard {
          */
         Core::TileArea area() const;
 
+        /**
+         * @brief Tiles to save for each zoom level
+         *
+         * If custom area is set, it is rasterized with source model
+         * projection, otherwise whole area() is saved. If cacheOnly is set and
+         * source model has no packages opened, the sets are restricted to
+         * tiles recorded in cache index for any of saved layers and overlays.
+         */
+        std::vector<TileSet> tileSets() const;
+
+        /**
+         * @brief Custom area rasterized at given zoom level
+         * @param rasterModel   Source model
+         * @param zoom          Zoom level
+         * @param bounds        Area to which the set is clipped
+         */
+        TileSet customTileSet(const Core::AbstractRasterModel* rasterModel, Core::Zoom zoom, const Core::TileArea& bounds) const;
+
         void done(int result);
 };
 
@@ -0,0 +1,283 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "SizeEstimator.h"
+
+#include <cmath>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+
+#include "AbstractCache.h"
+#include "CacheIndex.h"
+#include "MainWindow.h"
+
+using namespace std;
+using namespace Kompas::Core;
+using namespace Kompas::QtGui;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+namespace {
+    /* Quantile of normal distribution for 95% confidence */
+    const double z95 = 1.96;
+
+    /* Size of tile which wasn't sampled at all */
+    const double defaultTileSize = 10240;
+
+    double mean(const QList<double>& values) {
+        double sum = 0;
+        foreach(double value, values) sum += value;
+        return values.isEmpty() ? 0 : sum/values.size();
+    }
+
+    double variance(const QList<double>& values, double mean) {
+        if(values.size() < 2) return mean*mean;
+
+        double sum = 0;
+        foreach(double value, values) sum += (value-mean)*(value-mean);
+        return sum/(values.size()-1);
+    }
+}
+
+SizeEstimator::SizeEstimator(QObject* parent): QThread(parent), _abort(false), networkSamples(0), parallelDownloads(1) {}
+
+SizeEstimator::~SizeEstimator() {
+    abort();
+}
+
+void SizeEstimator::setContents(const vector<Zoom>& _zoomLevels, const vector<TileSet>& _tileSets, const vector<string>& _layers, int _parallelDownloads) {
+    abort();
+
+    zoomLevels = _zoomLevels;
+    tileSets = _tileSets;
+    layers = _layers;
+    parallelDownloads = _parallelDownloads < 1 ? 1 : _parallelDownloads;
+    _estimate = Estimate();
+}
+
+void SizeEstimator::abort() {
+    _abort = true;
+    wait();
+    _abort = false;
+}
+
+void SizeEstimator::run() {
+    if(zoomLevels.empty() || layers.empty()) return;
+
+    /* Network manager has to live in this thread */
+    QNetworkAccessManager manager;
+    networkSamples = 0;
+
+    int total = zoomLevels.size()*layers.size();
+    QList<Sample> samples;
+    for(vector<Zoom>::const_iterator zit = zoomLevels.begin(); zit != zoomLevels.end(); ++zit) {
+        for(vector<string>::const_iterator lit = layers.begin(); lit != layers.end(); ++lit) {
+            if(_abort) return;
+
+            Sample sample;
+            samplePair(&manager, *zit, tileSets[zit-zoomLevels.begin()], *lit, sample);
+            samples.append(sample);
+
+            emit progressChanged(samples.size(), total);
+        }
+    }
+
+    computeEstimate(samples);
+}
+
+void SizeEstimator::samplePair(QNetworkAccessManager* manager, Zoom zoom, const TileSet& tileSet, const string& layer, Sample& sample) {
+    sample.tileCount = tileSet.count();
+    sample.localCount = 0;
+    sample.missingCount = 0;
+
+    /* Network budget is split evenly among all pairs */
+    int networkBudget = qMax<int>(1, maxNetworkSamples/(zoomLevels.size()*layers.size()));
+
+    quint64 count = qMin<quint64>(samplesPerPair, sample.tileCount);
+    for(quint64 i = 0; i != count; ++i) {
+        if(_abort) return;
+
+        /* Spread the samples evenly over the set, offset them within each
+           stratum using golden ratio sequence so they don't end up in one
+           column */
+        double x = 0.5 + i*0.6180339887;
+        x -= floor(x);
+        TileCoords coords = tileSet.at(static_cast<quint64>((i+x)/count*sample.tileCount));
+
+        Locker<AbstractRasterModel> model = MainWindow::instance()->rasterModelForWrite();
+        string data = model()->tileFromPackage(layer, zoom, coords);
+        if(data.empty()) {
+            Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
+            if(cache()) {
+                data = model()->tileFromCache(cache(), layer, zoom, coords);
+                MainWindow::instance()->cacheIndex()->update(model()->plugin(), TileKey(QString::fromStdString(layer), zoom, coords), !data.empty());
+            }
+        }
+        bool online = model()->online();
+        model.unlock();
+
+        /* Tile available locally, it won't be downloaded */
+        if(!data.empty()) {
+            sample.sizes.append(data.size());
+            ++sample.localCount;
+            continue;
+        }
+
+        ++sample.missingCount;
+
+        /* Sample the tile from network, if we still can */
+        if(online && networkBudget && networkSamples < maxNetworkSamples && sampleNetwork(manager, zoom, layer, coords, sample))
+            --networkBudget;
+    }
+}
+
+bool SizeEstimator::sampleNetwork(QNetworkAccessManager* manager, Zoom zoom, const string& layer, const TileCoords& coords, Sample& sample) {
+    QUrl url(QString::fromStdString(MainWindow::instance()->rasterModelForRead()()->tileUrl(layer, zoom, coords)));
+    if(!url.isValid()) return false;
+
+    ++networkSamples;
+
+    /* Try HEAD first, as it is cheaper for the server */
+    QElapsedTimer timer;
+    timer.start();
+    QNetworkReply* reply = manager->head(QNetworkRequest(url));
+    if(!waitForReply(reply)) {
+        delete reply;
+        return false;
+    }
+
+    bool success = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200;
+    qint64 size = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    delete reply;
+
+    /* Server doesn't report content length, download whole tile. Measure only
+       the full download, as it is what will be done when saving. */
+    if(success && size <= 0) {
+        timer.restart();
+        reply = manager->get(QNetworkRequest(url));
+        if(!waitForReply(reply)) {
+            delete reply;
+            return false;
+        }
+
+        success = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200;
+        size = reply->readAll().size();
+        delete reply;
+    }
+
+    if(!success) return false;
+
+    sample.sizes.append(size);
+    sample.downloadTimes.append(timer.elapsed()/1000.0);
+    return true;
+}
+
+bool SizeEstimator::waitForReply(QNetworkReply* reply) {
+    QEventLoop loop;
+    connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+
+    /* Give up on slow or stalled servers */
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+    timeout.start(requestTimeout);
+
+    /* Wake up periodically to check for abort */
+    QTimer abortCheck;
+    connect(&abortCheck, SIGNAL(timeout()), &loop, SLOT(quit()));
+    abortCheck.start(abortCheckInterval);
+
+    while(!reply->isFinished() && timeout.isActive() && !_abort)
+        loop.exec();
+
+    if(reply->isFinished()) return true;
+
+    reply->abort();
+    return false;
+}
+
+void SizeEstimator::computeEstimate(const QList<Sample>& samples) {
+    /* Pooled sizes for pairs without any samples */
+    QList<double> pooledSizes, pooledTimes;
+    foreach(const Sample& sample, samples) {
+        pooledSizes += sample.sizes;
+        pooledTimes += sample.downloadTimes;
+    }
+    double pooledMean = pooledSizes.isEmpty() ? defaultTileSize : mean(pooledSizes);
+    double pooledVariance = pooledSizes.isEmpty() ? defaultTileSize*defaultTileSize : variance(pooledSizes, pooledMean);
+
+    Estimate e;
+    double packageVariance = 0, downloadVariance = 0, downloadCount = 0, downloadCountVariance = 0;
+    foreach(const Sample& sample, samples) {
+        e.sampleCount += sample.sizes.size();
+
+        double m, v;
+        double n = sample.sizes.size();
+        if(n) {
+            m = mean(sample.sizes);
+            v = variance(sample.sizes, m);
+        } else {
+            m = pooledMean;
+            v = pooledVariance;
+            n = 1;
+        }
+
+        /* Finite population correction */
+        double t = sample.tileCount;
+        double fpc = t > 1 ? qMax(0.0, (t-n)/(t-1)) : 0;
+
+        double size = t*m;
+        double sizeVariance = t*t*v/n*fpc;
+        e.packageSize.value += size;
+        packageVariance += sizeVariance;
+
+        /* Portion of tiles which has to be downloaded */
+        double checked = sample.localCount+sample.missingCount;
+        double p = checked ? sample.missingCount/checked : 1;
+        double pVariance = checked ? p*(1-p)/checked : 0;
+
+        e.downloadSize.value += size*p;
+        downloadVariance += p*p*sizeVariance + size*size*pVariance;
+        downloadCount += t*p;
+        downloadCountVariance += t*t*pVariance;
+    }
+
+    e.packageSize.low = qMax(0.0, e.packageSize.value-z95*sqrt(packageVariance));
+    e.packageSize.high = e.packageSize.value+z95*sqrt(packageVariance);
+    e.downloadSize.low = qMax(0.0, e.downloadSize.value-z95*sqrt(downloadVariance));
+    e.downloadSize.high = e.downloadSize.value+z95*sqrt(downloadVariance);
+
+    /* Download time from measured request times */
+    if(!pooledTimes.isEmpty()) {
+        double m = mean(pooledTimes);
+        double v = variance(pooledTimes, m);
+        double n = pooledTimes.size();
+
+        double time = downloadCount*m/parallelDownloads;
+        double timeVariance = (downloadCount*downloadCount*v/n + m*m*downloadCountVariance)/(parallelDownloads*parallelDownloads);
+
+        e.downloadTime.value = time;
+        e.downloadTime.low = qMax(0.0, time-z95*sqrt(timeVariance));
+        e.downloadTime.high = time+z95*sqrt(timeVariance);
+        e.timeAvailable = true;
+    }
+
+    _estimate = e;
+}
+
+}}}
@@ -0,0 +1,146 @@
+#ifndef Kompas_Plugins_UIComponents_SizeEstimator_h
+#define Kompas_Plugins_UIComponents_SizeEstimator_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::UIComponents::SizeEstimator
+ */
+
+#include <QtCore/QThread>
+
+#include "AbstractRasterModel.h"
+#include "TileSet.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+/**
+@brief Download size and time estimator
+
+Instead of assuming a fixed size for every tile, takes a few samples for each
+zoom level and layer pair, spread evenly over the saved tiles. Samples are taken
+from opened packages and cache first, tiles which are not available locally
+are sampled with a limited count of network requests (@c HEAD, or @c GET if the
+server doesn't report content length), each of them is given up after ten
+seconds. The samples are then extrapolated to
+whole tile count with 95% confidence intervals.
+
+The estimation runs in separate thread, progress is reported with
+progressChanged() and the results are available after finished() is emitted.
+*/
+class SizeEstimator: public QThread {
+    Q_OBJECT
+
+    public:
+        /** @brief Estimated value with 95% confidence interval */
+        struct Interval {
+            double value,               /**< @brief Estimated value */
+                low,                    /**< @brief Lower bound */
+                high;                   /**< @brief Upper bound */
+
+            /** @brief Constructor */
+            inline Interval(): value(0), low(0), high(0) {}
+        };
+
+        /** @brief Estimation result */
+        struct Estimate {
+            Interval packageSize;       /**< @brief Package size in bytes */
+            Interval downloadSize;      /**< @brief Size of data to download in bytes */
+            Interval downloadTime;      /**< @brief Download time in seconds */
+            quint64 sampleCount;        /**< @brief Total count of taken samples */
+            bool timeAvailable;         /**< @brief Whether any download was measured */
+
+            /** @brief Constructor */
+            inline Estimate(): sampleCount(0), timeAvailable(false) {}
+        };
+
+        /**
+         * @brief Constructor
+         * @param parent    Parent object
+         */
+        SizeEstimator(QObject* parent = 0);
+
+        /**
+         * @brief Destructor
+         *
+         * Aborts the estimation and waits for the thread to finish.
+         */
+        ~SizeEstimator();
+
+        /**
+         * @brief Set what to estimate
+         * @param zoomLevels    Zoom levels (sorted ascending)
+         * @param tileSets      Tiles to save for each zoom level
+         * @param layers        Layers and overlays
+         * @param parallelDownloads Count of parallel downloads when saving
+         *
+         * Aborts running estimation.
+         */
+        void setContents(const std::vector<Core::Zoom>& zoomLevels, const std::vector<TileSet>& tileSets, const std::vector<std::string>& layers, int parallelDownloads);
+
+        /**
+         * @brief Estimation result
+         *
+         * Valid after finished() signal is emitted.
+         */
+        inline Estimate estimate() const { return _estimate; }
+
+        /** @brief Abort running estimation */
+        void abort();
+
+        /** @brief Run the thread */
+        void run();
+
+    signals:
+        /**
+         * @brief Estimation progress changed
+         * @param done      Count of sampled zoom level and layer pairs
+         * @param total     Count of all zoom level and layer pairs
+         */
+        void progressChanged(int done, int total);
+
+    private:
+        struct Sample {
+            quint64 tileCount;
+            QList<double> sizes, downloadTimes;
+            int localCount, missingCount;
+        };
+
+        static const int samplesPerPair = 8;
+        static const int maxNetworkSamples = 16;
+        static const int requestTimeout = 10000;
+        static const int abortCheckInterval = 100;
+
+        bool _abort;
+        int networkSamples, parallelDownloads;
+
+        std::vector<Core::Zoom> zoomLevels;
+        std::vector<TileSet> tileSets;
+        std::vector<std::string> layers;
+
+        Estimate _estimate;
+
+        void samplePair(QNetworkAccessManager* manager, Core::Zoom zoom, const TileSet& tileSet, const std::string& layer, Sample& sample);
+        bool sampleNetwork(QNetworkAccessManager* manager, Core::Zoom zoom, const std::string& layer, const Core::TileCoords& coords, Sample& sample);
+        bool waitForReply(QNetworkReply* reply);
+        void computeEstimate(const QList<Sample>& samples);
+};
+
+}}}
+
+#endif
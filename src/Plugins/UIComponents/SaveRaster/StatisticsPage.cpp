@@ -19,20 +19,47 @@
 #include <QtGui/QLabel>
 
 #include "AbstractRasterModel.h"
+#include "MainWindow.h"
 #include "SaveRasterWizard.h"
+#include "SaveRasterThread.h"
+#include "SizeEstimator.h"
 
 using namespace std;
 using namespace Corrade::Utility;
 using namespace Kompas::Core;
+using namespace Kompas::QtGui;
 
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
-StatisticsPage::StatisticsPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wizard(_wizard), canDownload(true) {
+namespace {
+    const double megabyte = 1024.0*1024.0;
+    const double gigabyte = 1024.0*megabyte;
+
+    QString formatSize(const SizeEstimator::Interval& size) {
+        return QString("%0 MB (%1 - %2 MB)")
+            .arg(size.value/megabyte, 0, 'f', 1)
+            .arg(size.low/megabyte, 0, 'f', 1)
+            .arg(size.high/megabyte, 0, 'f', 1);
+    }
+
+    QString formatTime(double seconds) {
+        quint64 s = seconds;
+        if(s >= 3600) return QString("%0 h %1 min").arg(s/3600).arg((s%3600)/60);
+        if(s >= 60) return QString("%0 min %1 s").arg(s/60).arg(s%60);
+        return QString("%0 s").arg(s);
+    }
+}
+
+StatisticsPage::StatisticsPage(SaveRasterWizard* _wizard): QWizardPage(_wizard), wizard(_wizard), canDownload(true), estimating(false) {
     setTitle(tr("4/5: Statistics"));
     setSubTitle(tr("Review amount of data to be downloaded, return back and make changes or proceed to creating the package."));
     setPixmap(QWizard::LogoPixmap, QPixmap(":/progress4-48.png"));
     setCommitPage(true);
 
+    estimator = new SizeEstimator(this);
+    connect(estimator, SIGNAL(progressChanged(int,int)), SLOT(estimateProgress(int,int)));
+    connect(estimator, SIGNAL(finished()), SLOT(estimateFinished()));
+
     QFont boldFont;
     boldFont.setBold(true);
 
@@ -41,8 +68,10 @@ StatisticsPage::StatisticsPage(SaveRasterWizard* _wizard): QWizardPage(_wizard),
     tileCountOneLayer = new QLabel;
     layerCount = new QLabel;
     tileCountTotal = new QLabel;
+    packageSize = new QLabel;
     downloadSize = new QLabel;
     downloadSize->setFont(boldFont);
+    downloadTime = new QLabel;
     fupWarning = new QLabel;
     fupWarning->setWordWrap(true);
     fupWarning->setFont(boldFont);
@@ -58,26 +87,28 @@ StatisticsPage::StatisticsPage(SaveRasterWizard* _wizard): QWizardPage(_wizard),
     layout->addWidget(layerCount, 3, 1);
     layout->addWidget(new QLabel(tr("Total tile count:")), 4, 0);
     layout->addWidget(tileCountTotal, 4, 1);
-    layout->addWidget(new QLabel(tr("Estimated download size (10 kB for one tile):")), 5, 0);
-    layout->addWidget(downloadSize, 5, 1);
-    layout->addWidget(fupWarning, 6, 0, 1, 2);
+    layout->addWidget(new QLabel(tr("Estimated package size:")), 5, 0);
+    layout->addWidget(packageSize, 5, 1);
+    layout->addWidget(new QLabel(tr("Estimated download size:")), 6, 0);
+    layout->addWidget(downloadSize, 6, 1);
+    layout->addWidget(new QLabel(tr("Estimated download time:")), 7, 0);
+    layout->addWidget(downloadTime, 7, 1);
+    layout->addWidget(fupWarning, 8, 0, 1, 2);
 
     setLayout(layout);
 }
 
 void StatisticsPage::initializePage() {
-    /* Compute area at lowest zoom level */
-    TileArea area = wizard->area();
+    /* Tiles to save in all zoom levels */
+    vector<TileSet> tileSets = wizard->tileSets();
 
-    tileCountMinZoom->setText(QString::number(area.w*area.h));
-        zoomLevelCount->setText(QString::number(wizard->zoomLevels.size()));
+    tileCountMinZoom->setText(QString::number(tileSets[0].count()));
+    zoomLevelCount->setText(QString::number(wizard->zoomLevels.size()));
 
     /* Tile count for all zoom levels */
     quint64 _tileCountOneLayer = 0;
-    for(vector<Zoom>::const_iterator it = wizard->zoomLevels.begin(); it != wizard->zoomLevels.end(); ++it) {
-        TileArea a = area*pow2(*it-wizard->zoomLevels[0]);
-        _tileCountOneLayer += static_cast<quint64>(a.w)*a.h;
-    }
+    for(vector<TileSet>::const_iterator it = tileSets.begin(); it != tileSets.end(); ++it)
+        _tileCountOneLayer += it->count();
 
     tileCountOneLayer->setText(QString::number(_tileCountOneLayer));
 
@@ -87,29 +118,81 @@ void StatisticsPage::initializePage() {
     quint64 _tileCountTotal = _tileCountOneLayer*_layerCount;
     tileCountTotal->setText(QString::number(_tileCountTotal));
 
-    /* Download size okay, don't display anything */
-    if(_tileCountTotal < 104857) {
-        fupWarning->setText("");
-        canDownload = true;
+    /* Until the estimation is done, assume 10 kB for one tile */
+    double preliminarySize = _tileCountTotal*10240.0;
+    packageSize->setText(tr("%0 MB (10 kB for one tile)").arg(preliminarySize/megabyte, 0, 'f', 1));
+    downloadSize->setText(tr("Estimating..."));
+    downloadTime->setText(tr("Estimating..."));
+    updateFairUseGuard(preliminarySize, preliminarySize);
+
+    /* Count of parallel downloads when saving */
+    int parallelDownloads = 1;
+    if(SaveRasterThread::supportsShardedWriting(wizard->model)) {
+        parallelDownloads = MainWindow::instance()->configuration()->group("saveRaster")->value<int>("maxWriterThreads");
+        if(parallelDownloads <= 0) parallelDownloads = QThread::idealThreadCount();
+    }
+
+    vector<string> layers = wizard->layers;
+    layers.insert(layers.end(), wizard->overlays.begin(), wizard->overlays.end());
+    estimator->setContents(wizard->zoomLevels, tileSets, layers, parallelDownloads);
+    estimating = true;
+    estimator->start(QThread::LowPriority);
+}
+
+void StatisticsPage::cleanupPage() {
+    estimating = false;
+    estimator->abort();
+    QWizardPage::cleanupPage();
+}
 
-    /* Donwload size over 1 GB, display warning */
-    } else if(_tileCountTotal < 1048576) {
-        fupWarning->setText("Download size is over 1 GB. Consider selecting "
+void StatisticsPage::estimateProgress(int done, int total) {
+    downloadSize->setText(tr("Sampling tiles... (%0/%1)").arg(done).arg(total));
+}
+
+void StatisticsPage::estimateFinished() {
+    /* Estimation was aborted */
+    if(!estimating) return;
+    estimating = false;
+
+    SizeEstimator::Estimate e = estimator->estimate();
+
+    packageSize->setText(formatSize(e.packageSize));
+    downloadSize->setText(formatSize(e.downloadSize));
+
+    if(e.timeAvailable)
+        downloadTime->setText(QString("%0 (%1 - %2)")
+            .arg(formatTime(e.downloadTime.value))
+            .arg(formatTime(e.downloadTime.low))
+            .arg(formatTime(e.downloadTime.high)));
+    else if(e.downloadSize.high == 0)
+        downloadTime->setText(tr("Everything is available locally"));
+    else
+        downloadTime->setText(tr("Unknown"));
+
+    updateFairUseGuard(e.downloadSize.value, e.downloadSize.high);
+}
+
+void StatisticsPage::updateFairUseGuard(double downloadSize, double downloadSizeHigh) {
+    /* Download size over 10 GB, don't allow download */
+    if(downloadSize >= 10*gigabyte) {
+        fupWarning->setText(tr("Download size is over 10 GB. Please select smaller "
+            "data amount or the download will not be allowed."));
+        canDownload = false;
+
+    /* Download size possibly over 1 GB, display warning */
+    } else if(downloadSizeHigh >= gigabyte) {
+        fupWarning->setText(tr("Download size may be over 1 GB. Consider selecting "
             "smaller data amount, because this download can lead to pernament "
-            "IP ban.");
+            "IP ban."));
         canDownload = true;
 
-    /* Download size over 10 GB, don't allow download */
+    /* Download size okay, don't display anything */
     } else {
-        fupWarning->setText("Download size is over 10 GB. Please select smaller "
-            "data amount or the download will not be allowed.");
-        canDownload = false;
+        fupWarning->setText("");
+        canDownload = true;
     }
 
     emit completeChanged();
-
-    /* Download size (10 kB for one tile) */
-    downloadSize->setText(QString("%0 MB").arg(_tileCountTotal/102.4, 0, 'f', 1));
 }
 
 }}}
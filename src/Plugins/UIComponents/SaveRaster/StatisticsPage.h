@@ -26,11 +26,14 @@ class QLabel;
 namespace Kompas { namespace Plugins { namespace UIComponents {
 
 class SaveRasterWizard;
+class SizeEstimator;
 
 /**
  * @brief Statistics wizard page
  *
- * Displays total tile count and estimated package size.
+ * Displays total tile count and estimated package size, download size and
+ * download time. The estimation is done asynchronously with SizeEstimator,
+ * until it is finished, 10 kB for one tile is assumed.
  */
 class StatisticsPage: public QWizardPage {
     Q_OBJECT
@@ -44,7 +47,7 @@ class StatisticsPage: public QWizardPage {
 
         /**
          * @brief Whether the page is complete
-         * @return True if estimated package size doesn't exceed 10 GB.
+         * @return True if estimated download size doesn't exceed 10 GB.
          */
         inline bool isComplete() const { return canDownload; }
 
@@ -55,17 +58,33 @@ class StatisticsPage: public QWizardPage {
          */
         void initializePage();
 
+        /**
+         * @brief Page cleanup
+         *
+         * Aborts running estimation.
+         */
+        void cleanupPage();
+
+    private slots:
+        void estimateProgress(int done, int total);
+        void estimateFinished();
+
     private:
         SaveRasterWizard* wizard;
+        SizeEstimator* estimator;
+
+        bool canDownload, estimating;
 
-        bool canDownload;
+        void updateFairUseGuard(double downloadSize, double downloadSizeHigh);
 
         QLabel *tileCountMinZoom,
             *zoomLevelCount,
             *tileCountOneLayer,
             *layerCount,
             *tileCountTotal,
+            *packageSize,
             *downloadSize,
+            *downloadTime,
             *fupWarning;
 };
 
@@ -0,0 +1,135 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "SaveRasterBenchmark.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtTest/QtTest>
+
+#include "PluginManager.h"
+#include "PluginManagerStore.h"
+#include "MainWindow.h"
+#include "Test/BenchmarkEnvironment.h"
+#include "Test/SyntheticRasterModel.h"
+#include "Test/TileServer.h"
+#include "../SaveRasterThread.h"
+
+QTEST_MAIN(Kompas::Plugins::UIComponents::Test::SaveRasterBenchmark)
+
+using namespace std;
+using namespace Kompas::Core;
+using namespace Kompas::QtGui;
+using namespace Kompas::QtGui::Test;
+
+namespace Kompas { namespace Plugins { namespace UIComponents { namespace Test {
+
+void SaveRasterBenchmark::initTestCase() {
+    directory = QDir(useTemporaryHome());
+    mainWindow = new MainWindow;
+}
+
+void SaveRasterBenchmark::cleanupTestCase() {
+    delete mainWindow;
+}
+
+void SaveRasterBenchmark::save_data() {
+    QTest::addColumn<QString>("model");
+    QTest::addColumn<bool>("download");
+    QTest::addColumn<int>("areaSize");
+    QTest::addColumn<int>("zoomCount");
+
+    /* All writeable models */
+    QtGui::PluginManager<AbstractRasterModel>* manager = mainWindow->pluginManagerStore()->rasterModels()->manager();
+    vector<string> plugins = manager->pluginList();
+    for(vector<string>::const_iterator it = plugins.begin(); it != plugins.end(); ++it) {
+        if(!(manager->loadState(*it) & (QtGui::AbstractPluginManager::LoadOk|QtGui::AbstractPluginManager::IsStatic)) && !(manager->load(*it) & QtGui::AbstractPluginManager::LoadOk))
+            continue;
+
+        AbstractRasterModel* instance = manager->instance(*it);
+        if(!instance) continue;
+        bool writeable = instance->features() & AbstractRasterModel::WriteableFormat;
+        delete instance;
+        if(!writeable) continue;
+
+        const int areaSizes[] = { 4, 16 };
+        const int zoomCounts[] = { 1, 3 };
+        for(int download = 0; download != 2; ++download) for(int a = 0; a != 2; ++a) for(int z = 0; z != 2; ++z) {
+            QByteArray name = QString("%0, %1, %2x%2 tiles, %3 zoom levels")
+                .arg(QString::fromStdString(*it)).arg(download ? "downloaded" : "local")
+                .arg(areaSizes[a]).arg(zoomCounts[z]).toUtf8();
+            QTest::newRow(name.constData()) << QString::fromStdString(*it) << bool(download) << areaSizes[a] << zoomCounts[z];
+        }
+    }
+}
+
+void SaveRasterBenchmark::save() {
+    QFETCH(QString, model);
+    QFETCH(bool, download);
+    QFETCH(int, areaSize);
+    QFETCH(int, zoomCount);
+
+    SyntheticRasterModel::Settings settings;
+    settings.minZoom = 8;
+    settings.maxZoom = 8+zoomCount-1;
+    settings.hitRatio = download ? 0.0 : 1.0;
+
+    string tile = SyntheticRasterModel::generateTile(settings.tileSize);
+    TileServer server(QByteArray(tile.data(), tile.size()));
+    QVERIFY(server.start());
+    settings.url = server.url().toStdString();
+
+    mainWindow->setRasterModel(new SyntheticRasterModel(settings));
+
+    vector<Zoom> zoomLevels;
+    for(Zoom z = settings.minZoom; z <= settings.maxZoom; ++z)
+        zoomLevels.push_back(z);
+    vector<string> layers(1, "synthetic");
+
+    /* Each run into new file, some formats don't overwrite existing ones */
+    static int run = 0;
+    QString filename = directory.absoluteFilePath(QString("package-%0-%1").arg(model).arg(++run));
+
+    SaveRasterThread thread;
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(thread.initializePackage(model.toStdString(), filename.toStdString(), settings.tileSize, zoomLevels, TileArea(100, 100, areaSize, areaSize), layers, vector<string>()));
+    qint64 initialization = timer.nsecsElapsed()/1000;
+
+    /* Downloads in sequential mode are done in main thread, so wait in event
+       loop */
+    QEventLoop loop;
+    connect(&thread, SIGNAL(completed()), &loop, SLOT(quit()));
+    connect(&thread, SIGNAL(error()), &loop, SLOT(quit()));
+    QSignalSpy errorSpy(&thread, SIGNAL(error()));
+
+    timer.start();
+    thread.start();
+    loop.exec();
+    thread.wait();
+    double seconds = timer.nsecsElapsed()/1.0e9;
+
+    QVERIFY2(errorSpy.isEmpty(), "writing failed");
+
+    SaveRasterThread::Statistics statistics = thread.statistics();
+    qDebug("%s: %8.1f tiles/s, %6.2f MB/s; initialize %lld ms, enumerate %llu ms, fetch %llu ms, write %llu ms, finalize %llu ms",
+           thread.isSharded() ? "sharded" : "sequential",
+           statistics.tileCount/seconds, statistics.size/seconds/(1024*1024),
+           initialization/1000,
+           statistics.enumerationTime/1000, statistics.fetchTime/1000,
+           statistics.writeTime/1000, statistics.finalizationTime/1000);
+    QTest::setBenchmarkResult(seconds*1000, QTest::WalltimeMilliseconds);
+}
+
+}}}}
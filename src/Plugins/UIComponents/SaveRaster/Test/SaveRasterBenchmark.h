@@ -0,0 +1,66 @@
+#ifndef Kompas_Plugins_UIComponents_Test_SaveRasterBenchmark_h
+#define Kompas_Plugins_UIComponents_Test_SaveRasterBenchmark_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::UIComponents::Test::SaveRasterBenchmark
+ */
+
+#include <QtCore/QDir>
+#include <QtCore/QObject>
+
+namespace Kompas {
+
+namespace QtGui {
+    class MainWindow;
+}
+
+namespace Plugins { namespace UIComponents { namespace Test {
+
+/**
+@brief Package export benchmark
+
+Runs SaveRasterThread end-to-end from QtGui::Test::SyntheticRasterModel to each
+available destination raster model plugin which has
+Core::AbstractRasterModel::WriteableFormat feature. Tiles are either all in
+the source package or all downloaded from QtGui::Test::TileServer. The export
+is repeated for various area sizes and zoom level ranges, for each run it
+reports tiles per second, written bytes per second and time spent in
+particular stages (see SaveRasterThread::Statistics::enumerationTime). Stage
+times are summed for all threads, so with sharded writing they can exceed
+total time.
+
+Uses temporary configuration directory, the packages are written into it too.
+Raster model plugins are loaded from the default plugin directory.
+*/
+class SaveRasterBenchmark: public QObject {
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+
+        void save_data();
+        void save();
+
+    private:
+        QtGui::MainWindow* mainWindow;
+        QDir directory;
+};
+
+}}}}
+
+#endif
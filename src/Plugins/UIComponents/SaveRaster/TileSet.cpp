@@ -0,0 +1,237 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "TileSet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "AbstractProjection.h"
+
+using namespace std;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+namespace {
+    /* Kilometers per degree of latitude */
+    const double kmPerDegree = 111.32;
+
+    bool spanLess(const TileSet::Span& a, const TileSet::Span& b) {
+        return a.row < b.row || (a.row == b.row && a.begin < b.begin);
+    }
+}
+
+TileSet TileSet::fromArea(const TileArea& area) {
+    TileSet set;
+    for(unsigned int row = area.y; row != area.y+area.h; ++row)
+        set.addSpan(row, area.x, area.x+area.w);
+    set.normalize();
+    return set;
+}
+
+TileSet TileSet::fromPolygon(const vector<Coords<double> >& polygon, Zoom zoom, const TileArea& bounds) {
+    TileSet set;
+    if(polygon.size() < 3 || bounds.w == 0 || bounds.h == 0) return set;
+
+    /* Polygon in tile coordinates of given zoom level */
+    double scale = pow2(zoom);
+    vector<Coords<double> > p;
+    double minY = polygon[0].y*scale, maxY = minY;
+    for(vector<Coords<double> >::const_iterator it = polygon.begin(); it != polygon.end(); ++it) {
+        p.push_back(Coords<double>(it->x*scale, it->y*scale));
+        minY = min(minY, p.back().y);
+        maxY = max(maxY, p.back().y);
+    }
+
+    /* Rows touched by the polygon */
+    double firstRow = max<double>(bounds.y, floor(minY));
+    double lastRow = min<double>(bounds.y+bounds.h, floor(maxY)+1);
+
+    for(double row = firstRow; row < lastRow; ++row) {
+        double top = row, bottom = row+1, center = row+0.5;
+        vector<pair<double, double> > ranges;
+        vector<double> crossings;
+
+        for(size_t i = 0; i != p.size(); ++i) {
+            const Coords<double>& a = p[i];
+            const Coords<double>& b = p[(i+1)%p.size()];
+
+            /* Part of the edge inside the row covers tiles it passes through */
+            if(max(a.y, b.y) >= top && min(a.y, b.y) <= bottom) {
+                double t0 = 0, t1 = 1;
+                if(a.y != b.y) {
+                    double ta = (top-a.y)/(b.y-a.y), tb = (bottom-a.y)/(b.y-a.y);
+                    t0 = max(0.0, min(ta, tb));
+                    t1 = min(1.0, max(ta, tb));
+                }
+                if(t0 <= t1) {
+                    double x0 = a.x+(b.x-a.x)*t0, x1 = a.x+(b.x-a.x)*t1;
+                    ranges.push_back(make_pair(min(x0, x1), max(x0, x1)));
+                }
+            }
+
+            /* Crossings of row center line, for tiles fully inside */
+            if((a.y <= center) != (b.y <= center))
+                crossings.push_back(a.x+(center-a.y)*(b.x-a.x)/(b.y-a.y));
+        }
+
+        /* Even-odd rule */
+        sort(crossings.begin(), crossings.end());
+        for(size_t i = 0; i+1 < crossings.size(); i += 2)
+            ranges.push_back(make_pair(crossings[i], crossings[i+1]));
+
+        /* Convert ranges to tile columns, clipped to bounds */
+        for(vector<pair<double, double> >::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+            double begin = max<double>(bounds.x, floor(it->first));
+            double end = min<double>(bounds.x+bounds.w, floor(it->second)+1);
+            if(begin < end) set.addSpan(row, begin, end);
+        }
+    }
+
+    set.normalize();
+    return set;
+}
+
+TileSet TileSet::fromCorridor(const vector<LatLonCoords>& polyline, double width, const AbstractProjection* projection, Zoom zoom, const TileArea& bounds) {
+    TileSet set;
+    if(polyline.empty() || !projection) return set;
+
+    double radius = width/2;
+    vector<Coords<double> > polygon(4);
+
+    for(size_t i = 0; i != polyline.size(); ++i) {
+        const LatLonCoords& a = polyline[i];
+
+        /* Square around the vertex */
+        double dLat = radius/kmPerDegree;
+        double dLon = radius/(kmPerDegree*max(0.01, cos(a.latitude()*M_PI/180)));
+        polygon[0] = projection->fromLatLon(LatLonCoords(a.latitude()+dLat, a.longitude()-dLon));
+        polygon[1] = projection->fromLatLon(LatLonCoords(a.latitude()+dLat, a.longitude()+dLon));
+        polygon[2] = projection->fromLatLon(LatLonCoords(a.latitude()-dLat, a.longitude()+dLon));
+        polygon[3] = projection->fromLatLon(LatLonCoords(a.latitude()-dLat, a.longitude()-dLon));
+        append(set, fromPolygon(polygon, zoom, bounds));
+
+        if(i+1 == polyline.size()) break;
+        const LatLonCoords& b = polyline[i+1];
+
+        /* Segment direction in local planar approximation (kilometers) */
+        double lonScale = kmPerDegree*max(0.01, cos((a.latitude()+b.latitude())*M_PI/360));
+        double dx = (b.longitude()-a.longitude())*lonScale;
+        double dy = (b.latitude()-a.latitude())*kmPerDegree;
+        double length = sqrt(dx*dx+dy*dy);
+        if(length == 0) continue;
+
+        /* Rectangle around the segment */
+        double nLat = dx/length*radius/kmPerDegree;
+        double nLon = -dy/length*radius/lonScale;
+        polygon[0] = projection->fromLatLon(LatLonCoords(a.latitude()+nLat, a.longitude()+nLon));
+        polygon[1] = projection->fromLatLon(LatLonCoords(b.latitude()+nLat, b.longitude()+nLon));
+        polygon[2] = projection->fromLatLon(LatLonCoords(b.latitude()-nLat, b.longitude()-nLon));
+        polygon[3] = projection->fromLatLon(LatLonCoords(a.latitude()-nLat, a.longitude()-nLon));
+        append(set, fromPolygon(polygon, zoom, bounds));
+    }
+
+    set.normalize();
+    return set;
+}
+
+TileSet TileSet::fromTiles(const vector<TileCoords>& tiles) {
+    TileSet set;
+    for(vector<TileCoords>::const_iterator it = tiles.begin(); it != tiles.end(); ++it)
+        set.addSpan(it->y, it->x, it->x+1);
+    set.normalize();
+    return set;
+}
+
+TileCoords TileSet::at(quint64 index) const {
+    size_t i = upper_bound(offsets.begin(), offsets.end(), index)-offsets.begin()-1;
+    return TileCoords(_spans[i].begin+(index-offsets[i]), _spans[i].row);
+}
+
+TileArea TileSet::boundingArea() const {
+    TileArea area;
+    if(_spans.empty()) return area;
+
+    unsigned int left = _spans[0].begin, right = _spans[0].end;
+    for(vector<Span>::const_iterator it = _spans.begin(); it != _spans.end(); ++it) {
+        left = min(left, it->begin);
+        right = max(right, it->end);
+    }
+
+    area.x = left;
+    area.y = _spans.front().row;
+    area.w = right-left;
+    area.h = _spans.back().row-_spans.front().row+1;
+    return area;
+}
+
+TileSet& TileSet::operator|=(const TileSet& other) {
+    append(*this, other);
+    normalize();
+    return *this;
+}
+
+TileSet& TileSet::operator&=(const TileSet& other) {
+    /* Both span lists are sorted and don't overlap, walk them together */
+    vector<Span> intersection;
+    vector<Span>::const_iterator a = _spans.begin(), b = other._spans.begin();
+    while(a != _spans.end() && b != other._spans.end()) {
+        if(a->row == b->row) {
+            unsigned int begin = max(a->begin, b->begin);
+            unsigned int end = min(a->end, b->end);
+            if(begin < end) intersection.push_back(Span(a->row, begin, end));
+        }
+
+        /* Advance the span which ends first */
+        if(spanLess(Span(a->row, a->end), Span(b->row, b->end))) ++a;
+        else ++b;
+    }
+
+    _spans.swap(intersection);
+    normalize();
+    return *this;
+}
+
+void TileSet::append(TileSet& set, const TileSet& other) {
+    set._spans.insert(set._spans.end(), other._spans.begin(), other._spans.end());
+}
+
+void TileSet::addSpan(unsigned int row, unsigned int begin, unsigned int end) {
+    _spans.push_back(Span(row, begin, end));
+}
+
+void TileSet::normalize() {
+    sort(_spans.begin(), _spans.end(), spanLess);
+
+    /* Merge overlapping and adjacent spans in the same row */
+    vector<Span> merged;
+    for(vector<Span>::const_iterator it = _spans.begin(); it != _spans.end(); ++it) {
+        if(!merged.empty() && merged.back().row == it->row && it->begin <= merged.back().end)
+            merged.back().end = max(merged.back().end, it->end);
+        else merged.push_back(*it);
+    }
+    _spans.swap(merged);
+
+    /* Position of first tile of each span */
+    offsets.resize(_spans.size());
+    quint64 offset = 0;
+    for(size_t i = 0; i != _spans.size(); ++i) {
+        offsets[i] = offset;
+        offset += _spans[i].end-_spans[i].begin;
+    }
+}
+
+}}}
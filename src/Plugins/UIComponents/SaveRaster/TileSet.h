@@ -0,0 +1,131 @@
+#ifndef Kompas_Plugins_UIComponents_TileSet_h
+#define Kompas_Plugins_UIComponents_TileSet_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::UIComponents::TileSet
+ */
+
+#include <vector>
+#include <QtCore/QtGlobal>
+
+#include "AbstractRasterModel.h"
+#include "LatLonCoords.h"
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+/**
+@brief Set of tiles in one zoom level
+
+Stores tiles as horizontal spans, sorted by row and then by column, so the
+tiles can be enumerated row by row like in plain tile area. Besides
+rectangular area the set can be rasterized from polygon or from buffered
+polyline (corridor around a route) or created from list of particular tiles
+(e.g. tiles present in cache). All tiles touched by the polygon are
+included in the set.
+*/
+class TileSet {
+    public:
+        /** @brief Horizontal span of tiles */
+        struct Span {
+            /** @brief Constructor */
+            inline Span(unsigned int _row = 0, unsigned int _begin = 0, unsigned int _end = 0): row(_row), begin(_begin), end(_end) {}
+
+            unsigned int row,           /**< @brief Row */
+                begin,                  /**< @brief First column */
+                end;                    /**< @brief Column after the last one */
+        };
+
+        /**
+         * @brief Tile set from rectangular area
+         * @param area      Tile area
+         */
+        static TileSet fromArea(const Core::TileArea& area);
+
+        /**
+         * @brief Tile set from polygon
+         * @param polygon   Polygon vertices in raster coordinates (see
+         *      Core::AbstractProjection::fromLatLon()), implicitly closed
+         * @param zoom      Zoom level
+         * @param bounds    Tile area at given zoom level to which the set is
+         *      clipped
+         */
+        static TileSet fromPolygon(const std::vector<Core::Coords<double> >& polygon, Core::Zoom zoom, const Core::TileArea& bounds);
+
+        /**
+         * @brief Tile set from corridor around polyline
+         * @param polyline  Polyline vertices in latitude/longitude
+         * @param width     Corridor width in kilometers
+         * @param projection Projection for converting to raster coordinates
+         * @param zoom      Zoom level
+         * @param bounds    Tile area at given zoom level to which the set is
+         *      clipped
+         *
+         * The corridor is composed of rectangle around each segment and
+         * square around each vertex.
+         */
+        static TileSet fromCorridor(const std::vector<Core::LatLonCoords>& polyline, double width, const Core::AbstractProjection* projection, Core::Zoom zoom, const Core::TileArea& bounds);
+
+        /**
+         * @brief Tile set from list of tiles
+         * @param tiles     Tiles in arbitrary order, can contain duplicates
+         */
+        static TileSet fromTiles(const std::vector<Core::TileCoords>& tiles);
+
+        /** @brief Tile count */
+        inline quint64 count() const {
+            return offsets.empty() ? 0 : offsets.back()+(_spans.back().end-_spans.back().begin);
+        }
+
+        /** @brief Spans */
+        inline const std::vector<Span>& spans() const { return _spans; }
+
+        /**
+         * @brief Tile at given position
+         * @param index     Position in the set, must be smaller than count()
+         */
+        Core::TileCoords at(quint64 index) const;
+
+        /** @brief Bounding area of all tiles */
+        Core::TileArea boundingArea() const;
+
+        /**
+         * @brief Union with another tile set
+         *
+         * Both sets must be in the same zoom level.
+         */
+        TileSet& operator|=(const TileSet& other);
+
+        /**
+         * @brief Intersection with another tile set
+         *
+         * Both sets must be in the same zoom level.
+         */
+        TileSet& operator&=(const TileSet& other);
+
+    private:
+        std::vector<Span> _spans;
+        std::vector<quint64> offsets;
+
+        static void append(TileSet& set, const TileSet& other);
+
+        void addSpan(unsigned int row, unsigned int begin, unsigned int end);
+        void normalize();
+};
+
+}}}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "TileTranscoder.h"
+
+#include <QtCore/QBuffer>
+#include <QtGui/QImage>
+#include <QtGui/QImageWriter>
+
+using namespace std;
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+string TileTranscoder::transcode(const string& data, const Settings& settings) {
+    if(settings.mode == None || data.empty()) return data;
+
+    QImage image;
+    if(!image.loadFromData(reinterpret_cast<const uchar*>(data.data()), data.size()))
+        return data;
+
+    QByteArray format;
+    int quality = -1;
+    switch(settings.mode) {
+        case PngPalette:
+            image = image.convertToFormat(QImage::Format_Indexed8, Qt::AutoColor|Qt::ThresholdDither|Qt::AvoidDither);
+            format = "png";
+            quality = 0;
+            break;
+        case Jpeg:
+            /* JPEG can't store transparency */
+            if(image.hasAlphaChannel()) return data;
+            format = "jpg";
+            quality = settings.quality;
+            break;
+        case PngOptimize:
+            /* Drop alpha channel, if all pixels are opaque */
+            if(image.hasAlphaChannel()) {
+                QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+                bool opaque = true;
+                for(int y = 0; y != argb.height() && opaque; ++y) {
+                    const QRgb* line = reinterpret_cast<const QRgb*>(argb.constScanLine(y));
+                    for(int x = 0; x != argb.width(); ++x) if(qAlpha(line[x]) != 255) {
+                        opaque = false;
+                        break;
+                    }
+                }
+                if(opaque) image = argb.convertToFormat(QImage::Format_RGB32);
+            }
+
+            /* Zero quality means maximal compression for PNG */
+            format = "png";
+            quality = 0;
+            break;
+        case None:
+            return data;
+    }
+
+    QByteArray output;
+    QBuffer buffer(&output);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, format);
+    writer.setQuality(quality);
+    if(!writer.write(image)) return data;
+
+    /* Use the transcoded data only if they are smaller */
+    if(static_cast<size_t>(output.size()) >= data.size()) return data;
+    return string(output.constData(), output.size());
+}
+
+}}}
@@ -0,0 +1,85 @@
+#ifndef Kompas_Plugins_UIComponents_TileTranscoder_h
+#define Kompas_Plugins_UIComponents_TileTranscoder_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Plugins::UIComponents::TileTranscoder
+ */
+
+#include <string>
+
+namespace Kompas { namespace Plugins { namespace UIComponents {
+
+/**
+@brief Tile recompression
+
+Re-encodes tile data to make them smaller. The recompressed data are used only
+if they are smaller than the original, otherwise the original data are kept.
+Tiles which cannot be decoded are kept untouched too. The functions are
+reentrant, so they can be called from multiple threads at once.
+*/
+class TileTranscoder {
+    public:
+        /** @brief Transcoding mode */
+        enum Mode {
+            None,           /**< @brief Keep the data as they are */
+
+            /**
+             * @brief PNG palette quantization
+             *
+             * Reduces the image to 256 colors with palette.
+             */
+            PngPalette,
+
+            /**
+             * @brief JPEG re-encoding
+             *
+             * Re-encodes the image as JPEG with given quality. Images with
+             * alpha channel are kept untouched.
+             */
+            Jpeg,
+
+            /**
+             * @brief Lossless PNG re-optimization
+             *
+             * Re-encodes the image as PNG with maximal compression, drops
+             * alpha channel, if the image is fully opaque.
+             */
+            PngOptimize
+        };
+
+        /** @brief Transcoding settings */
+        struct Settings {
+            /** @brief Constructor */
+            inline Settings(Mode _mode = None, int _quality = 85): mode(_mode), quality(_quality) {}
+
+            Mode mode;      /**< @brief Transcoding mode */
+            int quality;    /**< @brief Quality for Mode::Jpeg, 0-100 */
+        };
+
+        /**
+         * @brief Transcode tile data
+         * @param data      Tile data
+         * @param settings  Transcoding settings
+         * @return Transcoded data or original data, if they are not smaller
+         *      or cannot be transcoded.
+         */
+        static std::string transcode(const std::string& data, const Settings& settings);
+};
+
+}}}
+
+#endif
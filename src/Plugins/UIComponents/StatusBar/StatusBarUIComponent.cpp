@@ -45,9 +45,7 @@ void StatusBarUIComponent::mapViewChanged() {
 }
 
 void StatusBarUIComponent::rasterModelChanged(const AbstractRasterModel* previous) {
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-    bool isUsable = rasterModel() ? rasterModel()->isUsable() : false;
-    rasterModel.unlock();
+    bool isUsable = MainWindow::instance()->rasterModelSnapshot()->usable;
 
     if(MainWindow::instance()->mapView() && isUsable)
         _coordinateStatus->setHidden(false);
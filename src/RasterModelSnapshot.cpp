@@ -0,0 +1,38 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "RasterModelSnapshot.h"
+
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui {
+
+RasterModelSnapshot::RasterModelSnapshot(const AbstractRasterModel* model): features(0), usable(false), online(false), packageCount(0), projection(0) {
+    if(!model) return;
+
+    plugin = model->plugin();
+    features = model->features();
+    usable = model->isUsable();
+    online = model->online();
+    packageCount = model->packageCount();
+    tileSize = model->tileSize();
+    zoomLevels = model->zoomLevels();
+    area = model->area();
+    layers = model->layers();
+    overlays = model->overlays();
+    projection = model->projection();
+}
+
+}}
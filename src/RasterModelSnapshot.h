@@ -0,0 +1,79 @@
+#ifndef Kompas_QtGui_RasterModelSnapshot_h
+#define Kompas_QtGui_RasterModelSnapshot_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::RasterModelSnapshot
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AbstractRasterModel.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Raster model snapshot
+
+Immutable copy of raster model metadata. Snapshots are created by MainWindow
+on every raster model change and published through
+MainWindow::rasterModelSnapshot(), so readers get consistent metadata without
+locking the raster model and thus without waiting for tile loading or package
+operations. Already obtained snapshot never changes, a new one is published
+instead.
+
+@attention Projection is owned by the raster model, so it can be used only
+    as long as the model exists. The previous model is deleted right after
+    MainWindow::rasterModelChanged() is emitted, so use the projection only
+    from the main thread and don't keep the snapshot across raster model
+    changes.
+*/
+class RasterModelSnapshot {
+    public:
+        /**
+         * @brief Constructor
+         * @param model     Raster model or 0
+         *
+         * The model must be locked for reading. If the model is 0, creates
+         * invalid snapshot.
+         */
+        RasterModelSnapshot(const Core::AbstractRasterModel* model = 0);
+
+        /** @brief Whether the snapshot is of existing raster model */
+        inline bool isValid() const { return !plugin.empty(); }
+
+        std::string plugin;             /**< @brief Raster model plugin */
+        int features;                   /**< @brief Raster model features */
+        bool usable;                    /**< @brief Whether the model is usable */
+        bool online;                    /**< @brief Whether online maps are enabled */
+        int packageCount;               /**< @brief Count of opened packages */
+
+        Core::TileSize tileSize;        /**< @brief Tile size */
+        std::set<Core::Zoom> zoomLevels; /**< @brief Zoom levels */
+        Core::TileArea area;            /**< @brief Area at minimal zoom level */
+        std::vector<std::string>
+            layers,                     /**< @brief Layers */
+            overlays;                   /**< @brief Overlays */
+
+        /** @brief Projection or 0, see class documentation for lifetime */
+        const Core::AbstractProjection* projection;
+};
+
+}}
+
+#endif
@@ -26,16 +26,10 @@ void RasterZoomModel::reload() {
     beginResetModel();
     z.clear();
 
-    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
-
-    if(rasterModel()) {
-        /* All available zoom levels */
-        set<Zoom> _z = rasterModel()->zoomLevels();
-        for(set<Zoom>::const_iterator it = _z.begin(); it != _z.end(); ++it)
-            z.append(*it);
-    }
-
-    rasterModel.unlock();
+    /* All available zoom levels */
+    QSharedPointer<const RasterModelSnapshot> rasterModel = MainWindow::instance()->rasterModelSnapshot();
+    for(set<Zoom>::const_iterator it = rasterModel->zoomLevels.begin(); it != rasterModel->zoomLevels.end(); ++it)
+        z.append(*it);
 
     endResetModel();
 }
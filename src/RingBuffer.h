@@ -0,0 +1,149 @@
+#ifndef Kompas_QtGui_RingBuffer_h
+#define Kompas_QtGui_RingBuffer_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::RingBuffer
+ */
+
+#include <QtCore/QAtomicInt>
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Bounded lock-free queue
+
+Fixed-size ring buffer, which can be filled from any count of threads and
+emptied from one thread without any locks. Each slot has its own sequence
+number, which tells whether the slot is free for given producer or ready for
+the consumer, producers reserve slots by atomically moving the write position
+forward (D. Vyukov's bounded queue). When the buffer is full, push() fails
+and it's up to the producer to retry later.
+
+@attention The buffer is meant for passing data between threads, the values
+    are copied in and out, so the type should be cheap to copy (e.g.
+    implicitly shared Qt types).
+*/
+template<class T> class RingBuffer {
+    public:
+        /**
+         * @brief Constructor
+         * @param capacity  Capacity, rounded up to nearest power of two
+         */
+        RingBuffer(int capacity = 256);
+
+        /** @brief Destructor */
+        inline ~RingBuffer() { delete[] buffer; }
+
+        /** @brief Capacity */
+        inline int capacity() const { return mask+1; }
+
+        /**
+         * @brief Add value to the buffer
+         * @return False if the buffer is full, true otherwise
+         *
+         * Can be called from any thread.
+         */
+        bool push(const T& value);
+
+        /**
+         * @brief Take value from the buffer
+         * @return False if the buffer is empty, true otherwise
+         *
+         * Can be called only from one thread at a time.
+         */
+        bool pop(T& value);
+
+    private:
+        struct Slot {
+            QAtomicInt sequence;
+            T value;
+        };
+
+        Slot* buffer;
+        int mask;
+
+        /* Keep producer and consumer positions in different cache lines */
+        char padding1[64];
+        QAtomicInt writePosition;
+        char padding2[64];
+        QAtomicInt readPosition;
+        char padding3[64];
+
+        /* Sequence distance, correct even after the counters overflow */
+        inline static int distance(int a, int b) {
+            return static_cast<int>(static_cast<unsigned int>(a)-static_cast<unsigned int>(b));
+        }
+
+        /* Unimplemented, the buffer is not copyable */
+        RingBuffer(const RingBuffer<T>&);
+        RingBuffer<T>& operator=(const RingBuffer<T>&);
+};
+
+template<class T> RingBuffer<T>::RingBuffer(int capacity) {
+    int size = 1;
+    while(size < capacity) size *= 2;
+    mask = size-1;
+
+    buffer = new Slot[size];
+    for(int i = 0; i != size; ++i)
+        buffer[i].sequence = i;
+}
+
+template<class T> bool RingBuffer<T>::push(const T& value) {
+    Slot* slot;
+    int position = writePosition.fetchAndAddRelaxed(0);
+    forever {
+        slot = &buffer[position & mask];
+
+        /* Acquire load of slot sequence (Qt 4 has no plain atomic load) */
+        int d = distance(slot->sequence.fetchAndAddAcquire(0), position);
+
+        /* The slot is free, try to reserve it */
+        if(d == 0) {
+            if(writePosition.testAndSetRelaxed(position, position+1)) break;
+
+        /* The slot wasn't read yet, the buffer is full */
+        } else if(d < 0) return false;
+
+        /* Another producer was faster, try again */
+        position = writePosition.fetchAndAddRelaxed(0);
+    }
+
+    slot->value = value;
+    slot->sequence.fetchAndStoreRelease(position+1);
+    return true;
+}
+
+template<class T> bool RingBuffer<T>::pop(T& value) {
+    int position = readPosition.fetchAndAddRelaxed(0);
+    Slot* slot = &buffer[position & mask];
+
+    /* The slot wasn't written yet, the buffer is empty */
+    if(distance(slot->sequence.fetchAndAddAcquire(0), position+1) < 0) return false;
+
+    readPosition.fetchAndStoreRelaxed(position+1);
+    value = slot->value;
+    slot->value = T();
+
+    /* Free the slot for next round */
+    slot->sequence.fetchAndStoreRelease(position+mask+1);
+    return true;
+}
+
+}}
+
+#endif
@@ -15,6 +15,10 @@
 
 #include "SessionManager.h"
 
+#include <QtCore/QTimer>
+
+#include "CacheScrubber.h"
+#include "CacheWarmer.h"
 #include "MainWindow.h"
 #include "PluginManager.h"
 #include "PluginManagerStore.h"
@@ -108,6 +112,15 @@ void SessionManager::load(unsigned int id) {
     vector<string> overlays = g->values<string>("overlay");
     for(vector<string>::const_iterator it = overlays.begin(); it != overlays.end(); ++it)
         mapView->addOverlay(QString::fromStdString(*it));
+
+    /* Warm the cache after the map view is laid out */
+    if(MainWindow::instance()->configuration()->group("cache")->value<bool>("warmOnLoad"))
+        QTimer::singleShot(0, MainWindow::instance()->cacheWarmer(), SLOT(warm()));
+
+    /* Check cache integrity later, when the startup load settles down */
+    ConfigurationGroup* cacheGroup = MainWindow::instance()->configuration()->group("cache");
+    if(cacheGroup->value<bool>("scrubOnLoad"))
+        QTimer::singleShot(qMax(0, cacheGroup->value<int>("scrubDelay"))*1000, MainWindow::instance()->cacheScrubber(), SLOT(scrub()));
 }
 
 void SessionManager::save(unsigned int id) {
@@ -46,6 +46,8 @@ be then loaded with load(). If there was no last active session, last active
 session id is set to default session. On exit current state is saved into active
 session or into default session, if no other session is active. The default
 session cannot be renamed or deleted.</p>
+<p>After loading a session the cache is warmed for restored map position, if
+enabled in configuration, see CacheWarmer.</p>
 
 @configuration
 
@@ -0,0 +1,61 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "AllocationCounter.h"
+
+#include <cstddef>
+#include <QtCore/QAtomicInt>
+
+#ifdef __GLIBC__
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* pointer, std::size_t size);
+}
+
+namespace {
+    QAtomicInt allocations;
+}
+
+/* Interpose allocation functions for whole process. The object file is pulled
+   from the static library only if allocationCount() is used. */
+extern "C" {
+    void* malloc(std::size_t size) {
+        allocations.ref();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) {
+        allocations.ref();
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, std::size_t size) {
+        allocations.ref();
+        return __libc_realloc(pointer, size);
+    }
+}
+#endif
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+int allocationCount() {
+    #ifdef __GLIBC__
+    return allocations;
+    #else
+    return 0;
+    #endif
+}
+
+}}}
@@ -0,0 +1,37 @@
+#ifndef Kompas_QtGui_Test_AllocationCounter_h
+#define Kompas_QtGui_Test_AllocationCounter_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Function Kompas::QtGui::Test::allocationCount()
+ */
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+/**
+@brief Count of heap allocations
+
+Counts calls to @c malloc(), @c calloc() and @c realloc() in whole process,
+thus including allocations done by operator @c new and by Qt. Counting is
+done by interposing the allocation functions and is available only with GNU
+C library, elsewhere the function always returns 0. Only the difference
+between two calls is meaningful.
+*/
+int allocationCount();
+
+}}}
+
+#endif
@@ -0,0 +1,29 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "BenchmarkEnvironment.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+QString useTemporaryHome() {
+    QString home = QDir::temp().absoluteFilePath("kompas-benchmark");
+    QDir().mkpath(home);
+    qputenv("HOME", QFile::encodeName(home));
+    return home;
+}
+
+}}}
@@ -0,0 +1,39 @@
+#ifndef Kompas_QtGui_Test_BenchmarkEnvironment_h
+#define Kompas_QtGui_Test_BenchmarkEnvironment_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Function Kompas::QtGui::Test::useTemporaryHome()
+ */
+
+#include <QtCore/QString>
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+/**
+@brief Use temporary home directory
+
+Points @c HOME to <tt>kompas-benchmark</tt> directory in system temporary
+directory (creating it, if it doesn't exist), so configuration and cache of
+MainWindow created afterwards don't touch the ones of the user. Call it
+before creating MainWindow.
+@return Path to the directory
+*/
+QString useTemporaryHome();
+
+}}}
+
+#endif
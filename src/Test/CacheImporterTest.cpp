@@ -0,0 +1,59 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "CacheImporterTest.h"
+
+#include <QtTest/QtTest>
+
+#include "CacheImporter.h"
+#include "SyntheticRasterModel.h"
+
+QTEST_APPLESS_MAIN(Kompas::QtGui::Test::CacheImporterTest)
+
+using namespace std;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+void CacheImporterTest::sparse() {
+    SyntheticRasterModel::Settings settings;
+    settings.tileSize = TileSize(1, 1);
+    settings.minZoom = 2;
+    settings.maxZoom = 5;
+    settings.hitRatio = 0.3;
+    SyntheticRasterModel model(settings);
+
+    /* Every tile in the package has to be scanned, also tiles under tiles
+       missing in previous zoom level */
+    int orphans = 0;
+    set<Zoom> zoomLevels = model.zoomLevels();
+    for(set<Zoom>::const_iterator z = zoomLevels.begin(); z != zoomLevels.end(); ++z) {
+        TileArea a = CacheImporter::scanArea(&model, *z);
+
+        for(unsigned int y = 0; y != (1u << *z); ++y) for(unsigned int x = 0; x != (1u << *z); ++x) {
+            if(!model.isInPackage(*z, TileCoords(x, y))) continue;
+
+            QVERIFY(x >= a.x && x < a.x+a.w);
+            QVERIFY(y >= a.y && y < a.y+a.h);
+
+            if(*z != settings.minZoom && !model.isInPackage(*z-1, TileCoords(x/2, y/2)))
+                ++orphans;
+        }
+    }
+
+    /* Make sure the package is really sparse */
+    QVERIFY(orphans != 0);
+}
+
+}}}
@@ -0,0 +1,36 @@
+#ifndef Kompas_QtGui_Test_CacheImporterTest_h
+#define Kompas_QtGui_Test_CacheImporterTest_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::Test::CacheImporterTest
+ */
+
+#include <QtCore/QObject>
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+/** @brief Package scanning in CacheImporter */
+class CacheImporterTest: public QObject {
+    Q_OBJECT
+
+    private slots:
+        void sparse();
+};
+
+}}}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "MemoryCacheTest.h"
+
+#include <QtTest/QtTest>
+
+#include "MemoryCache.h"
+
+QTEST_APPLESS_MAIN(Kompas::QtGui::Test::MemoryCacheTest)
+
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+namespace {
+    inline TileKey key(unsigned int x) { return TileKey("base", 0, TileCoords(x, 0)); }
+}
+
+void MemoryCacheTest::disabled() {
+    MemoryCache cache(0);
+    cache.set(key(0), QByteArray(10, 'a'), 0);
+
+    QVERIFY(!cache.contains(key(0)));
+    QCOMPARE(cache.statistics().count, 0);
+}
+
+void MemoryCacheTest::tooLarge() {
+    /* Probation segment is 20 % of the size */
+    MemoryCache cache(1000);
+    cache.set(key(0), QByteArray(201, 'a'), 0);
+    cache.set(key(1), QByteArray(200, 'a'), 0);
+
+    QVERIFY(!cache.contains(key(0)));
+    QVERIFY(cache.contains(key(1)));
+}
+
+void MemoryCacheTest::largeSize() {
+    /* Sizes over 2 GB / 100 must not overflow when computing segment sizes */
+    MemoryCache cache(1024*1024*1024);
+    cache.set(key(0), QByteArray(4096, 'a'), 0);
+
+    QVERIFY(cache.contains(key(0)));
+    QCOMPARE(cache.statistics().size, 4096);
+}
+
+void MemoryCacheTest::replace() {
+    MemoryCache cache(1000);
+    cache.set(key(0), QByteArray(100, 'a'), 0);
+    cache.set(key(0), QByteArray(50, 'b'), 0);
+
+    QCOMPARE(cache.statistics().count, 1);
+    QCOMPARE(cache.statistics().size, 50);
+    QCOMPARE(cache.get(key(0)), QByteArray(50, 'b'));
+}
+
+void MemoryCacheTest::evictLeastRecentlyUsed() {
+    MemoryCache cache(1000);
+    for(unsigned int i = 0; i != 11; ++i)
+        cache.set(key(i), QByteArray(100, 'a'), 0);
+
+    QVERIFY(!cache.contains(key(0)));
+    QVERIFY(cache.contains(key(1)));
+    QVERIFY(cache.contains(key(10)));
+    QCOMPARE(cache.statistics().size, 1000);
+}
+
+void MemoryCacheTest::promoted() {
+    /* Tile hit again survives a scan of tiles used only once */
+    MemoryCache cache(1000);
+    cache.set(key(0), QByteArray(100, 'a'), 0);
+    QVERIFY(!cache.get(key(0)).isEmpty());
+
+    for(unsigned int i = 1; i != 21; ++i)
+        cache.set(key(i), QByteArray(100, 'a'), 0);
+
+    QVERIFY(cache.contains(key(0)));
+    QVERIFY(!cache.contains(key(1)));
+    QVERIFY(cache.contains(key(20)));
+
+    MemoryCache::Statistics statistics = cache.statistics();
+    QCOMPARE(statistics.memoryHits, quint64(1));
+    QCOMPARE(statistics.memoryMisses, quint64(0));
+}
+
+void MemoryCacheTest::prefetched() {
+    /* Prefetched tile is evicted before tiles requested earlier */
+    MemoryCache cache(1000);
+    for(unsigned int i = 0; i != 9; ++i)
+        cache.set(key(i), QByteArray(100, 'a'), 0);
+    cache.set(key(9), QByteArray(100, 'a'), 0, MemoryCache::Prefetch);
+    cache.set(key(10), QByteArray(100, 'a'), 0);
+
+    QVERIFY(!cache.contains(key(9)));
+    QVERIFY(cache.contains(key(0)));
+    QVERIFY(cache.contains(key(10)));
+}
+
+void MemoryCacheTest::shrink() {
+    MemoryCache cache(1000);
+    for(unsigned int i = 0; i != 10; ++i)
+        cache.set(key(i), QByteArray(100, 'a'), 0);
+
+    cache.setMaxSize(500);
+
+    QCOMPARE(cache.statistics().count, 5);
+    QVERIFY(!cache.contains(key(4)));
+    QVERIFY(cache.contains(key(5)));
+}
+
+void MemoryCacheTest::clear() {
+    MemoryCache cache(1000);
+    cache.set(key(0), QByteArray(100, 'a'), 0);
+    cache.clear(0);
+
+    QVERIFY(!cache.contains(key(0)));
+    QCOMPARE(cache.statistics().size, 0);
+    QVERIFY(cache.get(key(0)).isEmpty());
+    QCOMPARE(cache.statistics().memoryMisses, quint64(1));
+}
+
+void MemoryCacheTest::generation() {
+    /* Tiles read with previous raster model are refused after clear */
+    MemoryCache cache(1000);
+    cache.clear(1);
+    cache.set(key(0), QByteArray(100, 'a'), 0);
+    cache.set(key(1), QByteArray(100, 'a'), 1);
+
+    QVERIFY(!cache.contains(key(0)));
+    QVERIFY(cache.contains(key(1)));
+}
+
+}}}
@@ -0,0 +1,115 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "SyntheticRasterModel.h"
+
+#include <sstream>
+#include <QtCore/QBuffer>
+#include <QtCore/QThread>
+#include <QtGui/QImage>
+
+using namespace std;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+namespace {
+    /* QThread::usleep() is protected in Qt 4 */
+    class Sleeper: public QThread {
+        public:
+            using QThread::usleep;
+    };
+}
+
+string SyntheticRasterModel::generateTile(const TileSize& tileSize) {
+    QImage image(tileSize.x, tileSize.y, QImage::Format_RGB32);
+
+    /* Deterministic noise, compresses roughly like aerial imagery */
+    quint32 seed = 1;
+    for(int y = 0; y != image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for(int x = 0; x != image.width(); ++x) {
+            seed = seed*1103515245 + 12345;
+            line[x] = qRgb(x ^ y, (seed >> 16) & 0x3f, (x+y) & 0xff);
+        }
+    }
+
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+
+    return string(png.constData(), png.size());
+}
+
+SyntheticRasterModel::SyntheticRasterModel(const Settings& settings): AbstractRasterModel(0, "SyntheticRasterModel"), settings(settings), _packageReads(0) {
+    data = generateTile(settings.tileSize);
+
+    if(!settings.url.empty()) setOnline(true);
+}
+
+bool SyntheticRasterModel::isInPackage(Zoom z, const TileCoords& coords) const {
+    quint32 hash = coords.x*73856093u ^ coords.y*19349663u ^ z*83492791u;
+    return (hash % 1000) < settings.hitRatio*1000;
+}
+
+int SyntheticRasterModel::features() const {
+    return SingleLayer|
+        (settings.minZoom == settings.maxZoom ? SingleZoom : 0)|
+        (settings.url.empty() ? 0 : LoadableFromUrl);
+}
+
+set<Zoom> SyntheticRasterModel::zoomLevels() const {
+    set<Zoom> z;
+    for(Zoom i = settings.minZoom; i <= settings.maxZoom; ++i)
+        z.insert(i);
+    return z;
+}
+
+TileArea SyntheticRasterModel::area() const {
+    return TileArea(0, 0, 1 << settings.minZoom, 1 << settings.minZoom);
+}
+
+vector<string> SyntheticRasterModel::layers() const {
+    return vector<string>(1, "synthetic");
+}
+
+vector<string> SyntheticRasterModel::overlays() const {
+    vector<string> o;
+    for(unsigned int i = 0; i != settings.overlayCount; ++i) {
+        ostringstream name;
+        name << "overlay" << i;
+        o.push_back(name.str());
+    }
+    return o;
+}
+
+string SyntheticRasterModel::tileUrl(const string& layer, Zoom z, const TileCoords& coords) const {
+    if(settings.url.empty()) return "";
+
+    ostringstream url;
+    url << settings.url << '/' << layer << '/' << z << '/' << coords.x << '/' << coords.y << ".png";
+    return url.str();
+}
+
+string SyntheticRasterModel::tileFromPackage(const string& layer, Zoom z, const TileCoords& coords) {
+    if(z < settings.minZoom || z > settings.maxZoom || !isInPackage(z, coords))
+        return "";
+
+    if(settings.latency) Sleeper::usleep(settings.latency);
+    ++_packageReads;
+    return data;
+}
+
+}}}
@@ -0,0 +1,113 @@
+#ifndef Kompas_QtGui_Test_SyntheticRasterModel_h
+#define Kompas_QtGui_Test_SyntheticRasterModel_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::Test::SyntheticRasterModel
+ */
+
+#include "AbstractRasterModel.h"
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+/**
+@brief Synthetic raster model for benchmarks
+
+In-process raster model with one layer, optional overlays and generated
+tiles in given range of zoom levels. Fraction of tiles
+given by hit ratio is available in the (virtual) package, reading them takes
+configured time, the rest is available only for download from given URL,
+usually from TileServer. Whether a tile is in the package depends only on its
+coordinates, so repeated runs with the same settings request the same tiles
+from the same sources.
+*/
+class SyntheticRasterModel: public Core::AbstractRasterModel {
+    public:
+        /** @brief Model settings */
+        struct Settings {
+            /** @brief Constructor */
+            inline Settings(): tileSize(256, 256), minZoom(10), maxZoom(10), overlayCount(0), latency(0), hitRatio(1.0) {}
+
+            Core::TileSize tileSize;    /**< @brief Tile size */
+            Core::Zoom minZoom,         /**< @brief Minimal zoom level */
+                maxZoom;                /**< @brief Maximal zoom level */
+
+            /**
+             * @brief Count of overlays
+             *
+             * Overlays are named <tt>overlay0</tt>, <tt>overlay1</tt> etc.
+             */
+            unsigned int overlayCount;
+
+            /** @brief Time spent reading one tile from package, in microseconds */
+            unsigned int latency;
+
+            /** @brief Fraction of tiles available in package */
+            double hitRatio;
+
+            /**
+             * @brief Tile URL prefix
+             *
+             * Tile layer, zoom and coordinates are appended to it as path
+             * components. If empty, the model is offline.
+             */
+            std::string url;
+        };
+
+        /**
+         * @brief Generate tile data
+         * @param tileSize  Tile size
+         *
+         * Returns PNG image with noise, so it has size comparable to real
+         * map tiles and takes comparable time to decode.
+         */
+        static std::string generateTile(const Core::TileSize& tileSize);
+
+        /**
+         * @brief Constructor
+         * @param settings  Model settings
+         */
+        SyntheticRasterModel(const Settings& settings = Settings());
+
+        /** @brief Whether given tile is available in package */
+        bool isInPackage(Core::Zoom z, const Core::TileCoords& coords) const;
+
+        /** @brief Count of tiles read from package */
+        inline unsigned int packageReads() const { return _packageReads; }
+
+        int features() const;
+        inline const Core::AbstractProjection* projection() const { return 0; }
+        inline Core::TileSize tileSize() const { return settings.tileSize; }
+        inline std::string copyright() const { return "Synthetic"; }
+        inline std::string celestialBody() const { return ""; }
+
+        std::set<Core::Zoom> zoomLevels() const;
+        Core::TileArea area() const;
+        std::vector<std::string> layers() const;
+        std::vector<std::string> overlays() const;
+
+        std::string tileUrl(const std::string& layer, Core::Zoom z, const Core::TileCoords& coords) const;
+        std::string tileFromPackage(const std::string& layer, Core::Zoom z, const Core::TileCoords& coords);
+
+    private:
+        Settings settings;
+        std::string data;
+        unsigned int _packageReads;
+};
+
+}}}
+
+#endif
@@ -0,0 +1,165 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "TileDataThreadBenchmark.h"
+
+#include <algorithm>
+#include <ctime>
+#include <QtCore/QTimer>
+#include <QtTest/QtTest>
+
+#include "BenchmarkEnvironment.h"
+#include "MainWindow.h"
+#include "TileDataThread.h"
+#include "SyntheticRasterModel.h"
+#include "TileServer.h"
+
+QTEST_MAIN(Kompas::QtGui::Test::TileDataThreadBenchmark)
+
+using namespace std;
+using namespace Kompas::Core;
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+void TileDataThreadBenchmark::initTestCase() {
+    useTemporaryHome();
+    mainWindow = new MainWindow;
+
+    total = qgetenv("KOMPAS_BENCHMARK_TILES").toUInt();
+    if(total == 0) total = 512;
+    clock.start();
+}
+
+void TileDataThreadBenchmark::cleanupTestCase() {
+    delete mainWindow;
+}
+
+void TileDataThreadBenchmark::pipeline_data() {
+    QTest::addColumn<int>("tileSize");
+    QTest::addColumn<int>("packageLatency");
+    QTest::addColumn<double>("hitRatio");
+    QTest::addColumn<int>("downloadLatency");
+    QTest::addColumn<int>("queueSize");
+    QTest::addColumn<int>("concurrency");
+
+    const int tileSizes[] = { 256, 512 };
+    const double hitRatios[] = { 1.0, 0.9, 0.5, 0.0 };
+    const int queueSizes[] = { 1, 16, 256 };
+    const int concurrencies[] = { 1, 3, 8 };
+
+    for(int t = 0; t != 2; ++t) for(int h = 0; h != 4; ++h) for(int q = 0; q != 3; ++q) for(int c = 0; c != 3; ++c) {
+        /* Concurrency doesn't matter if nothing is downloaded */
+        if(hitRatios[h] == 1.0 && c != 0) continue;
+
+        QByteArray name = QString("%0px, %1% hits, queue %2, %3 downloads")
+            .arg(tileSizes[t]).arg(hitRatios[h]*100).arg(queueSizes[q]).arg(concurrencies[c]).toUtf8();
+        QTest::newRow(name.constData()) << tileSizes[t] << 200 << hitRatios[h] << 20 << queueSizes[q] << concurrencies[c];
+    }
+}
+
+void TileDataThreadBenchmark::pipeline() {
+    QFETCH(int, tileSize);
+    QFETCH(int, packageLatency);
+    QFETCH(double, hitRatio);
+    QFETCH(int, downloadLatency);
+    QFETCH(int, queueSize);
+    QFETCH(int, concurrency);
+
+    SyntheticRasterModel::Settings settings;
+    settings.tileSize = TileSize(tileSize, tileSize);
+    settings.latency = packageLatency;
+    settings.hitRatio = hitRatio;
+
+    string tile = SyntheticRasterModel::generateTile(settings.tileSize);
+    TileServer server(QByteArray(tile.data(), tile.size()));
+    server.setLatency(downloadLatency);
+    QVERIFY(server.start());
+    settings.url = server.url().toStdString();
+
+    /* Setting new model also clears memory cache */
+    mainWindow->setRasterModel(new SyntheticRasterModel(settings));
+    TileDataThread::setMaxSimultaenousDownloads(concurrency);
+
+    thread = new TileDataThread;
+    connect(thread, SIGNAL(tileData(QString,Core::Zoom,Core::TileCoords,QByteArray)),
+            SLOT(tileData(QString,Core::Zoom,Core::TileCoords)));
+    connect(thread, SIGNAL(tileNotFound(QString,Core::Zoom,Core::TileCoords)),
+            SLOT(tileNotFound(QString,Core::Zoom,Core::TileCoords)));
+
+    requested = found = notFound = 0;
+    started.clear();
+    latencies.clear();
+    latencies.reserve(total);
+
+    /* Fill the queue and wait until all requests finish */
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+    timeout.start(120000);
+
+    qint64 begin = clock.nsecsElapsed();
+    clock_t cpuBegin = std::clock();
+    for(int i = 0; i != queueSize && requested != total; ++i)
+        requestNext();
+    loop.exec();
+    clock_t cpuEnd = std::clock();
+    qint64 end = clock.nsecsElapsed();
+
+    delete thread;
+    thread = 0;
+
+    QVERIFY2(found+notFound == total, "timed out");
+    QCOMPARE(notFound, 0u);
+
+    sort(latencies.begin(), latencies.end());
+    double seconds = (end-begin)/1.0e9;
+    double p50 = latencies[latencies.size()/2]/1.0e6;
+    double p99 = latencies[qMin<size_t>(latencies.size()-1, latencies.size()*99/100)]/1.0e6;
+    double cpu = (cpuEnd-cpuBegin)*1.0e6/CLOCKS_PER_SEC/total;
+
+    qDebug("%8.1f tiles/s, latency p50 %7.2f ms, p99 %7.2f ms, CPU %7.1f us/tile, %d downloaded",
+           total/seconds, p50, p99, cpu, server.requestCount());
+    QTest::setBenchmarkResult((end-begin)/1.0e6/total, QTest::WalltimeMilliseconds);
+}
+
+void TileDataThreadBenchmark::requestNext() {
+    TileKey key("synthetic", 10, TileCoords(requested%1024, requested/1024));
+    ++requested;
+
+    started.insert(key, clock.nsecsElapsed());
+    thread->getTileData(key.layer, key.zoom, key.coords);
+}
+
+void TileDataThreadBenchmark::finish(const TileKey& key) {
+    QHash<TileKey, qint64>::iterator it = started.find(key);
+    if(it == started.end()) return;
+
+    latencies.push_back(clock.nsecsElapsed()-it.value());
+    started.erase(it);
+
+    if(requested != total) requestNext();
+    else if(started.isEmpty()) loop.quit();
+}
+
+void TileDataThreadBenchmark::tileData(const QString& layer, Zoom z, const TileCoords& coords) {
+    ++found;
+    finish(TileKey(layer, z, coords));
+}
+
+void TileDataThreadBenchmark::tileNotFound(const QString& layer, Zoom z, const TileCoords& coords) {
+    ++notFound;
+    finish(TileKey(layer, z, coords));
+}
+
+}}}
@@ -0,0 +1,88 @@
+#ifndef Kompas_QtGui_Test_TileDataThreadBenchmark_h
+#define Kompas_QtGui_Test_TileDataThreadBenchmark_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::Test::TileDataThreadBenchmark
+ */
+
+#include <vector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+class MainWindow;
+class TileDataThread;
+
+namespace Test {
+
+/**
+@brief Tile pipeline benchmark
+
+Requests tiles from TileDataThread backed by SyntheticRasterModel, with tiles
+not available in the package downloaded from TileServer. Requests are issued
+so there is always given count of them outstanding (queue size), the
+benchmark is repeated for various tile sizes, hit ratios and counts of
+simultaneous downloads. For each combination it reports tiles per second,
+50th and 99th percentile of latency between TileDataThread::getTileData() and
+the result signal and CPU time per tile. CPU time is measured for whole
+process, thus including the local HTTP server.
+
+Uses temporary configuration directory, so it doesn't touch user cache and
+configuration. Count of requested tiles in each run can be changed with
+<tt>KOMPAS_BENCHMARK_TILES</tt> environment variable (default 512). Being
+QtTest-based, all usual QtTest options (such as running only some data rows
+or <tt>-csv</tt> output) apply.
+*/
+class TileDataThreadBenchmark: public QObject {
+    Q_OBJECT
+
+    public slots:
+        /** @brief Tile loaded */
+        void tileData(const QString& layer, Core::Zoom z, const Core::TileCoords& coords);
+
+        /** @brief Tile not found */
+        void tileNotFound(const QString& layer, Core::Zoom z, const Core::TileCoords& coords);
+
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+
+        void pipeline_data();
+        void pipeline();
+
+    private:
+        MainWindow* mainWindow;
+        TileDataThread* thread;
+        QEventLoop loop;
+        QElapsedTimer clock;
+
+        unsigned int total, requested, found, notFound;
+        QHash<TileKey, qint64> started;
+        std::vector<qint64> latencies;
+
+        void requestNext();
+        void finish(const TileKey& key);
+};
+
+}}}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "TileServer.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpSocket>
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+TileServer::TileServer(const QByteArray& data): data(data), _latency(0), _requestCount(0) {
+    moveToThread(&thread);
+}
+
+TileServer::~TileServer() {
+    /* Close all connections and move back to main thread, so the server
+       thread can be safely stopped */
+    if(thread.isRunning())
+        QMetaObject::invokeMethod(this, "stop", Qt::BlockingQueuedConnection);
+
+    thread.quit();
+    thread.wait();
+}
+
+bool TileServer::start() {
+    thread.start();
+
+    /* The listening socket has to be created in server thread */
+    bool listening = false;
+    QMetaObject::invokeMethod(this, "listenLocally", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, listening));
+    return listening;
+}
+
+QString TileServer::url() const {
+    return QString("http://127.0.0.1:%0").arg(serverPort());
+}
+
+bool TileServer::listenLocally() {
+    return listen(QHostAddress::LocalHost);
+}
+
+void TileServer::stop() {
+    close();
+    foreach(QTcpSocket* socket, requests.keys()) {
+        socket->disconnect(this);
+        delete socket;
+    }
+    requests.clear();
+
+    moveToThread(QCoreApplication::instance()->thread());
+}
+
+void TileServer::incomingConnection(int socketDescriptor) {
+    QTcpSocket* socket = new QTcpSocket(this);
+    socket->setSocketDescriptor(socketDescriptor);
+    connect(socket, SIGNAL(readyRead()), SLOT(readRequest()));
+    connect(socket, SIGNAL(disconnected()), SLOT(closeConnection()));
+    requests.insert(socket, QByteArray());
+}
+
+void TileServer::readRequest() {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if(!socket) return;
+
+    /* Wait until whole request header arrives */
+    QByteArray& request = requests[socket];
+    request += socket->readAll();
+    int end = request.indexOf("\r\n\r\n");
+    if(end == -1) return;
+    request.remove(0, end+4);
+
+    _requestCount.ref();
+
+    /* Respond after given latency */
+    QTimer* timer = new QTimer(socket);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), SLOT(sendResponse()));
+    timer->start(_latency);
+}
+
+void TileServer::closeConnection() {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if(!socket) return;
+
+    requests.remove(socket);
+    socket->deleteLater();
+}
+
+void TileServer::sendResponse() {
+    QTimer* timer = qobject_cast<QTimer*>(sender());
+    if(!timer) return;
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(timer->parent());
+    timer->deleteLater();
+    if(!socket || socket->state() != QAbstractSocket::ConnectedState) return;
+
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: image/png\r\n"
+                  "Content-Length: " + QByteArray::number(data.size()) + "\r\n"
+                  "Connection: keep-alive\r\n\r\n");
+    socket->write(data);
+}
+
+}}}
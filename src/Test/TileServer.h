@@ -0,0 +1,93 @@
+#ifndef Kompas_QtGui_Test_TileServer_h
+#define Kompas_QtGui_Test_TileServer_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::Test::TileServer
+ */
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QThread>
+#include <QtNetwork/QTcpServer>
+
+class QTcpSocket;
+
+namespace Kompas { namespace QtGui { namespace Test {
+
+/**
+@brief Local HTTP tile server for benchmarks
+
+Minimal HTTP/1.1 server answering every GET request with the same tile after
+configured latency. Runs in its own thread, so serving the tiles doesn't
+compete with the benchmarked code for main thread event loop. Persistent
+connections are supported, pipelining is not (QNetworkAccessManager doesn't
+pipeline by default).
+*/
+class TileServer: public QTcpServer {
+    Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructor
+         * @param data      Tile data sent in every response
+         *
+         * Call start() to start the server.
+         */
+        TileServer(const QByteArray& data);
+
+        /** @brief Destructor */
+        ~TileServer();
+
+        /**
+         * @brief Start the server
+         * @return Whether listening on localhost succeeded
+         */
+        bool start();
+
+        /** @brief URL prefix of the server */
+        QString url() const;
+
+        /** @brief Response latency in milliseconds */
+        inline int latency() const { return _latency; }
+
+        /** @brief Set response latency in milliseconds */
+        inline void setLatency(int latency) { _latency = latency; }
+
+        /** @brief Count of served requests */
+        inline int requestCount() const { return _requestCount; }
+
+    protected:
+        void incomingConnection(int socketDescriptor);
+
+    private slots:
+        bool listenLocally();
+        void stop();
+        void readRequest();
+        void closeConnection();
+        void sendResponse();
+
+    private:
+        QThread thread;
+        QByteArray data;
+        QAtomicInt _latency, _requestCount;
+        QHash<QTcpSocket*, QByteArray> requests;
+};
+
+}}}
+
+#endif
@@ -15,12 +15,19 @@
 
 #include "TileDataThread.h"
 
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QMetaType>
 #include <QtGui/QPixmap>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QNetworkAccessManager>
 
+#include "CacheIndex.h"
+#include "CachePolicy.h"
+#include "CacheStatistics.h"
+#include "CacheWriteQueue.h"
 #include "MainWindow.h"
+#include "MemoryCache.h"
+#include "TileTracer.h"
 
 using namespace std;
 using namespace Kompas::Core;
@@ -31,7 +38,7 @@ namespace Kompas { namespace QtGui {
 
 int TileDataThread::_maxSimultaenousDownloads = 3;
 
-TileDataThread::TileDataThread(QObject* parent): QThread(parent), _abort(false) {
+TileDataThread::TileDataThread(QObject* parent): QThread(parent), _abort(false), downloaded(0), downloadedSize(0) {
     qRegisterMetaType<TileJob>();
 
     manager = new QNetworkAccessManager(this);
@@ -45,6 +52,11 @@ TileDataThread::~TileDataThread() {
     condition.wakeOne();
     mutex.unlock();
 
+    /* Main thread won't drain the results anymore */
+    resultsMutex.lock();
+    resultsDrained.wakeAll();
+    resultsMutex.unlock();
+
     wait();
 }
 
@@ -79,30 +91,66 @@ void TileDataThread::run() {
 
         /* Job found, proceed */
         if(runningCount == -1) {
-            Locker<AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForWrite();
-
-            /* Tile is already downloaded, save it to cache and continue to another */
-            if(rasterModel() && !firstPending.downloadedData.isEmpty()) {
-                Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
-                rasterModel()->tileToCache(cache(), firstPending.layer.toStdString(), firstPending.zoom, firstPending.coords, string(firstPending.downloadedData.data(), firstPending.downloadedData.size()));
+            TileKey key(firstPending.layer, firstPending.zoom, firstPending.coords);
+            QByteArray memoryData;
+            int memoryGeneration;
+
+            /* Jobs with downloaded data were already traced out of queue */
+            if(firstPending.downloadedData.isEmpty())
+                TileTracer::instance()->end("queued", key);
+
+            /* Tile is already downloaded, schedule saving it to cache and
+               continue to another */
+            if(!firstPending.downloadedData.isEmpty()) {
+                MainWindow::instance()->memoryCache()->set(key, firstPending.downloadedData, firstPending.generation);
+                MainWindow::instance()->cacheWriteQueue()->enqueue(key, firstPending.downloadedData, firstPending.generation);
+
+            /* Tile is in memory, no need to lock anything. If it was refused
+               by cache policy before and is requested often enough now,
+               write it, as it won't be downloaded again. */
+            } else if(!(memoryData = MainWindow::instance()->memoryCache()->get(key, &memoryGeneration)).isEmpty()) {
+                TileTracer::instance()->instant("memoryHit", key);
+                if(MainWindow::instance()->cachePolicy()->requested(key))
+                    MainWindow::instance()->cacheWriteQueue()->enqueue(key, memoryData, memoryGeneration);
+                pushResult(firstPending, memoryData);
 
             } else {
+                TileTracer::Span span("lookup", key);
+                MainWindow::instance()->cachePolicy()->requested(key);
+
+                Locker<AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForWrite();
+
                 /* No model available */
                 if(!rasterModel()) {
-                    emit tileNotFound(firstPending.layer, firstPending.zoom, firstPending.coords);
+                    rasterModel.unlock();
+                    pushResult(firstPending);
                     return;
                 }
 
-                /* First try to get the data from package or cache */
+                /* First try to get the data from package, then from tiles
+                   waiting for write to cache and then from cache */
                 string data = rasterModel()->tileFromPackage(firstPending.layer.toStdString(), firstPending.zoom, firstPending.coords);
+                if(data.empty()) {
+                    QByteArray pending = MainWindow::instance()->cacheWriteQueue()->pending(key);
+                    data.assign(pending.constData(), pending.size());
+                }
                 if(data.empty()) {
                     Locker<AbstractCache> cache = MainWindow::instance()->cacheForWrite();
-                    data = rasterModel()->tileFromCache(cache(), firstPending.layer.toStdString(), firstPending.zoom, firstPending.coords);
+                    if(cache()) {
+                        QElapsedTimer timer;
+                        timer.start();
+                        data = rasterModel()->tileFromCache(cache(), firstPending.layer.toStdString(), firstPending.zoom, firstPending.coords);
+                        MainWindow::instance()->cacheStatistics()->recordRead(key, data.size(), timer.nsecsElapsed()/1000);
+
+                        /* Keep the index in sync with actual cache contents */
+                        MainWindow::instance()->cacheIndex()->update(rasterModel()->plugin(), key, !data.empty());
+                    }
                 }
                 bool online = rasterModel()->online();
+                int generation = MainWindow::instance()->rasterModelGeneration();
                 rasterModel.unlock();
 
-                /* If found, emit signal with data */
+                /* If found, pass the data to main thread */
                 if(!data.empty()) {
 
                     /* QByteArray::fromRawData() doesn't copy data under pointer,
@@ -110,13 +158,14 @@ void TileDataThread::run() {
                     QByteArray b = QByteArray::fromRawData(data.data(), data.size());
                     b[0] = b[0];
 
-                    emit tileData(firstPending.layer, firstPending.zoom, firstPending.coords, b);
+                    MainWindow::instance()->memoryCache()->set(key, b, generation);
+                    pushResult(firstPending, b);
 
                 /* Else try to download the item */
                 } else {
                     /* Online is not enabled, tile not found */
                     if(!online)
-                        emit tileNotFound(firstPending.layer, firstPending.zoom, firstPending.coords);
+                        pushResult(firstPending);
 
                     /* Add the item back to queue, request download */
                     else {
@@ -139,6 +188,57 @@ void TileDataThread::run() {
     }
 }
 
+void TileDataThread::pushResult(const TileJob& job, const QByteArray& data) {
+    TileResult result;
+    result.layer = job.layer;
+    result.zoom = job.zoom;
+    result.coords = job.coords;
+    result.data = data;
+
+    /* Buffer is full, wait for main thread to drain it. The push is retried
+       with the mutex locked, so the wake-up can't come before the wait. */
+    if(!results.push(result)) {
+        resultsMutex.lock();
+        while(!results.push(result)) {
+            if(_abort) {
+                resultsMutex.unlock();
+                return;
+            }
+
+            notifyResults();
+            resultsDrained.wait(&resultsMutex);
+        }
+        resultsMutex.unlock();
+    }
+
+    notifyResults();
+}
+
+void TileDataThread::notifyResults() {
+    /* Post wake-up only if there isn't any pending already */
+    if(resultsNotified.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "drainResults", Qt::QueuedConnection);
+}
+
+void TileDataThread::drainResults() {
+    /* Reset the flag before draining, so results pushed meanwhile post
+       another wake-up */
+    resultsNotified.fetchAndStoreOrdered(0);
+
+    TileResult result;
+    while(results.pop(result)) {
+        /* Wake up the thread, if it waits for free space */
+        resultsMutex.lock();
+        resultsDrained.wakeOne();
+        resultsMutex.unlock();
+
+        if(result.data.isEmpty())
+            emit tileNotFound(result.layer, result.zoom, result.coords);
+        else
+            emit tileData(result.layer, result.zoom, result.coords, result.data);
+    }
+}
+
 void TileDataThread::startDownload(TileJob job) {
     QMutexLocker locker(&mutex);
 
@@ -151,10 +251,16 @@ void TileDataThread::startDownload(TileJob job) {
     /* The job was already aborted, nothing to do */
     if(position == -1) return;
 
-    /* Create request for given tile */
-    QString url = QString::fromStdString(MainWindow::instance()->rasterModelForRead()()->tileUrl(job.layer.toStdString(), job.zoom, job.coords));
+    /* Create request for given tile, remember which model it is for */
+    Locker<const AbstractRasterModel> rasterModel = MainWindow::instance()->rasterModelForRead();
+    QString url = QString::fromStdString(rasterModel()->tileUrl(job.layer.toStdString(), job.zoom, job.coords));
+    queue[position].generation = MainWindow::instance()->rasterModelGeneration();
+    rasterModel.unlock();
 
     queue[position].reply = manager->get(QNetworkRequest(QUrl(url)));
+
+    TileTracer* tracer = TileTracer::instance();
+    if(tracer->isEnabled()) tracer->begin("download", TileKey(job.layer, job.zoom, job.coords));
 }
 
 void TileDataThread::getTileData(const QString& layer, Core::Zoom z, const Core::TileCoords& coords) {
@@ -174,17 +280,33 @@ void TileDataThread::getTileData(const QString& layer, Core::Zoom z, const Core:
 
     queue.append(dl);
 
+    TileTracer* tracer = TileTracer::instance();
+    if(tracer->isEnabled()) {
+        TileKey key(layer, z, coords);
+        tracer->instant("getTileData", key);
+        tracer->begin("queued", key);
+    }
+
     /* If the thread is not running, start it, otherwise wake up */
     if(!isRunning()) start();
     else condition.wakeOne();
 }
 
 void TileDataThread::abort(const QString& layer) {
+    TileTracer* tracer = TileTracer::instance();
+
     mutex.lock();
     for(int i = queue.size()-1; i >= 0; --i) {
         if(!layer.isEmpty() && queue[i].layer != layer)
             continue;
 
+        /* End spans of aborted jobs */
+        if(tracer->isEnabled()) {
+            TileKey key(queue[i].layer, queue[i].zoom, queue[i].coords);
+            if(queue[i].reply) tracer->end("download", key);
+            else if(!queue[i].running && queue[i].downloadedData.isEmpty()) tracer->end("queued", key);
+        }
+
         if(queue[i].reply) {
             queue[i].reply->abort();
             queue[i].reply->deleteLater();
@@ -195,6 +317,19 @@ void TileDataThread::abort(const QString& layer) {
     mutex.unlock();
 }
 
+TileDataThread::Statistics TileDataThread::statistics() {
+    QMutexLocker locker(&mutex);
+
+    Statistics s;
+    foreach(const TileJob& job, queue) {
+        if(job.running) ++s.running;
+        else ++s.pending;
+    }
+    s.downloaded = downloaded;
+    s.downloadedSize = downloadedSize;
+    return s;
+}
+
 void TileDataThread::finishDownload(QNetworkReply* reply) {
     /* Triggerred from abort() */
     if(reply->error() == QNetworkReply::OperationCanceledError) return;
@@ -202,15 +337,21 @@ void TileDataThread::finishDownload(QNetworkReply* reply) {
     /* Find the reply in queue, save the data there */
     TileJob dl;
 
+    /* Error pages and failed responses are not tiles, don't pass them to
+       the cache */
+    bool success = reply->error() == QNetworkReply::NoError && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200;
+
     mutex.lock();
     QByteArray data;
     for(int i = 0; i != queue.size(); ++i) if(queue[i].reply == reply) {
         dl = queue[i];
 
-        data = reply->readAll();
+        if(success) data = reply->readAll();
         if(data.isEmpty()) {
             queue.removeAt(i);
         } else {
+            ++downloaded;
+            downloadedSize += data.size();
             queue[i].downloadedData = data;
             queue[i].running = false;
             queue[i].reply = 0;
@@ -219,8 +360,11 @@ void TileDataThread::finishDownload(QNetworkReply* reply) {
     }
     mutex.unlock();
 
+    TileTracer* tracer = TileTracer::instance();
+    if(tracer->isEnabled()) tracer->end("download", TileKey(dl.layer, dl.zoom, dl.coords));
+
     /* Download failed */
-    if(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+    if(data.isEmpty()) {
         emit tileNotFound(dl.layer, dl.zoom, dl.coords);
 
     /* Download success */
@@ -26,6 +26,7 @@
 #include <QtGui/QPixmap>
 
 #include "AbstractRasterModel.h"
+#include "RingBuffer.h"
 
 class QNetworkReply;
 class QNetworkAccessManager;
@@ -37,6 +38,13 @@ namespace Kompas { namespace QtGui {
  *
  * Getting tile data from local files in done in separated thread, if the data
  * aren't available locally and model has enabled online
+ *
+ * Tiles loaded in the thread are passed to the main thread through lock-free
+ * RingBuffer. Only one wake-up call waits in the event loop at a time, it
+ * drains all tiles loaded meanwhile and emits tileData() or tileNotFound()
+ * for each of them, so all signals are emitted from the main thread and
+ * delivered to the map view directly. If the main thread doesn't keep up and
+ * the buffer is full, the thread sleeps until the main thread drains it.
  * @todo Generalize for all data?
  */
 class TileDataThread: public QThread {
@@ -51,9 +59,21 @@ class TileDataThread: public QThread {
             Core::TileCoords coords;    /**< @brief Tile coordinates */
             bool running;               /**< @brief Whether tile download is in progress */
             QByteArray downloadedData;  /**< @brief Downloaded data */
+            int generation;             /**< @brief Raster model generation of downloaded data */
+
+            /** @brief Constructor */
+            inline TileJob(): reply(0), running(false), generation(0) {}
+        };
 
+        /** @brief Job statistics */
+        struct Statistics {
             /** @brief Constructor */
-            inline TileJob(): reply(0), running(false) {}
+            inline Statistics(): pending(0), running(0), downloaded(0), downloadedSize(0) {}
+
+            int pending,                /**< @brief Count of jobs waiting in queue */
+                running;                /**< @brief Count of running downloads */
+            quint64 downloaded,         /**< @brief Count of downloaded tiles */
+                downloadedSize;         /**< @brief Size of downloaded tiles */
         };
 
         /**
@@ -118,6 +138,14 @@ class TileDataThread: public QThread {
          */
         void abort(const QString& layer = "");
 
+        /**
+         * @brief Job statistics
+         *
+         * Downloaded tile count and size are counted since the thread was
+         * created.
+         */
+        Statistics statistics();
+
     signals:
         /**
          * @brief Tile data
@@ -158,6 +186,23 @@ class TileDataThread: public QThread {
 
         QNetworkAccessManager* manager;
         QList<TileJob> queue;
+        quint64 downloaded, downloadedSize;
+
+        /* Tile loaded in the thread, empty data if not found */
+        struct TileResult {
+            QString layer;
+            Core::Zoom zoom;
+            Core::TileCoords coords;
+            QByteArray data;
+        };
+
+        RingBuffer<TileResult> results;
+        QAtomicInt resultsNotified;
+        QMutex resultsMutex;
+        QWaitCondition resultsDrained;
+
+        void pushResult(const TileJob& job, const QByteArray& data = QByteArray());
+        void notifyResults();
 
     signals:
         /**
@@ -171,6 +216,7 @@ class TileDataThread: public QThread {
         void download(const Kompas::QtGui::TileDataThread::TileJob& job);
 
     private slots:
+        void drainResults();
         void startDownload(const Kompas::QtGui::TileDataThread::TileJob job);
         void finishDownload(QNetworkReply* reply);
 };
@@ -0,0 +1,59 @@
+#ifndef Kompas_QtGui_TileKey_h
+#define Kompas_QtGui_TileKey_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::TileKey
+ */
+
+#include <QtCore/QHash>
+#include <QtCore/QString>
+
+#include "AbstractRasterModel.h"
+
+namespace Kompas { namespace QtGui {
+
+/** @brief Tile identification usable as hash key */
+struct TileKey {
+    /** @brief Default constructor */
+    inline TileKey(): zoom(0) {}
+
+    /**
+     * @brief Constructor
+     * @param _layer    Tile layer or overlay name
+     * @param _zoom     Zoom
+     * @param _coords   Tile coordinates
+     */
+    inline TileKey(const QString& _layer, Core::Zoom _zoom, const Core::TileCoords& _coords): layer(_layer), zoom(_zoom), coords(_coords) {}
+
+    QString layer;              /**< @brief Tile layer or overlay name */
+    Core::Zoom zoom;            /**< @brief Zoom */
+    Core::TileCoords coords;    /**< @brief Tile coordinates */
+
+    /** @brief Equality operator */
+    inline bool operator==(const TileKey& other) const {
+        return coords == other.coords && zoom == other.zoom && layer == other.layer;
+    }
+};
+
+/** @brief Hash function for TileKey */
+inline uint qHash(const TileKey& key) {
+    return qHash(key.layer) ^ (key.zoom << 24) ^ qHash((static_cast<quint64>(key.coords.x) << 32)|key.coords.y);
+}
+
+}}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+#include "TileTracer.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+
+namespace Kompas { namespace QtGui {
+
+TileTracer* TileTracer::instance() {
+    static TileTracer tracer;
+    return &tracer;
+}
+
+TileTracer::TileTracer(): _enabled(false) {
+    clock.start();
+}
+
+void TileTracer::setEnabled(bool enabled) {
+    QMutexLocker locker(&mutex);
+    _enabled = enabled;
+}
+
+void TileTracer::record(char phase, const char* name, const TileKey& tile, qint64 timestamp, qint64 duration) {
+    Event e;
+    e.phase = phase;
+    e.name = name;
+    e.tile = tile;
+    e.thread = QThread::currentThreadId();
+    e.timestamp = timestamp;
+    e.duration = duration;
+
+    QMutexLocker locker(&mutex);
+    if(events.size() < maxEventCount) events.append(e);
+}
+
+QString TileTracer::filename() {
+    QMutexLocker locker(&mutex);
+    return _filename;
+}
+
+void TileTracer::setFilename(const QString& filename) {
+    QMutexLocker locker(&mutex);
+    _filename = filename;
+}
+
+int TileTracer::eventCount() {
+    QMutexLocker locker(&mutex);
+    return events.size();
+}
+
+bool TileTracer::save(const QString& filename) {
+    QFile file(filename);
+    if(!file.open(QFile::WriteOnly|QFile::Truncate|QFile::Text)) return false;
+
+    QMutexLocker locker(&mutex);
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    qint64 pid = QCoreApplication::applicationPid();
+    for(int i = 0; i != events.size(); ++i) {
+        const Event& e = events[i];
+        QString tile = QString("%0/%1/%2/%3").arg(e.tile.layer).arg(e.tile.zoom).arg(e.tile.coords.x).arg(e.tile.coords.y);
+
+        /* Layer names are plain identifiers, but escape them anyway */
+        tile.replace('\\', "\\\\").replace('"', "\\\"");
+
+        /* Timestamps and durations are in microseconds */
+        if(i != 0) out << ',';
+        out << "\n{\"name\":\"" << e.name << "\",\"cat\":\"tile\",\"ph\":\"" << e.phase
+            << "\",\"pid\":" << pid << ",\"tid\":" << reinterpret_cast<quintptr>(e.thread)
+            << ",\"ts\":" << QString::number(e.timestamp/1000.0, 'f', 3);
+        if(e.phase == 'X')
+            out << ",\"dur\":" << QString::number(e.duration/1000.0, 'f', 3);
+        if(e.phase == 'i')
+            out << ",\"s\":\"t\"";
+
+        /* Asynchronous spans are matched by ID, use the tile for it */
+        if(e.phase == 'b' || e.phase == 'e')
+            out << ",\"id\":\"" << tile << '"';
+
+        out << ",\"args\":{\"tile\":\"" << tile << "\"}}";
+    }
+
+    out << "\n]}\n";
+    return out.status() == QTextStream::Ok;
+}
+
+void TileTracer::clear() {
+    QMutexLocker locker(&mutex);
+    events.clear();
+}
+
+}}
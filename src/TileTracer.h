@@ -0,0 +1,223 @@
+#ifndef Kompas_QtGui_TileTracer_h
+#define Kompas_QtGui_TileTracer_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::QtGui::TileTracer
+ */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "TileKey.h"
+
+namespace Kompas { namespace QtGui {
+
+/**
+@brief Tile lifecycle tracer
+
+Records timestamped events of tile loading with thread IDs, so a single tile
+can be followed from TileDataThread::getTileData() through the queue,
+package and cache lookup and download to decoding and displaying in the map
+view. The events are saved in Chrome trace event format (JSON), which can be
+opened in <tt>chrome://tracing</tt> or Perfetto UI. Waiting in the queue and
+downloading are recorded as asynchronous spans with ID derived from the tile,
+lookup, decoding and displaying as complete spans on the thread which did
+them. Each event has the tile as <tt>layer/zoom/x/y</tt> in its arguments.
+
+Tracing is compiled in, but disabled by default. When disabled, each trace
+point costs only one check of a flag. It can be enabled with
+<tt>--trace</tt> or <tt>--trace=</tt><em>file</em> command-line option or
+with <tt>enabled</tt> configuration key (see below). Recorded events can be
+saved on demand from Tools menu and they are saved to given or configured
+file on application exit. At most
+@ref maxEventCount events are kept, later events are dropped. All functions
+are thread-safe.
+
+@configuration
+
+<p>Configuration is stored in <tt>trace</tt> group.</p>
+<pre>
+[trace]
+
+# Whether to trace tile loading
+enabled=false
+
+# File where to save the trace on exit, defaults to kompas-trace.json in
+# %Kompas configuration dir
+file=
+</pre>
+*/
+class TileTracer {
+    public:
+        /** @brief Max count of recorded events */
+        static const int maxEventCount = 1000000;
+
+        /**
+         * @brief Span of code on current thread
+         *
+         * Records complete event from construction to destruction, if the
+         * tracer is enabled.
+         */
+        class Span {
+            public:
+                /**
+                 * @brief Constructor
+                 * @param name      Event name (string literal)
+                 * @param tile      Tile
+                 */
+                inline Span(const char* name, const TileKey& tile): name(name), start(-1) {
+                    TileTracer* t = TileTracer::instance();
+                    if(!t->isEnabled()) return;
+                    this->tile = tile;
+                    start = t->timestamp();
+                }
+
+                /**
+                 * @brief Constructor
+                 * @param name      Event name (string literal)
+                 * @param layer     Tile layer or overlay name
+                 * @param zoom      Tile zoom
+                 * @param coords    Tile coordinates
+                 *
+                 * Creates the tile key only if the tracer is enabled.
+                 */
+                inline Span(const char* name, const QString& layer, Core::Zoom zoom, const Core::TileCoords& coords): name(name), start(-1) {
+                    TileTracer* t = TileTracer::instance();
+                    if(!t->isEnabled()) return;
+                    tile = TileKey(layer, zoom, coords);
+                    start = t->timestamp();
+                }
+
+                /** @brief Destructor */
+                inline ~Span() {
+                    if(start != -1) TileTracer::instance()->complete(name, tile, start);
+                }
+
+            private:
+                const char* name;
+                TileKey tile;
+                qint64 start;
+        };
+
+        /** @brief Global instance */
+        static TileTracer* instance();
+
+        /** @brief Whether tracing is enabled */
+        inline bool isEnabled() const { return _enabled; }
+
+        /**
+         * @brief Enable or disable tracing
+         *
+         * Already recorded events are kept.
+         */
+        void setEnabled(bool enabled);
+
+        /**
+         * @brief File where to save the trace on exit
+         *
+         * Set by MainWindow from configuration, if not already set from
+         * command-line.
+         */
+        QString filename();
+
+        /** @brief Set file where to save the trace on exit */
+        void setFilename(const QString& filename);
+
+        /**
+         * @brief Current timestamp
+         *
+         * In nanoseconds since tracer creation.
+         */
+        inline qint64 timestamp() const { return clock.nsecsElapsed(); }
+
+        /**
+         * @brief Record instant event
+         * @param name      Event name (string literal)
+         * @param tile      Tile
+         */
+        inline void instant(const char* name, const TileKey& tile) {
+            if(_enabled) record('i', name, tile, timestamp());
+        }
+
+        /**
+         * @brief Begin asynchronous span
+         * @param name      Span name (string literal)
+         * @param tile      Tile
+         *
+         * The span can end on another thread, see end().
+         */
+        inline void begin(const char* name, const TileKey& tile) {
+            if(_enabled) record('b', name, tile, timestamp());
+        }
+
+        /**
+         * @brief End asynchronous span
+         * @param name      Span name (string literal), the same as in begin()
+         * @param tile      Tile
+         */
+        inline void end(const char* name, const TileKey& tile) {
+            if(_enabled) record('e', name, tile, timestamp());
+        }
+
+        /**
+         * @brief Record complete span on current thread
+         * @param name      Span name (string literal)
+         * @param tile      Tile
+         * @param start     Span start, from timestamp()
+         */
+        inline void complete(const char* name, const TileKey& tile, qint64 start) {
+            if(_enabled) record('X', name, tile, start, timestamp()-start);
+        }
+
+        /** @brief Count of recorded events */
+        int eventCount();
+
+        /**
+         * @brief Save recorded events
+         * @param filename  File name
+         * @return Whether the file was successfully written
+         */
+        bool save(const QString& filename);
+
+        /** @brief Remove all recorded events */
+        void clear();
+
+    private:
+        struct Event {
+            char phase;
+            const char* name;
+            TileKey tile;
+            Qt::HANDLE thread;
+            qint64 timestamp, duration;
+        };
+
+        volatile bool _enabled;
+        QElapsedTimer clock;
+        QMutex mutex;
+        QString _filename;
+        QVector<Event> events;
+
+        TileTracer();
+
+        void record(char phase, const char* name, const TileKey& tile, qint64 timestamp, qint64 duration = 0);
+};
+
+}}
+
+#endif
@@ -20,6 +20,7 @@
 #include <QtGui/QApplication>
 #include "Utility/Translator.h"
 #include "MainWindow.h"
+#include "TileTracer.h"
 #include "MainWindowConfigure.h"
 
 int main(int argc, char** argv) {
@@ -47,6 +48,16 @@ int main(int argc, char** argv) {
     app.installTranslator(&translatorQt);
     app.installTranslator(&translator);
 
+    /* Tile tracing, enabled before main window, so loading of initial tiles
+       is traced too */
+    foreach(const QString& argument, app.arguments()) {
+        if(argument != "--trace" && !argument.startsWith("--trace=")) continue;
+
+        Kompas::QtGui::TileTracer::instance()->setEnabled(true);
+        if(argument.startsWith("--trace="))
+            Kompas::QtGui::TileTracer::instance()->setFilename(argument.mid(8));
+    }
+
     /* Main window */
     Kompas::QtGui::MainWindow w;
     w.show();